@@ -0,0 +1,13 @@
+// FLAGS: -ffp-contract=fast
+
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+float X(f)(float a, float b, float c) {
+    return a * b + c;
+}
+double X(f)(double a, double b, double c) {
+    double t = a * b;
+    return t - c;
+}
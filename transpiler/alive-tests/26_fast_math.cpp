@@ -0,0 +1,26 @@
+// FLAGS: -ffast-math -ffp-contract=fast
+
+#include <cmath>
+
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+float X(f)(float a, float b) {
+    return a + b;
+}
+double X(f)(double a, double b, double c) {
+    return a * b + c;
+}
+double X(f)(double a, double b) {
+    return a / b;
+}
+int X(f)(double a, double b) {
+    return a <= b;
+}
+float X(f)(float a) {
+    return sqrtf(a);
+}
+double X(f)(double a) {
+    return std::floor(a);
+}
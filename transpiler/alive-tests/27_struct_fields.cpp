@@ -0,0 +1,45 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+struct point {
+    int x;
+    int y;
+};
+
+struct S {
+    char c;
+    point p;
+    int arr[4];
+    union {
+        int i;
+        float f;
+    } u;
+    double d;
+};
+
+int X(f)(S* s) {
+    return s->p.x + s->p.y;
+}
+int X(f)(S* s, int i) {
+    return s->arr[i];
+}
+int X(f)(S* s, unsigned i) {
+    return s[1].arr[i];
+}
+float X(f)(S* s) {
+    return s->u.f;
+}
+void X(f)(S* s, int v) {
+    s->arr[2] = v;
+    s->d = 1.5;
+}
+void X(f)(S* a, S* b) {
+    *a = *b;
+}
+void X(f)(point* p) {
+    *p = {};
+}
+int* X(f)(S* s, unsigned i) {
+    return &s->arr[i];
+}
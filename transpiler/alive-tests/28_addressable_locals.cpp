@@ -0,0 +1,37 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+void sink(int*);
+
+struct pair {
+    int a;
+    int b;
+};
+
+int X(f)(int x) {
+    int y = x;
+    sink(&y);
+    return y;
+}
+int X(f)(int n) {
+    int sum = 0;
+    for(int i = 0; i < n; i++) {
+        int tmp = i;
+        sink(&tmp);
+        sum += tmp;
+    }
+    return sum;
+}
+int X(f)(int x) {
+    int arr[4] = {};
+    arr[1] = x;
+    sink(arr);
+    return arr[1] + arr[2];
+}
+int X(f)(int x) {
+    pair p;
+    p.a = x;
+    sink(&p.b);
+    return p.a + p.b;
+}
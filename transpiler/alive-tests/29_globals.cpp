@@ -0,0 +1,39 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+void sink(const char*);
+
+extern int counter;
+int total;
+static const int table[8] = {1, 2, 4, 8, 16, 32, 64, 128};
+
+struct entry {
+    const char* name;
+    int value;
+};
+
+static const entry entries[] = {
+    {"one", 1},
+    {"two", 2},
+};
+
+int X(f)(unsigned i) {
+    return table[i & 7];
+}
+int X(f)() {
+    return table[3];
+}
+int X(f)(int x) {
+    total += x;
+    return counter + total;
+}
+void X(f)() {
+    sink("hello");
+}
+const char* X(f)(int i) {
+    return entries[i & 1].name;
+}
+int X(f)() {
+    return entries[1].value;
+}
@@ -0,0 +1,18 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+extern __thread int shared_counter;
+static __thread long local_counter;
+__thread int initial_exec_counter __attribute__((tls_model("initial-exec")));
+
+long X(f)(long x) {
+    local_counter += x;
+    return local_counter;
+}
+int X(f)() {
+    return shared_counter;
+}
+void X(f)(int x) {
+    initial_exec_counter = x;
+}
@@ -0,0 +1,31 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+int X(f)(unsigned x) {
+    return __builtin_popcount(x);
+}
+int X(f)(unsigned long long x) {
+    return __builtin_popcountll(x);
+}
+int X(f)(unsigned x) {
+    return __builtin_ctz(x);
+}
+int X(f)(unsigned long x) {
+    return __builtin_ctzl(x);
+}
+int X(f)(unsigned x) {
+    return __builtin_clz(x);
+}
+int X(f)(unsigned long long x) {
+    return __builtin_clzll(x);
+}
+unsigned short X(f)(unsigned short x) {
+    return __builtin_bswap16(x);
+}
+unsigned X(f)(unsigned x) {
+    return __builtin_bswap32(x);
+}
+unsigned long X(f)(unsigned long x) {
+    return __builtin_bswap64(x);
+}
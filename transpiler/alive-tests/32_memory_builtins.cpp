@@ -0,0 +1,31 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+void X(f)(char* dst, const char* src, unsigned long n) {
+    __builtin_memcpy(dst, src, n);
+}
+void X(f)(char* dst, const char* src, unsigned long n) {
+    __builtin_memmove(dst, src, n);
+}
+void X(f)(char* dst, int c, unsigned long n) {
+    __builtin_memset(dst, c, n);
+}
+int X(f)(const int* p) {
+    __builtin_prefetch(p);
+    __builtin_prefetch(p + 16, 1, 1);
+    return *p;
+}
+int X(f)(long x) {
+    if(__builtin_expect(x > 10, 0)) {
+        return 1;
+    }
+    return 2;
+}
+long X(f)(long x) {
+    return __builtin_expect(x, 42);
+}
+int X(f)(int* p) {
+    int* q = (int*)__builtin_assume_aligned(p, 16);
+    return q[0] + q[1];
+}
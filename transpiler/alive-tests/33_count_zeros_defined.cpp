@@ -0,0 +1,23 @@
+// FLAGS: -mbmi -mlzcnt
+
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+// __builtin_ctzg and __builtin_clzg with a result for zero become .CTZ (x, 32) and .CLZ (x, 32) when the target
+// defines that result, which tzcnt and lzcnt do. x ? __builtin_ctz (x) : 32 only folds to the same later, in phiopt, so
+// before gcc 14 and clang 19, which added them, this test is empty and reported unsupported.
+#if __has_builtin(__builtin_ctzg) && __has_builtin(__builtin_clzg)
+int X(f)(unsigned x) {
+    return __builtin_ctzg(x, 32);
+}
+int X(f)(unsigned long x) {
+    return __builtin_ctzg(x, 64);
+}
+int X(f)(unsigned x) {
+    return __builtin_clzg(x, 32);
+}
+int X(f)(unsigned long x) {
+    return __builtin_clzg(x, 64);
+}
+#endif
@@ -0,0 +1,47 @@
+// FLAGS: -fno-math-errno
+
+#include <cmath>
+
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+double X(f)(double x) {
+    return std::sqrt(x);
+}
+float X(f)(float x) {
+    return std::sqrt(x);
+}
+double X(f)(double x) {
+    return std::floor(x);
+}
+float X(f)(float x) {
+    return std::ceil(x);
+}
+double X(f)(double x) {
+    return std::trunc(x);
+}
+double X(f)(double x) {
+    return std::round(x);
+}
+double X(f)(double x) {
+    return std::fabs(x);
+}
+float X(f)(float x, float y) {
+    return std::copysign(x, y);
+}
+double X(f)(double x, double y) {
+    return std::fmin(x, y);
+}
+float X(f)(float x, float y) {
+    return std::fmax(x, y);
+}
+double X(f)(double x, double y, double z) {
+    return std::fma(x, y, z);
+}
+int X(f)(int x) {
+    return __builtin_abs(x);
+}
+long X(f)(long x) {
+    return __builtin_labs(x);
+}
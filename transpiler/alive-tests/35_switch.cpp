@@ -0,0 +1,32 @@
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+int X(f)(int x, int a) {
+    switch(x) {
+        case 0: return a * 3;
+        case 1: return a + 7;
+        case 4: return a - 2;
+        case 9: return a ^ 5;
+        case -1: return 100;
+        default: return 0;
+    }
+}
+int X(f)(unsigned x, int a) {
+    int r = a;
+    switch(x) {
+        case 2: r += 1; break;
+        case 3: r *= 2; break;
+        case 4: case 5: case 6: r -= 8; break;
+        case 4000000000u: r = 11; break;
+    }
+    return r;
+}
+int X(f)(char c) {
+    switch(c) {
+        case 'a' ... 'z': return 1;
+        case 'A' ... 'Z': return 2;
+        case '0' ... '9': return 3;
+        default: return 0;
+    }
+}
@@ -0,0 +1,85 @@
+#include <climits>
+
+#define TOKENPASTE(x, y) x ## y
+#define TOKENPASTE2(x, y) TOKENPASTE(x, y)
+#define X(name) TOKENPASTE2(name, __COUNTER__)
+
+// The constants reach bimple as ssa copies, so these are folded by the fold pass and not by gcc. Operations that are
+// undefined must be left alone: oversized shifts and out of range conversions are poison in llvm, which is also what
+// clang makes of them. INT_MIN / -1 in int is immediate undefined behavior for sdiv but poison once clang folds it, so
+// alive can't compare the two, the division is checked right next to the overflow instead.
+
+long X(f)() {
+    long a = INT_MIN;
+    long b = -1;
+    return a / b;
+}
+int X(f)() {
+    int a = INT_MIN + 1;
+    int b = -1;
+    return a / b;
+}
+int X(f)() {
+    int a = INT_MIN;
+    int b = 1;
+    return a / b;
+}
+unsigned X(f)() {
+    unsigned a = 0x80000000u;
+    unsigned b = UINT_MAX;
+    return a / b;
+}
+int X(f)() {
+    short a = SHRT_MIN;
+    short b = -1;
+    return a / b;
+}
+int X(f)() {
+    int a = INT_MIN;
+    int b = 2;
+    return a % b;
+}
+unsigned X(f)() {
+    unsigned a = 1;
+    int n = 31;
+    return a << n;
+}
+unsigned X(f)() {
+    unsigned a = 1;
+    int n = 32;
+    return a << n;
+}
+int X(f)() {
+    int a = -8;
+    int n = 40;
+    return a >> n;
+}
+unsigned long X(f)() {
+    unsigned long a = 1;
+    int n = 64;
+    return a << n;
+}
+int X(f)() {
+    double d = 2147483647.9;
+    return int(d);
+}
+int X(f)() {
+    double d = 2147483648.0;
+    return int(d);
+}
+int X(f)() {
+    double d = -2147483649.0;
+    return int(d);
+}
+unsigned X(f)() {
+    double d = -1.0;
+    return unsigned(d);
+}
+unsigned X(f)() {
+    float f = 4294967040.0f;
+    return unsigned(f);
+}
+long X(f)() {
+    double d = 1e19;
+    return long(d);
+}
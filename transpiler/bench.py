@@ -0,0 +1,157 @@
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)), "benchmarks"))
+import generate_tu
+
+# Compile-time throughput benchmarks: synthetic translation units are run through the plugin and wyrm's cost is
+# reported per stage. Run from the build directory, like test.py.
+
+STAGES = ["gimple_to_bimple", "passes", "cache", "codegen", "output"]
+
+DEFAULT_CONFIGS = [
+    ("many_small", 2000),
+    ("huge_function", 5000),
+    ("loop_nest", 8),
+    ("wide_switch", 500),
+    ("phi_heavy", 200),
+]
+
+def run_once(plugin, source, workdir, flags):
+    timings_path = os.path.join(workdir, "timings.jsonl")
+    if os.path.exists(timings_path):
+        os.remove(timings_path)
+    args = [
+        "g++",
+        *flags,
+        "-c",
+        source,
+        "-o",
+        os.devnull,
+    ]
+    start = time.perf_counter()
+    p = subprocess.run(args, cwd=workdir, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    baseline = time.perf_counter() - start
+    start = time.perf_counter()
+    p = subprocess.run(
+        [
+            *args,
+            f"-fplugin={plugin}",
+            "-fplugin-arg-libplugin-quiet",
+            f"-fplugin-arg-libplugin-timings={timings_path}",
+        ],
+        cwd=workdir,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE
+    )
+    total = time.perf_counter() - start
+    if p.returncode != 0:
+        return None
+    with open(timings_path, "r") as f:
+        records = [json.loads(line) for line in f]
+    functions = [record for record in records if "function" in record]
+    unit = [record for record in records if "unit" in record][-1]
+    result = {
+        "gcc_seconds": baseline,
+        "total_seconds": total,
+        "functions": len(functions),
+        "blocks": sum(fn["blocks"] for fn in functions),
+        "statements": sum(fn["statements"] for fn in functions),
+        "ir_bytes": sum(fn["ir_bytes"] for fn in functions),
+        "peak_rss": unit["peak_rss"],
+    }
+    for stage in STAGES:
+        result[stage] = {
+            "ns": sum(fn["stages"][stage]["ns"] for fn in functions),
+            "allocations": sum(fn["stages"][stage]["allocations"] for fn in functions),
+            "bytes": sum(fn["stages"][stage]["bytes"] for fn in functions),
+            "peak_bytes": max([fn["stages"][stage]["peak_bytes"] for fn in functions], default=0),
+        }
+        result[stage]["ns_per_statement"] = result[stage]["ns"] / max(result["statements"], 1)
+    return result
+
+def median_result(results):
+    # medians of the timing metrics, everything else is deterministic
+    result = dict(results[0])
+    for key in ["gcc_seconds", "total_seconds", "peak_rss"]:
+        result[key] = statistics.median(r[key] for r in results)
+    for stage in STAGES:
+        result[stage] = dict(results[0][stage])
+        for key in ["ns", "ns_per_statement"]:
+            result[stage][key] = statistics.median(r[stage][key] for r in results)
+    return result
+
+def compare(results, baseline, threshold):
+    regressions = 0
+    for name, result in results.items():
+        if name not in baseline or result is None or baseline[name] is None:
+            continue
+        for stage in STAGES:
+            # baselines recorded before a stage was measured don't have it
+            if stage not in baseline[name]:
+                continue
+            old = baseline[name][stage]["ns_per_statement"]
+            new = result[stage]["ns_per_statement"]
+            if old > 0:
+                change = (new - old) / old
+                flag = ""
+                if change > threshold:
+                    flag = " <-- regression"
+                    regressions += 1
+                print(f"{name:>22} {stage:>16}: {old:10.1f} -> {new:10.1f} ns/stmt ({change:+.1%}){flag}")
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description="wyrm compile-time benchmarks")
+    parser.add_argument("--plugin", default="./libplugin.so")
+    parser.add_argument("--config", action="append", help="shape:size, e.g. huge_function:5000 (repeatable)")
+    parser.add_argument("--repetitions", type=int, default=3)
+    parser.add_argument("--flags", default="-O2", help="flags passed to g++")
+    parser.add_argument("--output", help="write results as json")
+    parser.add_argument("--baseline", help="json results from a previous run to compare against")
+    parser.add_argument("--threshold", type=float, default=0.1, help="relative slowdown reported as a regression")
+    args = parser.parse_args()
+
+    plugin = os.path.abspath(args.plugin)
+    configs = DEFAULT_CONFIGS
+    if args.config:
+        configs = [(c.split(":")[0], int(c.split(":")[1])) for c in args.config]
+
+    results = {}
+    with tempfile.TemporaryDirectory() as workdir:
+        for shape, size in configs:
+            name = f"{shape}:{size}"
+            source = os.path.join(workdir, f"{shape}_{size}.cpp")
+            with open(source, "w") as f:
+                f.write(generate_tu.generate(shape, size))
+            runs = [run_once(plugin, source, workdir, args.flags.split()) for _ in range(args.repetitions)]
+            if any(run is None for run in runs):
+                print(f"{name:>22}: unsupported")
+                results[name] = None
+                continue
+            result = median_result(runs)
+            results[name] = result
+            print(
+                f"{name:>22}: {result['statements']:7} stmts, "
+                + ", ".join(f"{stage} {result[stage]['ns_per_statement']:8.1f} ns/stmt" for stage in STAGES)
+                + f", {sum(result[stage]['allocations'] for stage in STAGES)} allocs"
+                + f", peak rss {result['peak_rss'] / 1e6:.1f} MB"
+                + f", gcc {result['gcc_seconds']:.3f}s -> {result['total_seconds']:.3f}s"
+            )
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+    if args.baseline:
+        with open(args.baseline, "r") as f:
+            baseline = json.load(f)
+        if compare(results, baseline, args.threshold) > 0:
+            sys.exit(1)
+
+main()
@@ -0,0 +1,229 @@
+// wyrm-bench-analysis: times the bimple cfg and dataflow analyses on large synthetic cfgs
+//
+// usage: wyrm-bench-analysis [--shape diamonds|loops|random] [--size N] [--repeat N]
+// Without --shape every shape is run, without --size each shape runs at 1k, 10k, 20k, and 100k blocks so the scaling
+// is visible in the ns/block column. Every block defines a value, so the dataflow sets grow with the function too:
+// their cost is reported per block and 64-bit set word, and they're skipped above 20k blocks where the dense sets alone
+// take gigabytes.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_analysis.h"
+#include "bimple_builder.h"
+#include "bimple_dataflow.h"
+
+using namespace bimple;
+
+[[noreturn]] static void usage() {
+    fmt::print(stderr, "usage: wyrm-bench-analysis [--shape diamonds|loops|random] [--size N] [--repeat N]\n");
+    std::exit(2);
+}
+
+static std::unique_ptr<atom> constant(int value) {
+    return make_constant(value, make_integer(32, false));
+}
+
+// a value per block, chained through the previous block's value so live ranges cross blocks
+static void define(builder& b, std::unique_ptr<variable>& last) {
+    last = b.binary(operators::add, last->clone(), constant(1));
+}
+
+// a chain of if/else diamonds, lots of join points for the dominance frontiers
+static function diamonds(int size) {
+    builder b("diamonds", make_integer(32, false));
+    auto x = b.add_argument("x", make_integer(32, false));
+    auto last = b.add_argument("y", make_integer(32, false));
+    int from = 0;
+    for(int i = 0; i < size / 3; i++) {
+        int then_block = b.create_block();
+        int else_block = b.create_block();
+        int join = b.create_block();
+        b.set_block(from);
+        define(b, last);
+        b.cond_br(operators::lt, x->clone(), constant(i), then_block, else_block);
+        b.set_block(then_block);
+        define(b, last);
+        b.br(join);
+        b.set_block(else_block);
+        define(b, last);
+        b.br(join);
+        from = join;
+    }
+    b.set_block(from);
+    b.ret(last->clone());
+    return std::move(b).finish();
+}
+
+// nests of 4 loops one after another, inner exits continue the enclosing loop
+static function loops(int size) {
+    constexpr int depth = 4;
+    builder b("loops", make_integer(32, false));
+    auto x = b.add_argument("x", make_integer(32, false));
+    auto last = b.add_argument("y", make_integer(32, false));
+    int from = 0;
+    for(int i = 0; i < size / (2 * depth + 1); i++) {
+        std::vector<int> headers, exits;
+        for(int d = 0; d < depth; d++) {
+            headers.push_back(b.create_block());
+            exits.push_back(b.create_block());
+        }
+        int body = b.create_block();
+        b.set_block(from);
+        define(b, last);
+        b.br(headers[0]);
+        for(int d = 0; d < depth; d++) {
+            b.set_block(headers[d]);
+            define(b, last);
+            b.cond_br(operators::lt, x->clone(), constant(d), d + 1 < depth ? headers[d + 1] : body, exits[d]);
+        }
+        b.set_block(body);
+        define(b, last);
+        b.br(headers[depth - 1]);
+        for(int d = 1; d < depth; d++) {
+            b.set_block(exits[d]);
+            define(b, last);
+            b.br(headers[d - 1]);
+        }
+        from = exits[0];
+    }
+    b.set_block(from);
+    b.ret(last->clone());
+    return std::move(b).finish();
+}
+
+// random edges, mostly forward with some back edges and irreducible regions
+static function random_cfg(int size) {
+    builder b("random", make_integer(32, false));
+    auto x = b.add_argument("x", make_integer(32, false));
+    auto last = b.add_argument("y", make_integer(32, false));
+    std::vector<int> blocks;
+    for(int i = 0; i < size; i++) {
+        blocks.push_back(b.create_block());
+    }
+    std::mt19937 rng(42);
+    auto target = [&](int i) {
+        // within 16 blocks, one in eight edges goes backwards
+        int distance = int(rng() % 16) + 1;
+        int j = rng() % 8 == 0 ? i - distance : i + distance;
+        return blocks[std::clamp(j, 0, size - 1)];
+    };
+    b.set_block(0);
+    b.br(blocks[0]);
+    for(int i = 0; i < size; i++) {
+        b.set_block(blocks[i]);
+        define(b, last);
+        if(i == size - 1) {
+            b.ret(last->clone());
+        } else if(rng() % 4 == 0) {
+            b.br(target(i));
+        } else {
+            b.cond_br(operators::lt, x->clone(), constant(i), blocks[i + 1], target(i));
+        }
+    }
+    return std::move(b).finish();
+}
+
+int main(int argc, char** argv) {
+    std::optional<std::string> only;
+    std::vector<int> sizes = {1000, 10000, 20000, 100000};
+    unsigned repeat = 5;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto next = [&] () -> std::string {
+            if(i + 1 >= argc) {
+                usage();
+            }
+            return argv[++i];
+        };
+        if(arg == "--shape") {
+            only = next();
+        } else if(arg == "--size") {
+            sizes = {std::max(1, std::stoi(next()))};
+        } else if(arg == "--repeat") {
+            repeat = std::max(1ul, std::stoul(next()));
+        } else {
+            usage();
+        }
+    }
+
+    struct shape {
+        std::string_view name;
+        function (*generate)(int);
+    };
+    const shape shapes[] = {{"diamonds", diamonds}, {"loops", loops}, {"random", random_cfg}};
+    if(only && std::none_of(std::begin(shapes), std::end(shapes), [&](const shape& s) { return s.name == *only; })) {
+        usage();
+    }
+
+    using clock = std::chrono::steady_clock;
+    // fastest of the repetitions
+    auto measure = [&](const std::function<void()>& f) {
+        clock::duration best = clock::duration::max();
+        for(unsigned r = 0; r < repeat; r++) {
+            auto start = clock::now();
+            f();
+            best = std::min(best, clock::now() - start);
+        }
+        return std::chrono::duration<double, std::milli>(best).count();
+    };
+    for(const auto& shape : shapes) {
+        if(only && shape.name != *only) {
+            continue;
+        }
+        for(int size : sizes) {
+            auto fn = shape.generate(size);
+            auto cfg = compute_cfg(fn);
+            auto dominators = compute_dominators(fn, cfg);
+            std::size_t loop_count = compute_loops(fn, cfg, dominators).loops.size();
+            double cfg_ms = measure([&] { compute_cfg(fn); });
+            double dominators_ms = measure([&] { compute_dominators(fn, cfg); });
+            double frontiers_ms = measure([&] { compute_frontiers(fn, cfg, dominators); });
+            double loops_ms = measure([&] { compute_loops(fn, cfg, dominators); });
+            double total = cfg_ms + dominators_ms + frontiers_ms + loops_ms;
+            fmt::print(
+                "{} {} blocks ({} loops): cfg {:.3f} ms, dominators {:.3f} ms, frontiers {:.3f} ms, loops {:.3f} ms, "
+                "{:.1f} ns/block\n",
+                shape.name,
+                fn.basic_blocks.size(),
+                loop_count,
+                cfg_ms,
+                dominators_ms,
+                frontiers_ms,
+                loops_ms,
+                total * 1e6 / double(fn.basic_blocks.size())
+            );
+            if(fn.basic_blocks.size() > 20000) {
+                continue;
+            }
+            auto live = compute_liveness(fn, cfg);
+            unsigned reaching_iterations = compute_reaching_definitions(fn, cfg).sets.iterations;
+            double liveness_ms = measure([&] { compute_liveness(fn, cfg); });
+            double reaching_ms = measure([&] { compute_reaching_definitions(fn, cfg); });
+            double block_words = double(fn.basic_blocks.size()) * double(live.sets.in.words_per_block());
+            fmt::print(
+                "{} {} blocks ({} values): liveness {:.3f} ms ({} passes), reaching definitions {:.3f} ms ({} passes), "
+                "{:.1f} ns/block, {:.2f} ns/block/word\n",
+                shape.name,
+                fn.basic_blocks.size(),
+                live.values.size(),
+                liveness_ms,
+                live.sets.iterations,
+                reaching_ms,
+                reaching_iterations,
+                (liveness_ms + reaching_ms) * 1e6 / double(fn.basic_blocks.size()),
+                (liveness_ms + reaching_ms) * 1e6 / block_words
+            );
+        }
+    }
+}
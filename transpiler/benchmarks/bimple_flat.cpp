@@ -0,0 +1,218 @@
+// wyrm-bench-flat: compares the pointer form of bimple with the flat structure-of-arrays form
+//
+// usage: wyrm-bench-flat [--blocks N] [--repeat N]
+// Builds one function with N blocks of arithmetic, stores, calls, and phis, then times a walk over every operand of each
+// form and flatten itself, next to codegen of the pointer form for scale. Copies of the function are made by serializing
+// it so they aren't timed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_builder.h"
+#include "bimple_serialization.h"
+#include "llvm_codegen.h"
+
+#include "flat.h"
+
+using namespace bimple;
+
+[[noreturn]] static void usage() {
+    fmt::print(stderr, "usage: wyrm-bench-flat [--blocks N] [--repeat N]\n");
+    std::exit(2);
+}
+
+static std::unique_ptr<type> i32() {
+    return make_integer(32, false);
+}
+
+// a chain of blocks that each branch to the next or to an exit, every value flows on through a phi
+static function make_function(int blocks) {
+    std::mt19937 rng(42);
+    builder b("flat", i32());
+    auto p = b.add_argument("p", make_pointer(i32()));
+    auto x = b.add_argument("x", i32());
+    std::vector<std::unique_ptr<type>> params;
+    params.push_back(i32());
+    params.push_back(i32());
+    auto callee = std::make_unique<addr_expr>(
+        "g",
+        make_pointer(std::make_unique<function_type>(i32(), std::move(params)))
+    );
+    int exit = b.create_block();
+    std::unique_ptr<atom> carried = x->clone();
+    int previous = 0;
+    for(int i = 0; i < blocks; i++) {
+        int next = b.create_block();
+        b.set_block(next);
+        std::vector<std::pair<int, std::unique_ptr<atom>>> values;
+        values.emplace_back(previous, carried->clone());
+        std::unique_ptr<atom> v = b.phi(i32(), std::move(values));
+        for(int j = 0; j < 6; j++) {
+            static constexpr operators ops[] = {operators::add, operators::mul, operators::bit_xor, operators::sub};
+            v = b.binary(ops[rng() % 4], std::move(v), rng() % 2 ? x->clone() : make_constant(int(rng() % 100), i32()));
+        }
+        if(rng() % 4 == 0) {
+            std::vector<std::unique_ptr<atom>> args;
+            args.push_back(v->clone());
+            args.push_back(x->clone());
+            v = b.call(callee->clone(), std::move(args));
+        }
+        b.store(p->clone(), int(rng() % 16) * 4, v->clone());
+        carried = b.unary(operators::assign, std::move(v));
+        b.set_block(previous);
+        if(previous == 0) {
+            b.br(next);
+        } else {
+            b.cond_br(operators::lt, carried->clone(), x->clone(), next, exit);
+        }
+        previous = next;
+    }
+    b.set_block(previous);
+    b.ret(carried->clone());
+    b.set_block(exit);
+    b.ret(x->clone());
+    return std::move(b).finish();
+}
+
+static std::size_t atom_work(const std::unique_ptr<atom>& a) {
+    if(!a) {
+        return 0;
+    }
+    return visit(a, [] (const auto& derived) -> std::size_t {
+        using T = std::remove_cvref_t<decltype(derived)>;
+        if constexpr(std::is_same_v<T, mem_ref>) {
+            return atom_work(derived.base) + atom_work(derived.offset);
+        } else {
+            return derived.type->size;
+        }
+    });
+}
+
+// touches every operand of every statement and phi
+static std::size_t walk(const function& fn) {
+    std::size_t work = 0;
+    for(const auto& bb : fn.basic_blocks) {
+        for(const auto& phi : bb.phis) {
+            work += phi.result.type->size;
+            for(const auto& [block, value] : phi.values) {
+                work += atom_work(value);
+            }
+        }
+        for(const auto& s : bb.statements) {
+            for_each_use(*s, [&] (const std::unique_ptr<atom>& a, bool) {
+                work += atom_work(a);
+            });
+            if(auto* def = defined_variable(*s)) {
+                work += def->type->size;
+            }
+        }
+    }
+    return work;
+}
+
+static std::size_t walk(const flat_function& fn) {
+    std::size_t work = 0;
+    auto operand_work = [&] (operand handle) -> std::size_t {
+        return handle == no_operand ? 0 : atom_work(fn.get(handle));
+    };
+    for(const auto& bb : fn.blocks) {
+        for(const auto& phi : fn.phis_of(bb)) {
+            work += fn.get(phi.result)->type->size;
+            for(const auto& incoming : fn.incoming_of(phi)) {
+                work += operand_work(incoming.value);
+            }
+        }
+        for(const auto& instruction : fn.instructions_of(bb)) {
+            for(auto handle : instruction.operands) {
+                work += operand_work(handle);
+            }
+            for(auto handle : fn.arguments_of(instruction)) {
+                work += operand_work(handle);
+            }
+        }
+    }
+    return work;
+}
+
+int main(int argc, char** argv) {
+    int blocks = 20000;
+    unsigned repeat = 5;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto next = [&] () -> std::string {
+            if(i + 1 >= argc) {
+                usage();
+            }
+            return argv[++i];
+        };
+        if(arg == "--blocks") {
+            blocks = std::max(1, std::stoi(next()));
+        } else if(arg == "--repeat") {
+            repeat = std::max(1ul, std::stoul(next()));
+        } else {
+            usage();
+        }
+    }
+
+    serializer s;
+    s.add(make_function(blocks));
+    auto bytes = s.finish();
+    serialized_module module(bytes);
+    auto fn = module.load(0);
+    auto flat = flatten(module.load(0));
+
+    using clock = std::chrono::steady_clock;
+    // fastest of the repetitions in ms, prepare makes whatever the timed part consumes
+    auto measure = [&](auto prepare, auto timed) {
+        clock::duration best = clock::duration::max();
+        for(unsigned r = 0; r < repeat; r++) {
+            auto input = prepare();
+            auto start = clock::now();
+            timed(input);
+            best = std::min(best, clock::now() - start);
+        }
+        return std::chrono::duration<double, std::milli>(best).count();
+    };
+    auto nothing = [] { return 0; };
+    // the result is kept in the pair so destroying it isn't timed
+    auto copy = [&] { return std::pair(module.load(0), flat_function()); };
+
+    std::size_t pointer_work = 0;
+    std::size_t flat_work = 0;
+    double pointer_walk = measure(nothing, [&] (int) { pointer_work = walk(fn); });
+    double flat_walk = measure(nothing, [&] (int) { flat_work = walk(flat); });
+    if(pointer_work != flat_work) {
+        fmt::print(stderr, "walk mismatch: {} != {}\n", pointer_work, flat_work);
+        return 1;
+    }
+    std::string ir;
+    double codegen = measure(nothing, [&] (int) { ir = llvm_codegen().generate(fn); });
+    double flatten_time = measure(copy, [&] (std::pair<function, flat_function>& input) {
+        input.second = flatten(std::move(input.first));
+    });
+
+    std::size_t statements = 0;
+    for(const auto& bb : fn.basic_blocks) {
+        statements += bb.statements.size() + bb.phis.size();
+    }
+    fmt::print("{} blocks, {} statements and phis\n", fn.basic_blocks.size(), statements);
+    fmt::print(
+        "  operand walk: pointer {:.2f} ms, flat {:.2f} ms ({:.2f}x)\n",
+        pointer_walk,
+        flat_walk,
+        pointer_walk / flat_walk
+    );
+    fmt::print("  flatten:      {:.2f} ms, codegen {:.2f} ms\n", flatten_time, codegen);
+}
@@ -0,0 +1,263 @@
+// wyrm-bench-visit: compares dispatching over bimple nodes with bimple::visit against a chain of downcasts
+//
+// usage: wyrm-bench-visit [--size N] [--repeat N]
+// Both walk the same randomly mixed statements and their atoms and do the same trivial work per node, so the difference
+// is the dispatch. The chain tests tags in the order the old codegen did. Keep --size large, with a few thousand
+// statements the branch predictor learns the whole sequence and flatters the chain of compares.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string_view>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_builder.h"
+
+using namespace bimple;
+
+[[noreturn]] static void usage() {
+    fmt::print(stderr, "usage: wyrm-bench-visit [--size N] [--repeat N]\n");
+    std::exit(2);
+}
+
+// a mix of every statement kind with variable, constant, and memory operands
+static std::vector<std::unique_ptr<statement>> make_statements(int size) {
+    std::mt19937 rng(42);
+    auto var = [&] {
+        return std::make_unique<variable>("v" + std::to_string(rng() % 100), make_integer(32, false));
+    };
+    auto memory = [&] {
+        return std::make_unique<mem_ref>(var(), make_constant(0, make_integer(64, false)), make_integer(32, false));
+    };
+    auto operand = [&] () -> std::unique_ptr<atom> {
+        switch(rng() % 10) {
+            case 0: return make_constant(int(rng() % 100), make_integer(32, false));
+            case 1: return memory();
+            case 2: return std::make_unique<component_ref>(memory(), unsigned(rng() % 4), make_integer(32, false));
+            case 3: return std::make_unique<array_ref>(memory(), var(), make_integer(32, false));
+            case 4:
+                return std::make_unique<address_of>(
+                    std::make_unique<array_ref>(memory(), var(), make_integer(32, false)),
+                    make_pointer(make_integer(32, false))
+                );
+            case 5: return std::make_unique<zero_initializer>(make_integer(32, false));
+            case 6: return std::make_unique<local_ref>("l" + std::to_string(rng() % 10), make_integer(32, false));
+            case 7: return std::make_unique<global_ref>("g" + std::to_string(rng() % 10), make_integer(32, false));
+            default: return var();
+        }
+    };
+    std::vector<std::unique_ptr<statement>> statements;
+    for(int i = 0; i < size; i++) {
+        switch(rng() % 6) {
+            case 0:
+                statements.push_back(std::make_unique<binary_assignment>(var(), operand(), operand(), operators::add));
+                break;
+            case 1:
+                statements.push_back(std::make_unique<unary_assignment>(var(), operand(), operators::assign));
+                break;
+            case 2:
+                statements.push_back(std::make_unique<cond>(operand(), operand(), operators::lt));
+                break;
+            case 3:
+                statements.push_back(std::make_unique<function_return>(operand()));
+                break;
+            case 4:
+                {
+                    std::vector<std::unique_ptr<atom>> args;
+                    args.push_back(operand());
+                    statements.push_back(std::make_unique<intrinsic_call>(intrinsics::popcount, var(), std::move(args)));
+                }
+                break;
+            default:
+                {
+                    std::vector<std::unique_ptr<atom>> args;
+                    args.push_back(operand());
+                    args.push_back(operand());
+                    statements.push_back(
+                        std::make_unique<call>(
+                            std::make_unique<addr_expr>("f", make_pointer(make_integer(32, false))),
+                            var(),
+                            std::move(args)
+                        )
+                    );
+                }
+        }
+    }
+    return statements;
+}
+
+static std::size_t atom_work_chain(const std::unique_ptr<atom>& a) {
+    if(auto* ptr = downcast<variable>(a)) {
+        return ptr->name.size();
+    } else if(auto* ptr = downcast<addr_expr>(a)) {
+        return ptr->name.size() + 1;
+    } else if(auto* ptr = downcast<integer_constant>(a)) {
+        return std::size_t(ptr->value);
+    } else if(auto* ptr = downcast<real_constant>(a)) {
+        return ptr->value.size();
+    } else if(auto* ptr = downcast<mem_ref>(a)) {
+        return atom_work_chain(ptr->base) + atom_work_chain(ptr->offset);
+    } else if(auto* ptr = downcast<component_ref>(a)) {
+        return atom_work_chain(ptr->base) + ptr->field;
+    } else if(auto* ptr = downcast<array_ref>(a)) {
+        return atom_work_chain(ptr->base) + atom_work_chain(ptr->index);
+    } else if(auto* ptr = downcast<address_of>(a)) {
+        return atom_work_chain(ptr->reference) + 1;
+    } else if(downcast<zero_initializer>(a)) {
+        return 2;
+    } else if(auto* ptr = downcast<local_ref>(a)) {
+        return ptr->name.size() + 2;
+    } else if(auto* ptr = downcast<global_ref>(a)) {
+        return ptr->name.size() + 3;
+    } else {
+        std::abort();
+    }
+}
+
+static std::size_t statement_work_chain(const std::unique_ptr<statement>& s) {
+    if(auto* ptr = downcast<unary_assignment>(s)) {
+        return atom_work_chain(ptr->lhs) + atom_work_chain(ptr->rhs);
+    } else if(auto* ptr = downcast<binary_assignment>(s)) {
+        return atom_work_chain(ptr->lhs) + atom_work_chain(ptr->rhs1) + atom_work_chain(ptr->rhs2);
+    } else if(auto* ptr = downcast<cond>(s)) {
+        return atom_work_chain(ptr->lhs) + atom_work_chain(ptr->rhs);
+    } else if(auto* ptr = downcast<function_return>(s)) {
+        return ptr->value ? atom_work_chain(ptr->value) : 0;
+    } else if(auto* ptr = downcast<call>(s)) {
+        std::size_t work = atom_work_chain(ptr->fn) + atom_work_chain(ptr->lhs);
+        for(const auto& arg : ptr->args) {
+            work += atom_work_chain(arg);
+        }
+        return work;
+    } else if(auto* ptr = downcast<intrinsic_call>(s)) {
+        std::size_t work = ptr->lhs ? atom_work_chain(ptr->lhs) : 0;
+        for(const auto& arg : ptr->args) {
+            work += atom_work_chain(arg);
+        }
+        return work;
+    } else if(auto* ptr = downcast<switch_branch>(s)) {
+        return atom_work_chain(ptr->index) + ptr->cases.size();
+    } else {
+        std::abort();
+    }
+}
+
+static std::size_t atom_work_visit(const std::unique_ptr<atom>& a) {
+    return visit(a, [] (const auto& derived) -> std::size_t {
+        using T = std::remove_cvref_t<decltype(derived)>;
+        if constexpr(std::is_same_v<T, variable>) {
+            return derived.name.size();
+        } else if constexpr(std::is_same_v<T, addr_expr>) {
+            return derived.name.size() + 1;
+        } else if constexpr(std::is_same_v<T, integer_constant>) {
+            return std::size_t(derived.value);
+        } else if constexpr(std::is_same_v<T, real_constant>) {
+            return derived.value.size();
+        } else if constexpr(std::is_same_v<T, mem_ref>) {
+            return atom_work_visit(derived.base) + atom_work_visit(derived.offset);
+        } else if constexpr(std::is_same_v<T, component_ref>) {
+            return atom_work_visit(derived.base) + derived.field;
+        } else if constexpr(std::is_same_v<T, array_ref>) {
+            return atom_work_visit(derived.base) + atom_work_visit(derived.index);
+        } else if constexpr(std::is_same_v<T, address_of>) {
+            return atom_work_visit(derived.reference) + 1;
+        } else if constexpr(std::is_same_v<T, zero_initializer>) {
+            return 2;
+        } else if constexpr(std::is_same_v<T, local_ref>) {
+            return derived.name.size() + 2;
+        } else {
+            static_assert(std::is_same_v<T, global_ref>);
+            return derived.name.size() + 3;
+        }
+    });
+}
+
+static std::size_t statement_work_visit(const std::unique_ptr<statement>& s) {
+    return visit(s, [] (const auto& derived) -> std::size_t {
+        using T = std::remove_cvref_t<decltype(derived)>;
+        if constexpr(std::is_same_v<T, unary_assignment>) {
+            return atom_work_visit(derived.lhs) + atom_work_visit(derived.rhs);
+        } else if constexpr(std::is_same_v<T, binary_assignment>) {
+            return atom_work_visit(derived.lhs) + atom_work_visit(derived.rhs1) + atom_work_visit(derived.rhs2);
+        } else if constexpr(std::is_same_v<T, cond>) {
+            return atom_work_visit(derived.lhs) + atom_work_visit(derived.rhs);
+        } else if constexpr(std::is_same_v<T, function_return>) {
+            return derived.value ? atom_work_visit(derived.value) : 0;
+        } else if constexpr(std::is_same_v<T, call>) {
+            std::size_t work = atom_work_visit(derived.fn) + atom_work_visit(derived.lhs);
+            for(const auto& arg : derived.args) {
+                work += atom_work_visit(arg);
+            }
+            return work;
+        } else if constexpr(std::is_same_v<T, switch_branch>) {
+            return atom_work_visit(derived.index) + derived.cases.size();
+        } else {
+            static_assert(std::is_same_v<T, intrinsic_call>);
+            std::size_t work = derived.lhs ? atom_work_visit(derived.lhs) : 0;
+            for(const auto& arg : derived.args) {
+                work += atom_work_visit(arg);
+            }
+            return work;
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    int size = 100000;
+    unsigned repeat = 20;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto next = [&] () -> std::string {
+            if(i + 1 >= argc) {
+                usage();
+            }
+            return argv[++i];
+        };
+        if(arg == "--size") {
+            size = std::max(1, std::stoi(next()));
+        } else if(arg == "--repeat") {
+            repeat = std::max(1ul, std::stoul(next()));
+        } else {
+            usage();
+        }
+    }
+
+    auto statements = make_statements(size);
+    using clock = std::chrono::steady_clock;
+    // fastest of the repetitions, the checksum keeps the walk from being optimized out
+    auto measure = [&](std::size_t (*work)(const std::unique_ptr<statement>&), std::size_t& checksum) {
+        clock::duration best = clock::duration::max();
+        for(unsigned r = 0; r < repeat; r++) {
+            auto start = clock::now();
+            std::size_t sum = 0;
+            for(const auto& s : statements) {
+                sum += work(s);
+            }
+            best = std::min(best, clock::now() - start);
+            checksum = sum;
+        }
+        return std::chrono::duration<double, std::nano>(best).count() / double(statements.size());
+    };
+    std::size_t chain_checksum = 0;
+    std::size_t visit_checksum = 0;
+    double chain_ns = measure(statement_work_chain, chain_checksum);
+    double visit_ns = measure(statement_work_visit, visit_checksum);
+    if(chain_checksum != visit_checksum) {
+        fmt::print(stderr, "checksum mismatch: {} != {}\n", chain_checksum, visit_checksum);
+        return 1;
+    }
+    fmt::print(
+        "{} statements: downcast chain {:.2f} ns/statement, visit {:.2f} ns/statement ({:.2f}x)\n",
+        statements.size(),
+        chain_ns,
+        visit_ns,
+        chain_ns / visit_ns
+    );
+}
@@ -0,0 +1,240 @@
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+
+#include "bimple.h"
+#include "flat.h"
+
+namespace bimple {
+    const std::unique_ptr<atom>& flat_function::get(operand handle) const {
+        std::uint32_t index = index_of(handle);
+        switch(kind_of(handle)) {
+            case operand_kind::value: return values[index];
+            case operand_kind::constant: return constants[index];
+            case operand_kind::global: return globals[index];
+            case operand_kind::memory: return memory[index];
+            default:
+                VERIFY(false, "Invalid operand", handle);
+                __builtin_unreachable();
+        }
+    }
+
+    std::span<const flat_instruction> flat_function::instructions_of(const flat_block& block) const {
+        return std::span(instructions).subspan(block.instruction_begin, block.instruction_count);
+    }
+
+    std::span<const flat_phi> flat_function::phis_of(const flat_block& block) const {
+        return std::span(phis).subspan(block.phi_begin, block.phi_count);
+    }
+
+    std::span<const flat_incoming> flat_function::incoming_of(const flat_phi& phi) const {
+        return std::span(incoming).subspan(phi.incoming_begin, phi.incoming_count);
+    }
+
+    std::span<const int> flat_function::successors(const flat_block& block) const {
+        return std::span(successor_list).subspan(block.successor_begin, block.successor_count);
+    }
+
+    std::span<const operand> flat_function::arguments_of(const flat_instruction& instruction) const {
+        return std::span(call_arguments).subspan(instruction.arguments_begin, instruction.arguments_count);
+    }
+
+    namespace {
+        class flattener {
+            flat_function& flat;
+            // a name and an interned type, copy propagation leaves uses with their own type so a name can be used with
+            // more than one (e.g. a sign-changing copy)
+            using value_key = std::pair<std::string_view, std::uint32_t>;
+            struct value_key_hash {
+                std::size_t operator()(const value_key& key) const {
+                    return std::hash<std::string_view>{}(key.first) * 31 + key.second;
+                }
+            };
+            // keys point into the names of the variables in flat.values
+            std::unordered_map<value_key, std::uint32_t, value_key_hash> value_ids;
+
+            static operand append(std::vector<std::unique_ptr<atom>>& table, operand_kind kind, std::unique_ptr<atom>&& a) {
+                VERIFY(table.size() < (std::size_t(1) << operand_index_bits), "Too many operands");
+                table.push_back(std::move(a));
+                return make_operand(kind, std::uint32_t(table.size() - 1));
+            }
+        public:
+            flattener(flat_function& flat) : flat(flat) {}
+
+            // type::operator== is loose about reals and function types, integers are the common case and compare
+            // exactly, the rest compare by their spelling
+            static bool same_type(const type& a, const type& b) {
+                if(a.tag != b.tag || a.size != b.size) {
+                    return false;
+                }
+                return a.tag == type_tag::integer ? a == b : a.to_string() == b.to_string();
+            }
+
+            // a function only uses a handful of distinct types, a linear search is cheaper than hashing them
+            std::uint32_t intern_type(const type& t) {
+                for(std::size_t i = 0; i < flat.types.size(); i++) {
+                    if(same_type(*flat.types[i], t)) {
+                        return std::uint32_t(i);
+                    }
+                }
+                flat.types.push_back(t.clone());
+                return std::uint32_t(flat.types.size() - 1);
+            }
+
+            operand add_value(std::string&& name, std::unique_ptr<type>&& t) {
+                return add(std::make_unique<variable>(std::move(name), std::move(t)));
+            }
+
+            operand add(std::unique_ptr<atom>&& a) {
+                if(!a) {
+                    return no_operand;
+                }
+                switch(a->tag) {
+                    case atom_tag::variable:
+                        {
+                            auto* var = downcast<variable>(a);
+                            value_key key{std::string_view(var->name), intern_type(*var->type)};
+                            auto [it, inserted] = value_ids.insert({key, std::uint32_t(flat.values.size())});
+                            if(!inserted) {
+                                return make_operand(operand_kind::value, it->second);
+                            }
+                            return append(flat.values, operand_kind::value, std::move(a));
+                        }
+                    case atom_tag::integer_constant:
+                    case atom_tag::real_constant:
+                    case atom_tag::zero_initializer:
+                        return append(flat.constants, operand_kind::constant, std::move(a));
+                    case atom_tag::addr_expr:
+                        return append(flat.globals, operand_kind::global, std::move(a));
+                    case atom_tag::mem_ref:
+                    case atom_tag::component_ref:
+                    case atom_tag::array_ref:
+                    case atom_tag::address_of:
+                    case atom_tag::local_ref:
+                    case atom_tag::global_ref:
+                        return append(flat.memory, operand_kind::memory, std::move(a));
+                    default:
+                        VERIFY(false, "Unhandled atom", a->tag);
+                        __builtin_unreachable();
+                }
+            }
+
+            // the type of an assigned ssa value
+            std::uint32_t result_type(const std::unique_ptr<atom>& lhs) {
+                return lhs && lhs->tag == atom_tag::variable ? intern_type(*lhs->type) : no_type;
+            }
+
+            void add_arguments(flat_instruction& instruction, std::vector<std::unique_ptr<atom>>& args) {
+                instruction.arguments_begin = std::uint32_t(flat.call_arguments.size());
+                instruction.arguments_count = std::uint32_t(args.size());
+                for(auto& arg : args) {
+                    flat.call_arguments.push_back(add(std::move(arg)));
+                }
+            }
+
+            flat_instruction add(statement& s) {
+                flat_instruction instruction{
+                    s.tag,
+                    operators::assign,
+                    fp_flags::none,
+                    no_type,
+                    {no_operand, no_operand, no_operand},
+                    0,
+                    0
+                };
+                visit(s, [&] (auto& derived) {
+                    using T = std::remove_cvref_t<decltype(derived)>;
+                    if constexpr(std::is_same_v<T, binary_assignment>) {
+                        instruction.op = derived.op;
+                        instruction.flags = derived.flags;
+                        instruction.type = result_type(derived.lhs);
+                        instruction.operands[0] = add(std::move(derived.lhs));
+                        instruction.operands[1] = add(std::move(derived.rhs1));
+                        instruction.operands[2] = add(std::move(derived.rhs2));
+                    } else if constexpr(std::is_same_v<T, unary_assignment> || std::is_same_v<T, cond>) {
+                        instruction.op = derived.op;
+                        if constexpr(std::is_same_v<T, unary_assignment>) {
+                            instruction.flags = derived.flags;
+                            instruction.type = result_type(derived.lhs);
+                        }
+                        instruction.operands[0] = add(std::move(derived.lhs));
+                        instruction.operands[1] = add(std::move(derived.rhs));
+                    } else if constexpr(std::is_same_v<T, call>) {
+                        instruction.type = result_type(derived.lhs);
+                        instruction.operands[0] = add(std::move(derived.lhs));
+                        instruction.operands[1] = add(std::move(derived.fn));
+                        add_arguments(instruction, derived.args);
+                    } else if constexpr(std::is_same_v<T, intrinsic_call>) {
+                        instruction.intrinsic = derived.id;
+                        instruction.flags = derived.flags;
+                        instruction.type = result_type(derived.lhs);
+                        instruction.operands[0] = add(std::move(derived.lhs));
+                        add_arguments(instruction, derived.args);
+                    } else if constexpr(std::is_same_v<T, function_return>) {
+                        instruction.operands[0] = add(std::move(derived.value));
+                    } else if constexpr(std::is_same_v<T, switch_branch>) {
+                        // the cases aren't kept, only the operand
+                        instruction.operands[0] = add(std::move(derived.index));
+                    }
+                });
+                return instruction;
+            }
+        };
+    }
+
+    flat_function flatten(function&& fn) {
+        flat_function flat;
+        flattener f(flat);
+        flat.identifier = std::move(fn.identifier);
+        flat.return_type = f.intern_type(*fn.return_type);
+        for(auto& [name, type] : fn.args) {
+            flat.args.push_back(f.add_value(std::move(name), std::move(type)));
+        }
+        flat.locals = std::move(fn.locals);
+        flat.global_variables = std::move(fn.globals);
+        flat.blocks.reserve(fn.basic_blocks.size());
+        for(auto& bb : fn.basic_blocks) {
+            ASSERT(std::size_t(bb.index) == flat.blocks.size());
+            flat_block block{
+                bb.index,
+                std::uint32_t(flat.phis.size()),
+                std::uint32_t(bb.phis.size()),
+                std::uint32_t(flat.instructions.size()),
+                std::uint32_t(bb.statements.size()),
+                std::uint32_t(flat.successor_list.size()),
+                std::uint32_t(bb.successors.size())
+            };
+            for(auto& phi : bb.phis) {
+                flat_phi record{
+                    f.add_value(std::move(phi.result.name), std::move(phi.result.type)),
+                    std::uint32_t(flat.incoming.size()),
+                    std::uint32_t(phi.values.size())
+                };
+                for(auto& [block_index, value] : phi.values) {
+                    flat.incoming.push_back({block_index, f.add(std::move(value))});
+                }
+                flat.phis.push_back(record);
+            }
+            for(auto& statement : bb.statements) {
+                flat.instructions.push_back(f.add(*statement));
+            }
+            flat.successor_list.insert(flat.successor_list.end(), bb.successors.begin(), bb.successors.end());
+            flat.blocks.push_back(block);
+        }
+        flat.topological = std::move(fn.topological);
+        return flat;
+    }
+}
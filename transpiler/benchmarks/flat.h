@@ -0,0 +1,123 @@
+#ifndef FLAT_H
+#define FLAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "bimple.h"
+
+// Structure-of-arrays form of a bimple function for read-only walks over its operands. Instructions are fixed-size
+// records in one array per function and name their operands with 32-bit handles, the top bits of a handle say which
+// table it indexes (ssa values, constants, global addresses, or memory references and their addresses) and the rest is
+// the index. An ssa value is stored once per type it's used with, however often it's used, and result types are
+// interned, so a walk over a block reads contiguous records and a few small tables instead of a tree of heap atoms per
+// statement. Blocks, phis, and successors are ranges into shared arrays like the analyses' lists.
+namespace bimple {
+    using operand = std::uint32_t;
+
+    enum class operand_kind : std::uint32_t {
+        none,
+        value,
+        constant,
+        global,
+        memory
+    };
+
+    constexpr unsigned operand_kind_bits = 3;
+    constexpr unsigned operand_index_bits = 32 - operand_kind_bits;
+    constexpr operand no_operand = 0;
+
+    constexpr operand make_operand(operand_kind kind, std::uint32_t index) {
+        return std::uint32_t(kind) << operand_index_bits | index;
+    }
+
+    constexpr operand_kind kind_of(operand handle) {
+        return operand_kind(handle >> operand_index_bits);
+    }
+
+    constexpr std::uint32_t index_of(operand handle) {
+        return handle & ((std::uint32_t(1) << operand_index_bits) - 1);
+    }
+
+    constexpr std::uint32_t no_type = UINT32_MAX;
+
+    struct flat_instruction {
+        statement_tag opcode;
+        // operator of assignments and conds, intrinsic of intrinsic calls
+        union {
+            operators op;
+            intrinsics intrinsic;
+        };
+        // of floating point assignments and math intrinsics
+        fp_flags flags;
+        // type of the assigned value, no_type for stores, branches, returns, and calls without a result
+        std::uint32_t type;
+        // binary assignments: lhs, rhs1, rhs2, unary assignments and conds: lhs, rhs, calls: lhs, callee, intrinsic
+        // calls: lhs, returns: value. Call results may be no_operand.
+        operand operands[3];
+        // call and intrinsic arguments, a range of flat_function::call_arguments
+        std::uint32_t arguments_begin;
+        std::uint32_t arguments_count;
+    };
+
+    struct flat_incoming {
+        int block;
+        operand value;
+    };
+
+    struct flat_phi {
+        operand result;
+        std::uint32_t incoming_begin;
+        std::uint32_t incoming_count;
+    };
+
+    struct flat_block {
+        int index;
+        std::uint32_t phi_begin;
+        std::uint32_t phi_count;
+        std::uint32_t instruction_begin;
+        std::uint32_t instruction_count;
+        std::uint32_t successor_begin;
+        std::uint32_t successor_count;
+    };
+
+    struct flat_function {
+        std::string identifier;
+        std::uint32_t return_type;
+        // value handles
+        std::vector<operand> args;
+        std::vector<local> locals;
+        // function::globals, the globals table holds the addr_expr atoms
+        std::vector<global> global_variables;
+        std::vector<std::unique_ptr<type>> types;
+        std::vector<std::unique_ptr<atom>> values;
+        std::vector<std::unique_ptr<atom>> constants;
+        std::vector<std::unique_ptr<atom>> globals;
+        std::vector<std::unique_ptr<atom>> memory;
+        std::vector<flat_instruction> instructions;
+        std::vector<operand> call_arguments;
+        std::vector<flat_phi> phis;
+        std::vector<flat_incoming> incoming;
+        // indexed by block index
+        std::vector<flat_block> blocks;
+        std::vector<int> successor_list;
+        std::vector<int> topological;
+
+        const std::unique_ptr<atom>& get(operand handle) const;
+        std::span<const flat_instruction> instructions_of(const flat_block& block) const;
+        std::span<const flat_phi> phis_of(const flat_block& block) const;
+        std::span<const flat_incoming> incoming_of(const flat_phi& phi) const;
+        std::span<const int> successors(const flat_block& block) const;
+        std::span<const operand> arguments_of(const flat_instruction& instruction) const;
+    };
+
+    // Takes the atoms out of fn instead of copying them, repeated uses of a value with the same type are dropped in favor
+    // of the first
+    flat_function flatten(function&& fn);
+}
+
+#endif
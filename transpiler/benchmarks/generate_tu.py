@@ -0,0 +1,90 @@
+# Generates synthetic translation units for benchmarking the transpiler's compile-time throughput
+#
+# usage: python3 generate_tu.py <shape> <size> [output.cpp]
+
+import sys
+
+def many_small(size):
+    # lots of tiny functions, stresses per-function overhead
+    lines = []
+    for i in range(size):
+        lines += [
+            f"int f{i}(int a, int b) {{",
+            f"    int c = a * {i + 1} + b;",
+            f"    return (c ^ a) - (b >> {i % 7 + 1});",
+            "}",
+        ]
+    return lines
+
+def huge_function(size):
+    # one function with a long dependency chain of arithmetic
+    lines = ["int huge(int a, int b) {", "    int x0 = a;"]
+    ops = ["+", "-", "*", "^", "|", "&"]
+    for i in range(1, size + 1):
+        lines.append(f"    int x{i} = (x{i - 1} {ops[i % len(ops)]} b) + {i};")
+    lines += [f"    return x{size};", "}"]
+    return lines
+
+def loop_nest(size):
+    # nested loops, size is the depth
+    lines = ["int nest(int n, int* out) {", "    int acc = 0;"]
+    for d in range(size):
+        indent = "    " * (d + 1)
+        lines.append(f"{indent}for(int i{d} = 0; i{d} < n; i{d}++) {{")
+    indent = "    " * (size + 1)
+    lines.append(f"{indent}acc += " + " * ".join(f"i{d}" for d in range(size)) + ";")
+    lines.append(f"{indent}*out = acc;")
+    for d in reversed(range(size)):
+        lines.append("    " * (d + 1) + "}")
+    lines += ["    return acc;", "}"]
+    return lines
+
+def wide_switch(size):
+    # one switch over size cases
+    lines = ["int dispatch(int op, int a, int b) {", "    switch(op) {"]
+    for i in range(size):
+        lines.append(f"        case {i}: return a * {i + 1} + (b ^ {i});")
+    lines += ["        default: return 0;", "    }", "}"]
+    return lines
+
+def phi_heavy(size):
+    # many values carried around a loop and conditionally updated, every one needs phis
+    lines = ["int phis(int n, int s) {"]
+    for i in range(size):
+        lines.append(f"    int v{i} = s + {i};")
+    lines.append("    for(int i = 0; i < n; i++) {")
+    for i in range(size):
+        lines += [
+            f"        if(i > {i}) {{",
+            f"            v{i} = v{i} * 3 + v{(i + 1) % size};",
+            "        }",
+        ]
+    lines.append("    }")
+    lines.append("    return " + " ^ ".join(f"v{i}" for i in range(size)) + ";")
+    lines.append("}")
+    return lines
+
+shapes = {
+    "many_small": many_small,
+    "huge_function": huge_function,
+    "loop_nest": loop_nest,
+    "wide_switch": wide_switch,
+    "phi_heavy": phi_heavy,
+}
+
+def generate(shape, size):
+    return "\n".join(shapes[shape](size)) + "\n"
+
+def main():
+    if len(sys.argv) < 3 or sys.argv[1] not in shapes:
+        print(f"usage: python3 generate_tu.py <{'|'.join(shapes)}> <size> [output.cpp]")
+        sys.exit(2)
+    code = generate(sys.argv[1], int(sys.argv[2]))
+    if len(sys.argv) > 3:
+        with open(sys.argv[3], "w") as f:
+            f.write(code)
+    else:
+        print(code, end="")
+
+if __name__ == "__main__":
+    main()
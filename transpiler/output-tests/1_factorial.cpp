@@ -10,3 +10,5 @@ int factorial(int n) {
 // DECL: int factorial(int n);
 // TEST: VERIFY(factorial(5) == 120);
 // TEST: VERIFY(factorial(6) == 720);
+// JIT: _Z9factoriali 5 = 120
+// JIT: _Z9factoriali 6 = 720
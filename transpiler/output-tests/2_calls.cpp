@@ -8,3 +8,4 @@ int square(int num) {
 
 // DECL: int square(int n);
 // TEST: VERIFY(square(2) == 2 * 2 + 120);
+// JIT: _Z6squarei 2 = 124
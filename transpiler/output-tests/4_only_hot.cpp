@@ -0,0 +1,20 @@
+// PLUGIN: only-hot
+__attribute__((hot)) int hot_sum(int n) {
+    int sum = 0;
+    for(int i = 1; i <= n; i++) {
+        sum += i;
+    }
+    return sum;
+}
+int plain_sum(int n) {
+    return n * (n + 1) / 2;
+}
+__attribute__((cold)) int cold_sum(int n) {
+    return plain_sum(n);
+}
+
+// DECL: int hot_sum(int n);
+// TEST: VERIFY(hot_sum(10) == 55);
+// JIT: _Z7hot_sumi 10 = 55
+// ABSENT: _Z9plain_sumi
+// ABSENT: _Z8cold_sumi
@@ -0,0 +1,18 @@
+void matmul(const double* a, const double* b, double* c, int n) {
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < n; j++) {
+            double sum = 0;
+            for(int k = 0; k < n; k++) {
+                sum += a[i * n + k] * b[k * n + j];
+            }
+            c[i * n + j] = sum;
+        }
+    }
+}
+
+// DECL: void matmul(const double* a, const double* b, double* c, int n);
+// SETUP: int n = 96;
+// SETUP: std::vector<double> a(n * n), b(n * n), c(n * n);
+// SETUP: for(int i = 0; i < n * n; i++) { a[i] = i % 7 * 0.5; b[i] = i % 5 * 0.25; }
+// BENCH: matmul(a.data(), b.data(), c.data(), n);
+// BENCH: sink += std::uint64_t(c[n + 1]);
@@ -0,0 +1,13 @@
+unsigned long fnv1a(const unsigned char* data, unsigned long size) {
+    unsigned long hash = 14695981039346656037ul;
+    for(unsigned long i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ul;
+    }
+    return hash;
+}
+
+// DECL: unsigned long fnv1a(const unsigned char* data, unsigned long size);
+// SETUP: std::vector<unsigned char> data(1 << 16);
+// SETUP: for(std::size_t i = 0; i < data.size(); i++) { data[i] = i * 31 + 7; }
+// BENCH: sink += fnv1a(data.data(), data.size());
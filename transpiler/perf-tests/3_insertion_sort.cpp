@@ -0,0 +1,18 @@
+void insertion_sort(int* arr, int n) {
+    for(int i = 1; i < n; i++) {
+        int value = arr[i];
+        int j = i - 1;
+        while(j >= 0 && arr[j] > value) {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = value;
+    }
+}
+
+// DECL: void insertion_sort(int* arr, int n);
+// SETUP: std::vector<int> input(2048), arr(2048);
+// SETUP: for(std::size_t i = 0; i < input.size(); i++) { input[i] = int((i * 2654435761u) % 100000); }
+// BENCH: std::copy(input.begin(), input.end(), arr.begin());
+// BENCH: insertion_sort(arr.data(), int(arr.size()));
+// BENCH: sink += arr[arr.size() / 2];
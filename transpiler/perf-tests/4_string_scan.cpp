@@ -0,0 +1,17 @@
+int count_words(const char* str) {
+    int words = 0;
+    int in_word = 0;
+    for(int i = 0; str[i] != 0; i++) {
+        int is_space = str[i] == ' ' || str[i] == '\n' || str[i] == '\t';
+        if(!is_space && !in_word) {
+            words++;
+        }
+        in_word = !is_space;
+    }
+    return words;
+}
+
+// DECL: int count_words(const char* str);
+// SETUP: std::string text;
+// SETUP: for(int i = 0; i < 20000; i++) { text += i % 3 ? "lorem " : "ipsum\tdolor\n"; }
+// BENCH: sink += count_words(text.c_str());
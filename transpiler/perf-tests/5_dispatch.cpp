@@ -0,0 +1,25 @@
+// A tiny stack-free bytecode interpreter: 0 = add imm, 1 = mul imm, 2 = xor imm, 3 = jump back if acc < imm
+long interpret(const int* code, int length) {
+    long acc = 1;
+    int pc = 0;
+    while(pc < length) {
+        int op = code[pc];
+        int imm = code[pc + 1];
+        if(op == 0) {
+            acc = acc + imm;
+        } else if(op == 1) {
+            acc = acc * imm;
+        } else if(op == 2) {
+            acc = acc ^ imm;
+        } else if(op == 3 && acc < imm) {
+            pc = 0;
+            continue;
+        }
+        pc += 2;
+    }
+    return acc;
+}
+
+// DECL: long interpret(const int* code, int length);
+// SETUP: std::vector<int> code = {0, 3, 1, 3, 2, 5, 0, 1, 3, 100000000};
+// BENCH: sink += interpret(code.data(), int(code.size()));
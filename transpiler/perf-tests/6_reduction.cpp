@@ -0,0 +1,23 @@
+long sum_of_squares(const int* data, int n) {
+    long sum = 0;
+    for(int i = 0; i < n; i++) {
+        sum += long(data[i]) * data[i];
+    }
+    return sum;
+}
+
+float dot(const float* a, const float* b, int n) {
+    float sum = 0;
+    for(int i = 0; i < n; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+// DECL: long sum_of_squares(const int* data, int n);
+// DECL: float dot(const float* a, const float* b, int n);
+// SETUP: std::vector<int> data(1 << 16);
+// SETUP: std::vector<float> a(1 << 16, 0.5f), b(1 << 16, 0.25f);
+// SETUP: for(std::size_t i = 0; i < data.size(); i++) { data[i] = int(i % 1000) - 500; }
+// BENCH: sink += sum_of_squares(data.data(), int(data.size()));
+// BENCH: sink += std::uint64_t(dot(a.data(), b.data(), int(a.size())));
@@ -0,0 +1,136 @@
+import argparse
+import json
+import os
+import statistics
+import subprocess
+import sys
+import tempfile
+
+# Runtime benchmarks: every kernel in perf-tests/ is built three ways and timed
+#   gcc:   kernel.cpp ---g++ -O3---> a.out
+#   wyrm:  kernel.cpp --transpiler--> x.ll ---clang -O3---> a.out
+#   clang: kernel.cpp ---clang -O3---> a.out
+# The benchmark driver (main.cpp) is generated from the kernel's // DECL:, // SETUP:, and // BENCH: lines, like
+# test.py's output tests. Run from the build directory.
+
+GCC = "g++"
+CLANG = "/usr/bin/clang++-17"
+
+DRIVER = """\
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+{decls}
+int main(int argc, char** argv) {{
+    int warmup = std::stoi(argv[1]);
+    int repetitions = std::stoi(argv[2]);
+    std::uint64_t sink = 0;
+{setup}
+    for(int r = 0; r < warmup + repetitions; r++) {{
+        auto start = std::chrono::steady_clock::now();
+{bench}
+        auto end = std::chrono::steady_clock::now();
+        if(r >= warmup) {{
+            std::printf("%lld\\n", (long long)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }}
+    }}
+    std::printf("sink %llu\\n", (unsigned long long)sink);
+}}
+"""
+
+def run(args, cwd):
+    try:
+        p = subprocess.run(args, cwd=cwd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    except FileNotFoundError:
+        return False, "", f"{args[0]} not found"
+    return p.returncode == 0, p.stdout.decode("utf-8"), p.stderr.decode("utf-8")
+
+def build(variant, test_file, workdir, plugin, flags):
+    driver = os.path.join(workdir, "main.cpp")
+    binary = os.path.join(workdir, f"{variant}.out")
+    if variant == "gcc":
+        ok, _, stderr = run([GCC, *flags, test_file, driver, "-o", binary], workdir)
+    elif variant == "clang":
+        ok, _, stderr = run([CLANG, *flags, test_file, driver, "-o", binary], workdir)
+    else:
+        ll = os.path.join(workdir, "x.ll")
+        if os.path.exists(ll):
+            os.remove(ll)
+        ok, stdout, stderr = run(
+            [GCC, *flags, "-c", test_file, "-o", os.devnull, f"-fplugin={plugin}", "-fplugin-arg-libplugin-quiet"],
+            workdir
+        )
+        if not ok or "TRANSPILED SUCCESSFULLY" not in stdout:
+            return None
+        ok, _, stderr = run([CLANG, *flags, ll, driver, "-o", binary], workdir)
+    if not ok:
+        print(stderr)
+        return None
+    return binary
+
+def measure(binary, warmup, repetitions):
+    ok, stdout, stderr = run([binary, str(warmup), str(repetitions)], os.path.dirname(binary))
+    if not ok:
+        print(stderr)
+        return None
+    lines = stdout.split()
+    sink = lines[lines.index("sink") + 1]
+    times = [int(t) for t in lines[:lines.index("sink")]]
+    return {"median_ns": statistics.median(times), "min_ns": min(times), "sink": sink}
+
+def main():
+    parser = argparse.ArgumentParser(description="wyrm runtime benchmarks")
+    parser.add_argument("--plugin", default="./libplugin.so")
+    parser.add_argument("--warmup", type=int, default=3)
+    parser.add_argument("--repetitions", type=int, default=15)
+    parser.add_argument("--flags", default="-O3")
+    parser.add_argument("--output", help="write results as json")
+    parser.add_argument("tests", nargs="*", help="subset of perf-tests to run")
+    args = parser.parse_args()
+
+    plugin = os.path.abspath(args.plugin)
+    tests_path = os.path.join(os.path.dirname(os.path.realpath(__file__)), "perf-tests")
+    tests = sorted(
+        [os.path.join(tests_path, f) for f in os.listdir(tests_path)],
+        key=lambda path: int(os.path.basename(path).split("_")[0])
+    )
+    if args.tests:
+        tests = [t for t in tests if os.path.basename(t) in args.tests]
+
+    results = {}
+    print(f"{'kernel':>22} {'gcc':>12} {'wyrm':>12} {'clang':>12} {'wyrm/gcc':>9} {'wyrm/clang':>10}")
+    for test_file in tests:
+        name = os.path.basename(test_file)
+        with open(test_file, "r") as f:
+            lines = [line for line in f]
+        field = lambda prefix: [line[len(prefix):].rstrip() for line in lines if line.startswith(prefix)]
+        with tempfile.TemporaryDirectory() as workdir:
+            with open(os.path.join(workdir, "main.cpp"), "w") as f:
+                f.write(
+                    DRIVER.format(
+                        decls="\n".join(field("// DECL: ")),
+                        setup="\n".join("    " + line for line in field("// SETUP: ")),
+                        bench="\n".join("        " + line for line in field("// BENCH: "))
+                    )
+                )
+            result = {}
+            for variant in ["gcc", "wyrm", "clang"]:
+                binary = build(variant, test_file, workdir, plugin, args.flags.split())
+                result[variant] = measure(binary, args.warmup, args.repetitions) if binary else None
+        results[name] = result
+        sinks = {r["sink"] for r in result.values() if r is not None}
+        fmt = lambda r: f"{r['median_ns'] / 1e3:10.1f}us" if r else f"{'unsupported':>12}"
+        ratio = lambda a, b: f"{a['median_ns'] / b['median_ns']:.2f}" if a and b else "-"
+        print(
+            f"{name:>22} {fmt(result['gcc'])} {fmt(result['wyrm'])} {fmt(result['clang'])}"
+            f" {ratio(result['wyrm'], result['gcc']):>9} {ratio(result['wyrm'], result['clang']):>10}"
+            + (" <-- results differ" if len(sinks) > 1 else "")
+        )
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(results, f, indent=2)
+
+main()
@@ -1,6 +1,9 @@
 #ifndef BIMPLE_H
 #define BIMPLE_H
 
+#include <concepts>
+#include <cstdint>
+#include <type_traits>
 #include <string>
 #include <utility>
 #include <vector>
@@ -31,7 +34,7 @@ namespace bimple {
         // refernce,
         function,
         // method,
-        // array,
+        array,
         union_type,
         struct_type // "Record type" in gcc
     };
@@ -72,6 +75,30 @@ namespace bimple {
         }
     }
 
+    // visit(node, f) calls f with the node as the derived type its tag names, a single switch instead of a chain of
+    // downcasts. It's defined for type, atom, and statement (or unique_ptrs to them) after each hierarchy, f has to take
+    // every derived type, e.g. a generic lambda or an overload set, and return the same type for all of them. Constness
+    // follows the node like it does for downcast.
+    namespace detail {
+        template<typename Derived, typename Base>
+        using same_const = std::conditional_t<std::is_const_v<Base>, const Derived, Derived>;
+
+        template<typename Derived, typename Base, typename F>
+        decltype(auto) visit_as(Base& base, F& f) {
+            return f(static_cast<same_const<Derived, Base>&>(base));
+        }
+    }
+
+    template<typename Base, typename F>
+    decltype(auto) visit(std::unique_ptr<Base>& base, F&& f) {
+        return visit(*base, std::forward<F>(f));
+    }
+
+    template<typename Base, typename F>
+    decltype(auto) visit(const std::unique_ptr<Base>& base, F&& f) {
+        return visit(std::as_const(*base), std::forward<F>(f));
+    }
+
     struct type {
         type_tag tag;
         std::size_t size;
@@ -79,6 +106,7 @@ namespace bimple {
         type(type_tag tag, std::size_t size) : tag(tag), size(size / 8) {}
         bool operator==(const type& other) const;
         virtual std::string to_string() const = 0;
+        virtual std::unique_ptr<type> clone() const = 0;
         friend std::ostream& operator<<(std::ostream& s, const type& t) {
             s<<t.to_string();
             return s;
@@ -98,6 +126,9 @@ namespace bimple {
         bool operator==(const integer& other) const {
             return bits == other.bits && is_unsigned == other.is_unsigned;
         }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<integer>(bits, is_unsigned, size * 8);
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::integer;
         }
@@ -111,6 +142,9 @@ namespace bimple {
         bool operator==(const void_type& other) const {
             return true;
         }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<void_type>();
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::void_type;
         }
@@ -124,6 +158,9 @@ namespace bimple {
         bool operator==(const boolean& other) const {
             return true;
         }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<boolean>(size * 8);
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::boolean;
         }
@@ -140,6 +177,9 @@ namespace bimple {
         bool operator==(const pointer& other) const {
             return *target_type == *other.target_type;
         }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<pointer>(target_type->clone(), size * 8);
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::pointer;
         }
@@ -154,6 +194,9 @@ namespace bimple {
         bool operator==(const real& other) const {
             return true;
         }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<real>(bits, size * 8);
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::real;
         }
@@ -181,31 +224,164 @@ namespace bimple {
         bool operator==(const function_type& other) const {
             return true;
         }
+        std::unique_ptr<type> clone() const override {
+            std::vector<std::unique_ptr<type>> cloned_args;
+            for(const auto& arg : args) {
+                cloned_args.push_back(arg->clone());
+            }
+            return std::make_unique<function_type>(return_type->clone(), std::move(cloned_args));
+        }
         static constexpr type_tag struct_tag() {
             return type_tag::function;
         }
     };
 
+    struct array : public type {
+        std::unique_ptr<type> element_type;
+        // 0 for flexible array members
+        std::size_t count;
+        array(std::unique_ptr<type>&& element_type, std::size_t count, std::size_t size) :
+            type(struct_tag(), size),
+            element_type(std::move(element_type)),
+            count(count) {}
+        std::string to_string() const override {
+            return fmt::format("{}[{}]", element_type->to_string(), count);
+        }
+        bool operator==(const array& other) const {
+            return count == other.count && *element_type == *other.element_type;
+        }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<array>(element_type->clone(), count, size * 8);
+        }
+        static constexpr type_tag struct_tag() {
+            return type_tag::array;
+        }
+    };
+
+    struct field {
+        // empty for anonymous fields
+        std::string name;
+        std::unique_ptr<bimple::type> type;
+        // bytes from the start of the record
+        std::size_t offset;
+    };
+
+    // Structs and unions with gcc's layout. Bit-fields aren't fields as far as bimple is concerned, their bytes are
+    // padding. Records behind pointers are left without fields (pointees don't matter to llvm's opaque pointers and it
+    // keeps self-referential records finite), so only records that are accessed carry a layout.
+    struct record : public type {
+        // gcc's tag, empty for anonymous records
+        std::string name;
+        std::vector<field> fields;
+    protected:
+        record(type_tag tag, std::string&& name, std::vector<field>&& fields, std::size_t size) :
+            type(tag, size),
+            name(std::move(name)),
+            fields(std::move(fields)) {}
+        std::string to_string(const char* keyword) const {
+            return fmt::format(
+                "{} {}{{{}}}",
+                keyword,
+                name.empty() ? "" : name + " ",
+                format_list(
+                    fields,
+                    [] (const field& f) {
+                        return fmt::format("{}: {} @{}", f.name, f.type->to_string(), f.offset);
+                    }
+                )
+            );
+        }
+        bool same_fields(const record& other) const {
+            if(name != other.name || size != other.size || fields.size() != other.fields.size()) {
+                return false;
+            }
+            for(std::size_t i = 0; i < fields.size(); i++) {
+                if(fields[i].offset != other.fields[i].offset || !(*fields[i].type == *other.fields[i].type)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        std::vector<field> clone_fields() const {
+            std::vector<field> cloned;
+            for(const auto& f : fields) {
+                cloned.push_back({f.name, f.type->clone(), f.offset});
+            }
+            return cloned;
+        }
+    };
+
+    struct struct_type : public record {
+        struct_type(std::string&& name, std::vector<field>&& fields, std::size_t size) :
+            record(struct_tag(), std::move(name), std::move(fields), size) {}
+        std::string to_string() const override {
+            return record::to_string("struct");
+        }
+        bool operator==(const struct_type& other) const {
+            return same_fields(other);
+        }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<struct_type>(std::string(name), clone_fields(), size * 8);
+        }
+        static constexpr type_tag struct_tag() {
+            return type_tag::struct_type;
+        }
+    };
+
+    struct union_type : public record {
+        union_type(std::string&& name, std::vector<field>&& fields, std::size_t size) :
+            record(struct_tag(), std::move(name), std::move(fields), size) {}
+        std::string to_string() const override {
+            return record::to_string("union");
+        }
+        bool operator==(const union_type& other) const {
+            return same_fields(other);
+        }
+        std::unique_ptr<type> clone() const override {
+            return std::make_unique<union_type>(std::string(name), clone_fields(), size * 8);
+        }
+        static constexpr type_tag struct_tag() {
+            return type_tag::union_type;
+        }
+    };
+
+    // a struct or union, null for other types
+    inline const record* as_record(const type& t) {
+        if(t.tag == type_tag::struct_type || t.tag == type_tag::union_type) {
+            return static_cast<const record*>(&t);
+        }
+        return nullptr;
+    }
+
+    inline bool is_aggregate(const type& t) {
+        return t.tag == type_tag::array || as_record(t);
+    }
+
+    template<typename Base, typename F> requires std::same_as<std::remove_const_t<Base>, type>
+    decltype(auto) visit(Base& base, F&& f) {
+        switch(base.tag) {
+            case type_tag::integer: return detail::visit_as<integer>(base, f);
+            case type_tag::void_type: return detail::visit_as<void_type>(base, f);
+            case type_tag::boolean: return detail::visit_as<boolean>(base, f);
+            case type_tag::pointer: return detail::visit_as<pointer>(base, f);
+            case type_tag::real: return detail::visit_as<real>(base, f);
+            case type_tag::function: return detail::visit_as<function_type>(base, f);
+            case type_tag::array: return detail::visit_as<array>(base, f);
+            case type_tag::struct_type: return detail::visit_as<struct_type>(base, f);
+            case type_tag::union_type: return detail::visit_as<union_type>(base, f);
+            default:
+                VERIFY(false, "Unhandled type", base.tag);
+                __builtin_unreachable();
+        }
+    }
+
     inline bool type::operator==(const type& other) const {
         if(tag != other.tag) {
             return false;
         }
-        if(auto* self = downcast<integer>(this)) {
-            return *self == *downcast<integer>(&other);
-        } else if(auto* self = downcast<void_type>(this)) {
-            return *self == *downcast<void_type>(&other);
-        } else if(auto* self = downcast<boolean>(this)) {
-            return *self == *downcast<boolean>(&other);
-        } else if(auto* self = downcast<pointer>(this)) {
-            return *self == *downcast<pointer>(&other);
-        } else if(auto* self = downcast<real>(this)) {
-            return *self == *downcast<real>(&other);
-        } else if(auto* self = downcast<function_type>(this)) {
-            return *self == *downcast<function_type>(&other);
-        } else {
-            VERIFY(false, "Unhandled type", other.tag);
-            __builtin_unreachable();
-        }
+        return visit(*this, [&] (const auto& self) {
+            return self == static_cast<const std::remove_cvref_t<decltype(self)>&>(other);
+        });
     }
 
     enum class atom_tag {
@@ -213,7 +389,13 @@ namespace bimple {
         addr_expr,
         mem_ref,
         integer_constant,
-        real_constant
+        real_constant,
+        component_ref,
+        array_ref,
+        address_of,
+        zero_initializer,
+        local_ref,
+        global_ref
     };
 
     struct atom {
@@ -223,6 +405,7 @@ namespace bimple {
             tag(tag),
             type(std::move(type)) {}
         virtual std::string to_string(bool types = false) const = 0;
+        virtual std::unique_ptr<atom> clone() const = 0;
     };
 
     struct variable : public atom {
@@ -238,6 +421,9 @@ namespace bimple {
                 return name;
             }
         }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<variable>(std::string(name), type->clone());
+        }
         static constexpr atom_tag struct_tag() {
             return atom_tag::variable;
         }
@@ -256,6 +442,9 @@ namespace bimple {
                 return name;
             }
         }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<addr_expr>(std::string(name), type->clone());
+        }
         static constexpr atom_tag struct_tag() {
             return atom_tag::addr_expr;
         }
@@ -281,6 +470,9 @@ namespace bimple {
                 return fmt::format("*({} + {})", base->to_string(), offset->to_string());
             }
         }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<mem_ref>(base->clone(), offset->clone(), type->clone());
+        }
         static constexpr atom_tag struct_tag() {
             return atom_tag::mem_ref;
         }
@@ -300,6 +492,9 @@ namespace bimple {
                 return fmt::format("{}", value);
             }
         }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<integer_constant>(value, type->clone());
+        }
         static constexpr atom_tag struct_tag() {
             return atom_tag::integer_constant;
         }
@@ -319,14 +514,189 @@ namespace bimple {
                 return value;
             }
         }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<real_constant>(std::string(value), type->clone());
+        }
         static constexpr atom_tag struct_tag() {
             return atom_tag::real_constant;
         }
     };
 
+    // field of a record in memory, base is a memory reference with the record's type
+    struct component_ref : public atom {
+        std::unique_ptr<atom> base;
+        // index into the record's fields
+        unsigned field;
+        component_ref() : atom(struct_tag(), nullptr) {}
+        component_ref(std::unique_ptr<atom>&& base, unsigned field, std::unique_ptr<bimple::type>&& type) :
+            atom(struct_tag(), std::move(type)),
+            base(std::move(base)),
+            field(field) {}
+
+        std::string to_string(bool types = false) const {
+            auto* r = as_record(*base->type);
+            auto name = r && field < r->fields.size() ? r->fields[field].name : std::to_string(field);
+            if(types) {
+                return fmt::format("{}.{} [{}]", base->to_string(), name, type->to_string());
+            } else {
+                return fmt::format("{}.{}", base->to_string(), name);
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<component_ref>(base->clone(), field, type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::component_ref;
+        }
+    };
+
+    // element of an array in memory, base is a memory reference with the array's type
+    struct array_ref : public atom {
+        std::unique_ptr<atom> base;
+        std::unique_ptr<atom> index;
+        array_ref() : atom(struct_tag(), nullptr) {}
+        array_ref(std::unique_ptr<atom>&& base, std::unique_ptr<atom>&& index, std::unique_ptr<bimple::type>&& type) :
+            atom(struct_tag(), std::move(type)),
+            base(std::move(base)),
+            index(std::move(index)) {}
+
+        std::string to_string(bool types = false) const {
+            if(types) {
+                return fmt::format("{}[{}] [{}]", base->to_string(), index->to_string(), type->to_string());
+            } else {
+                return fmt::format("{}[{}]", base->to_string(), index->to_string());
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<array_ref>(base->clone(), index->clone(), type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::array_ref;
+        }
+    };
+
+    // address of a memory reference, typed as the pointer
+    struct address_of : public atom {
+        std::unique_ptr<atom> reference;
+        address_of() : atom(struct_tag(), nullptr) {}
+        address_of(std::unique_ptr<atom>&& reference, std::unique_ptr<bimple::type>&& type) :
+            atom(struct_tag(), std::move(type)),
+            reference(std::move(reference)) {}
+
+        std::string to_string(bool types = false) const {
+            if(types) {
+                return fmt::format("&{} [{}]", reference->to_string(), type->to_string());
+            } else {
+                return fmt::format("&{}", reference->to_string());
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<address_of>(reference->clone(), type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::address_of;
+        }
+    };
+
+    // the all-zero value of an aggregate, gcc's empty CONSTRUCTOR
+    struct zero_initializer : public atom {
+        zero_initializer() : atom(struct_tag(), nullptr) {}
+        zero_initializer(std::unique_ptr<bimple::type>&& type) : atom(struct_tag(), std::move(type)) {}
+
+        std::string to_string(bool types = false) const {
+            if(types) {
+                return fmt::format("{{}} [{}]", type->to_string());
+            } else {
+                return "{}";
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<zero_initializer>(type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::zero_initializer;
+        }
+    };
+
+    // a local variable that lives in memory (one of function::locals), typed as the variable
+    struct local_ref : public atom {
+        std::string name;
+        local_ref() : atom(struct_tag(), nullptr) {}
+        local_ref(std::string&& name, std::unique_ptr<bimple::type>&& type) :
+            atom(struct_tag(), std::move(type)),
+            name(std::move(name)) {}
+
+        std::string to_string(bool types = false) const {
+            if(types) {
+                return fmt::format("{} [{}]", name, type->to_string());
+            } else {
+                return name;
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<local_ref>(std::string(name), type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::local_ref;
+        }
+    };
+
+    // a global variable or string literal (one of function::globals), typed as the variable
+    struct global_ref : public atom {
+        std::string name;
+        global_ref() : atom(struct_tag(), nullptr) {}
+        global_ref(std::string&& name, std::unique_ptr<bimple::type>&& type) :
+            atom(struct_tag(), std::move(type)),
+            name(std::move(name)) {}
+
+        std::string to_string(bool types = false) const {
+            if(types) {
+                return fmt::format("@{} [{}]", name, type->to_string());
+            } else {
+                return fmt::format("@{}", name);
+            }
+        }
+        std::unique_ptr<atom> clone() const override {
+            return std::make_unique<global_ref>(std::string(name), type->clone());
+        }
+        static constexpr atom_tag struct_tag() {
+            return atom_tag::global_ref;
+        }
+    };
+
+    // atoms that name memory, reading them is a load and assigning to them a store
+    inline bool is_memory_reference(const atom& a) {
+        return a.tag == atom_tag::mem_ref
+            || a.tag == atom_tag::component_ref
+            || a.tag == atom_tag::array_ref
+            || a.tag == atom_tag::local_ref
+            || a.tag == atom_tag::global_ref;
+    }
+
+    template<typename Base, typename F> requires std::same_as<std::remove_const_t<Base>, atom>
+    decltype(auto) visit(Base& base, F&& f) {
+        switch(base.tag) {
+            case atom_tag::variable: return detail::visit_as<variable>(base, f);
+            case atom_tag::addr_expr: return detail::visit_as<addr_expr>(base, f);
+            case atom_tag::mem_ref: return detail::visit_as<mem_ref>(base, f);
+            case atom_tag::integer_constant: return detail::visit_as<integer_constant>(base, f);
+            case atom_tag::real_constant: return detail::visit_as<real_constant>(base, f);
+            case atom_tag::component_ref: return detail::visit_as<component_ref>(base, f);
+            case atom_tag::array_ref: return detail::visit_as<array_ref>(base, f);
+            case atom_tag::address_of: return detail::visit_as<address_of>(base, f);
+            case atom_tag::zero_initializer: return detail::visit_as<zero_initializer>(base, f);
+            case atom_tag::local_ref: return detail::visit_as<local_ref>(base, f);
+            case atom_tag::global_ref: return detail::visit_as<global_ref>(base, f);
+            default:
+                VERIFY(false, "Unhandled atom", base.tag);
+                __builtin_unreachable();
+        }
+    }
+
     struct phi {
         variable result;
-        std::vector<std::pair<int, variable>> values;
+        // incoming block index -> value, a variable or a constant
+        std::vector<std::pair<int, std::unique_ptr<atom>>> values;
 
         std::string to_string(bool types = false) const {
             return fmt::format(
@@ -334,8 +704,8 @@ namespace bimple {
                 result.to_string(),
                 format_list(
                     values,
-                    [] (const std::pair<int, bimple::variable>& pair) {
-                        return fmt::format("{} {}", pair.first, pair.second.to_string());
+                    [] (const std::pair<int, std::unique_ptr<bimple::atom>>& pair) {
+                        return fmt::format("{} {}", pair.first, pair.second->to_string());
                     }
                 )
             );
@@ -347,7 +717,9 @@ namespace bimple {
         unary_assignment,
         call,
         function_return,
-        cond
+        cond,
+        intrinsic_call,
+        switch_branch
     };
 
     struct statement {
@@ -356,8 +728,68 @@ namespace bimple {
         virtual std::string to_string(bool types = false) const = 0;
     };
 
+    // llvm's fast-math flags, the relaxations gcc's options allow on a floating point operation
+    enum class fp_flags : std::uint8_t {
+        none = 0,
+        // -fassociative-math
+        reassoc = 1 << 0,
+        // -fno-signed-zeros
+        nsz = 1 << 1,
+        // -ffinite-math-only, as the next one
+        nnan = 1 << 2,
+        ninf = 1 << 3,
+        // -freciprocal-math
+        arcp = 1 << 4,
+        // -ffp-contract=fast
+        contract = 1 << 5,
+        // -funsafe-math-optimizations, approximate math functions
+        afn = 1 << 6
+    };
+
+    constexpr fp_flags operator|(fp_flags a, fp_flags b) {
+        return fp_flags(std::uint8_t(a) | std::uint8_t(b));
+    }
+
+    constexpr fp_flags& operator|=(fp_flags& a, fp_flags b) {
+        return a = a | b;
+    }
+
+    constexpr bool has_flag(fp_flags flags, fp_flags flag) {
+        return (std::uint8_t(flags) & std::uint8_t(flag)) != 0;
+    }
+
+    // in llvm's syntax, e.g. "reassoc nsz", empty without flags
+    inline std::string to_string(fp_flags flags) {
+        static constexpr std::pair<fp_flags, const char*> names[] = {
+            {fp_flags::reassoc, "reassoc"},
+            {fp_flags::nsz, "nsz"},
+            {fp_flags::nnan, "nnan"},
+            {fp_flags::ninf, "ninf"},
+            {fp_flags::arcp, "arcp"},
+            {fp_flags::contract, "contract"},
+            {fp_flags::afn, "afn"}
+        };
+        std::string result;
+        for(const auto& [flag, name] : names) {
+            if(has_flag(flags, flag)) {
+                if(!result.empty()) {
+                    result += ' ';
+                }
+                result += name;
+            }
+        }
+        return result;
+    }
+
+    // " [flags]" for statement dumps
+    inline std::string flags_suffix(fp_flags flags) {
+        return flags == fp_flags::none ? "" : fmt::format(" [{}]", to_string(flags));
+    }
+
     struct assignment : public statement {
         std::unique_ptr<atom> lhs;
+        // floating point operations only
+        fp_flags flags = fp_flags::none;
     protected:
         assignment(statement_tag tag, std::unique_ptr<atom>&& lhs) :
             statement(tag),
@@ -463,11 +895,12 @@ namespace bimple {
 
         std::string to_string(bool types = false) const override {
             return fmt::format(
-                "{} = {} {} {}",
+                "{} = {} {} {}{}",
                 lhs->to_string(types),
                 rhs1->to_string(types),
                 bimple::to_string(op),
-                rhs2->to_string(types)
+                rhs2->to_string(types),
+                flags_suffix(flags)
             );
         }
         static constexpr statement_tag struct_tag() {
@@ -489,10 +922,11 @@ namespace bimple {
 
         std::string to_string(bool types = false) const override {
             return fmt::format(
-                "{} = {}{}",
+                "{} = {}{}{}",
                 lhs->to_string(types),
                 bimple::to_string(op),
-                rhs->to_string(types)
+                rhs->to_string(types),
+                flags_suffix(flags)
             );
         }
         static constexpr statement_tag struct_tag() {
@@ -502,6 +936,7 @@ namespace bimple {
 
     struct call : public statement {
         std::unique_ptr<atom> fn;
+        // null when the result is unused or the function returns void
         std::unique_ptr<atom> lhs;
         std::vector<std::unique_ptr<atom>> args;
 
@@ -517,7 +952,10 @@ namespace bimple {
 
         std::string to_string(bool types = false) const override {
             std::ostringstream s;
-            s<<lhs->to_string(types)<<" = "<<fn->to_string(types)<<"(";
+            if(lhs) {
+                s<<lhs->to_string(types)<<" = ";
+            }
+            s<<fn->to_string(types)<<"(";
             bool is_first = true;
             for(const auto& arg : args) {
                 if(!is_first) {
@@ -534,10 +972,179 @@ namespace bimple {
         }
     };
 
+    // llvm intrinsics that gcc builtins and internal functions are lowered to, with the operands each takes
+    enum class intrinsics {
+        // (destination, source, size)
+        memcpy,
+        memmove,
+        // (destination, byte value, size)
+        memset,
+        // (value), the result may be narrower than the value
+        popcount,
+        // (value) with an undefined result for zero, or (value, result for zero)
+        ctz,
+        clz,
+        // (value), swapped in the result's width, gcc can pass a wider promoted value
+        bswap,
+        // (address, rw, locality), the last two are constants
+        prefetch,
+        // (value, expected value) or (value, expected value, probability)
+        expect,
+        // (pointer, alignment) or (pointer, alignment, misalignment), no result, gcc's result is a copy of the pointer
+        assume_aligned,
+        // (local_ref), the local's storage becomes live or dead
+        lifetime_start,
+        lifetime_end,
+        // (value), integer absolute value, the minimum gives poison like gcc's ABS_EXPR on types that don't wrap
+        abs,
+        // floating point math, with results of the operands' type and without errno
+        // (value)
+        sqrt,
+        fabs,
+        floor,
+        ceil,
+        trunc,
+        round,
+        rint,
+        nearbyint,
+        sin,
+        cos,
+        exp,
+        exp2,
+        log,
+        log2,
+        log10,
+        // (x, y)
+        pow,
+        copysign,
+        fmin,
+        fmax,
+        // (x, y, z), x * y + z with a single rounding
+        fma
+    };
+
+    inline std::string to_string(intrinsics id) {
+        using enum intrinsics;
+        switch(id) {
+            case memcpy:
+                return "memcpy";
+            case memmove:
+                return "memmove";
+            case memset:
+                return "memset";
+            case popcount:
+                return "popcount";
+            case ctz:
+                return "ctz";
+            case clz:
+                return "clz";
+            case bswap:
+                return "bswap";
+            case prefetch:
+                return "prefetch";
+            case expect:
+                return "expect";
+            case assume_aligned:
+                return "assume_aligned";
+            case lifetime_start:
+                return "lifetime_start";
+            case lifetime_end:
+                return "lifetime_end";
+            case abs:
+                return "abs";
+            case sqrt:
+                return "sqrt";
+            case fabs:
+                return "fabs";
+            case floor:
+                return "floor";
+            case ceil:
+                return "ceil";
+            case trunc:
+                return "trunc";
+            case round:
+                return "round";
+            case rint:
+                return "rint";
+            case nearbyint:
+                return "nearbyint";
+            case sin:
+                return "sin";
+            case cos:
+                return "cos";
+            case exp:
+                return "exp";
+            case exp2:
+                return "exp2";
+            case log:
+                return "log";
+            case log2:
+                return "log2";
+            case log10:
+                return "log10";
+            case pow:
+                return "pow";
+            case copysign:
+                return "copysign";
+            case fmin:
+                return "fmin";
+            case fmax:
+                return "fmax";
+            case fma:
+                return "fma";
+            default:
+                VERIFY(false, "Unhandled intrinsic", id);
+                __builtin_unreachable();
+        }
+    }
+
+    // the floating point math intrinsics, which come last
+    constexpr bool is_math(intrinsics id) {
+        return id >= intrinsics::sqrt;
+    }
+
+    struct intrinsic_call : public statement {
+        intrinsics id;
+        // null when the result is unused or the intrinsic has none
+        std::unique_ptr<atom> lhs;
+        std::vector<std::unique_ptr<atom>> args;
+        // math intrinsics only
+        fp_flags flags = fp_flags::none;
+
+        intrinsic_call(
+            intrinsics id,
+            std::unique_ptr<atom>&& lhs,
+            std::vector<std::unique_ptr<atom>>&& args
+        ) :
+            statement(struct_tag()),
+            id(id),
+            lhs(std::move(lhs)),
+            args(std::move(args)) {}
+
+        std::string to_string(bool types = false) const override {
+            return fmt::format(
+                "{}__builtin_{}({}){}",
+                lhs ? lhs->to_string(types) + " = " : "",
+                bimple::to_string(id),
+                format_list(
+                    args,
+                    [types] (const std::unique_ptr<atom>& arg) {
+                        return arg->to_string(types);
+                    }
+                ),
+                flags_suffix(flags)
+            );
+        }
+        static constexpr statement_tag struct_tag() {
+            return statement_tag::intrinsic_call;
+        }
+    };
+
     struct function_return : public statement {
-        std::optional<variable> value;
+        // null for void returns
+        std::unique_ptr<atom> value;
         function_return() : statement(struct_tag()) {};
-        function_return(variable&& value) :
+        function_return(std::unique_ptr<atom>&& value) :
                 statement(struct_tag()),
                 value(std::move(value)) {}
 
@@ -580,12 +1187,68 @@ namespace bimple {
         }
     };
 
+    // values low to high (inclusive) of a switch's index go to the block's successors[successor]
+    struct switch_case {
+        std::int64_t low;
+        std::int64_t high;
+        std::size_t successor;
+    };
+
+    // ends a block, successors[0] is the default and each other successor is the target of one or more cases. Case
+    // values are sign extended from the index's precision.
+    struct switch_branch : public statement {
+        std::unique_ptr<atom> index;
+        std::vector<switch_case> cases;
+        switch_branch(
+            std::unique_ptr<atom>&& index,
+            std::vector<switch_case>&& cases
+        ) :
+            statement(struct_tag()),
+            index(std::move(index)),
+            cases(std::move(cases)) {}
+
+        std::string to_string(bool types = false) const override {
+            std::ostringstream s;
+            s<<"switch "<<index->to_string(types)<<" [";
+            for(const auto& c : cases) {
+                s<<" "<<c.low;
+                if(c.high != c.low) {
+                    s<<"..."<<c.high;
+                }
+                s<<" -> "<<c.successor;
+            }
+            s<<" ]";
+            return std::move(s).str();
+        }
+        static constexpr statement_tag struct_tag() {
+            return statement_tag::switch_branch;
+        }
+    };
+
+    template<typename Base, typename F> requires std::same_as<std::remove_const_t<Base>, statement>
+    decltype(auto) visit(Base& base, F&& f) {
+        switch(base.tag) {
+            case statement_tag::binary_assignment: return detail::visit_as<binary_assignment>(base, f);
+            case statement_tag::unary_assignment: return detail::visit_as<unary_assignment>(base, f);
+            case statement_tag::call: return detail::visit_as<call>(base, f);
+            case statement_tag::function_return: return detail::visit_as<function_return>(base, f);
+            case statement_tag::cond: return detail::visit_as<cond>(base, f);
+            case statement_tag::intrinsic_call: return detail::visit_as<intrinsic_call>(base, f);
+            case statement_tag::switch_branch: return detail::visit_as<switch_branch>(base, f);
+            default:
+                VERIFY(false, "Unhandled statement", base.tag);
+                __builtin_unreachable();
+        }
+    }
+
     struct basic_block {
         int index;
         std::vector<phi> phis;
         std::vector<std::unique_ptr<statement>> statements;
         // for fallthrough, successors.size() will be 1
         // for cond, successors[0] is true branch and successors[1] is false branch
+        // for switch_branch, successors[0] is the default and the cases refer to the rest by position
+        // blocks ending in a return (or not returning at all) have no successors
         std::vector<int> successors;
 
         std::string to_string(bool types = false) const {
@@ -603,13 +1266,83 @@ namespace bimple {
         }
     };
 
+    // storage for a local variable whose address is taken or that isn't an ssa value, allocated on function entry
+    struct local {
+        std::string name;
+        std::unique_ptr<bimple::type> type;
+        // in bytes
+        std::size_t align;
+    };
+
+    enum class initializer_kind : std::uint8_t {
+        zero,
+        integer,
+        real,
+        string,
+        aggregate,
+        // address of a global or function plus a byte offset
+        address
+    };
+
+    // constant value of a global, its type is the global's or the enclosing aggregate element's
+    struct initializer {
+        initializer_kind kind = initializer_kind::zero;
+        // integer: the value sign extended from the type's precision, address: the byte offset
+        std::int64_t integer = 0;
+        // real: the literal, string: the bytes, address: the symbol
+        std::string text;
+        // aggregate: field indices for records and element indices for arrays, fields and elements that aren't listed
+        // are zero
+        std::vector<std::size_t> indices;
+        std::vector<initializer> elements;
+    };
+
+    enum class linkages : std::uint8_t {
+        external,
+        internal,
+        weak,
+        common
+    };
+
+    // how a thread_local global's address is computed, gcc's decl_tls_model
+    enum class tls_models : std::uint8_t {
+        // not thread local
+        none,
+        global_dynamic,
+        local_dynamic,
+        initial_exec,
+        local_exec
+    };
+
+    // a global variable or string literal the function refers to, declarations when the value is defined elsewhere
+    struct global {
+        std::string name;
+        std::unique_ptr<bimple::type> type;
+        // empty for globals defined in another translation unit
+        std::optional<initializer> value;
+        linkages linkage = linkages::external;
+        // in bytes
+        std::size_t align = 0;
+        // empty for the default section
+        std::string section;
+        bool is_constant = false;
+        // the address isn't significant, identical constants can be merged
+        bool unnamed_addr = false;
+        tls_models tls_model = tls_models::none;
+    };
+
     struct function {
         std::string identifier;
         std::vector<std::pair<std::string, std::unique_ptr<type>>> args;
         std::unique_ptr<type> return_type;
+        std::vector<local> locals;
+        std::vector<global> globals;
         // every bb's index in this vector should match it's index member
+        // block 0 is the entry block, block 1 is gcc's (empty) exit block until simplify_cfg removes it
         std::vector<basic_block> basic_blocks;
         std::vector<int> topological;
+        // bumped by anything that changes blocks or successors, cached analyses compare it to tell they're stale
+        unsigned cfg_version = 0;
 
         std::string to_string(bool types = false) const {
             std::ostringstream s;
@@ -620,6 +1353,15 @@ namespace bimple {
                 }
             );
             s<<"): "<<return_type->to_string()<<" {\n";
+            for(const auto& l : locals) {
+                s<<"local "<<l.name<<": "<<l.type->to_string()<<" align "<<l.align<<"\n";
+            }
+            for(const auto& g : globals) {
+                if(g.tls_model != tls_models::none) {
+                    s<<"thread_local ";
+                }
+                s<<(g.is_constant ? "constant @" : "global @")<<g.name<<": "<<g.type->to_string()<<"\n";
+            }
             for(const auto& bb : basic_blocks) {
                 s<<bb.index<<":\n"<<bb.to_string(types)<<"\n";
             }
@@ -627,6 +1369,86 @@ namespace bimple {
             return std::move(s).str();
         }
     };
+
+    namespace detail {
+        // the operands a memory reference or address_of computes its address from
+        template<typename Atom, typename F>
+        void for_each_address_operand(Atom& atom, F& f) {
+            if(auto* ref = downcast<mem_ref>(atom)) {
+                f(ref->base, true);
+                f(ref->offset, true);
+            } else if(auto* ref = downcast<component_ref>(atom)) {
+                for_each_address_operand(ref->base, f);
+            } else if(auto* ref = downcast<array_ref>(atom)) {
+                for_each_address_operand(ref->base, f);
+                f(ref->index, true);
+            } else if(auto* address = downcast<address_of>(atom)) {
+                for_each_address_operand(address->reference, f);
+            }
+        }
+    }
+
+    // calls f(std::unique_ptr<atom>&, bool is_address) on every atom of the statement that is read, including the
+    // address operands of a stored-to memory reference. Works on const statements too.
+    template<typename Statement, typename F>
+    void for_each_use(Statement& statement, F&& f) {
+        auto use = [&](auto& atom) {
+            if(is_memory_reference(*atom) || atom->tag == atom_tag::address_of) {
+                detail::for_each_address_operand(atom, f);
+            } else {
+                f(atom, false);
+            }
+        };
+        auto use_lhs = [&](auto& lhs) {
+            if(!lhs) {
+                return;
+            }
+            detail::for_each_address_operand(lhs, f);
+        };
+        visit(statement, [&](auto& s) {
+            using T = std::remove_cvref_t<decltype(s)>;
+            if constexpr(std::is_same_v<T, binary_assignment>) {
+                use_lhs(s.lhs);
+                use(s.rhs1);
+                use(s.rhs2);
+            } else if constexpr(std::is_same_v<T, unary_assignment>) {
+                use_lhs(s.lhs);
+                use(s.rhs);
+            } else if constexpr(std::is_same_v<T, call>) {
+                use_lhs(s.lhs);
+                use(s.fn);
+                for(auto& arg : s.args) {
+                    use(arg);
+                }
+            } else if constexpr(std::is_same_v<T, intrinsic_call>) {
+                use_lhs(s.lhs);
+                for(auto& arg : s.args) {
+                    use(arg);
+                }
+            } else if constexpr(std::is_same_v<T, cond>) {
+                use(s.lhs);
+                use(s.rhs);
+            } else if constexpr(std::is_same_v<T, switch_branch>) {
+                use(s.index);
+            } else if constexpr(std::is_same_v<T, function_return>) {
+                if(s.value) {
+                    use(s.value);
+                }
+            }
+        });
+    }
+
+    // the ssa name a statement defines, null for stores, branches, and returns
+    inline const variable* defined_variable(const statement& statement) {
+        return visit(statement, [] (const auto& s) -> const variable* {
+            using T = std::remove_cvref_t<decltype(s)>;
+            if constexpr(std::is_base_of_v<assignment, T> || std::is_same_v<T, call> || std::is_same_v<T, intrinsic_call>) {
+                return s.lhs ? downcast<variable>(s.lhs) : nullptr;
+            } else {
+                return nullptr;
+            }
+        });
+    }
 }
 
 #endif
@@ -0,0 +1,343 @@
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <span>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+
+#include "bimple.h"
+#include "bimple_analysis.h"
+
+namespace bimple {
+    namespace {
+        // turns per-block counts (in offsets[1..n]) into offsets
+        void counts_to_offsets(std::vector<int>& offsets) {
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        }
+    }
+
+    std::span<const int> cfg_info::predecessors(int block) const {
+        return std::span(predecessor_list).subspan(
+            predecessor_offsets[block],
+            predecessor_offsets[block + 1] - predecessor_offsets[block]
+        );
+    }
+
+    bool cfg_info::is_reachable(int block) const {
+        return rpo_number[block] >= 0;
+    }
+
+    std::span<const int> dominator_tree::children(int block) const {
+        return std::span(child_list).subspan(child_offsets[block], child_offsets[block + 1] - child_offsets[block]);
+    }
+
+    bool dominator_tree::dominates(int a, int b) const {
+        if(dfs_in[a] < 0 || dfs_in[b] < 0) {
+            return false;
+        }
+        return dfs_in[a] <= dfs_in[b] && dfs_out[b] <= dfs_out[a];
+    }
+
+    std::span<const int> dominance_frontiers::frontier(int block) const {
+        return std::span(list).subspan(offsets[block], offsets[block + 1] - offsets[block]);
+    }
+
+    std::span<const int> loop_nest::blocks(int loop) const {
+        return std::span(block_list).subspan(block_offsets[loop], block_offsets[loop + 1] - block_offsets[loop]);
+    }
+
+    std::span<const int> loop_nest::latches(int loop) const {
+        return std::span(latch_list).subspan(latch_offsets[loop], latch_offsets[loop + 1] - latch_offsets[loop]);
+    }
+
+    unsigned loop_nest::depth(int block) const {
+        return innermost[block] < 0 ? 0 : loops[innermost[block]].depth;
+    }
+
+    cfg_info compute_cfg(const function& fn) {
+        cfg_info cfg;
+        std::size_t n = fn.basic_blocks.size();
+        cfg.predecessor_offsets.assign(n + 1, 0);
+        for(const auto& bb : fn.basic_blocks) {
+            for(int successor : bb.successors) {
+                cfg.predecessor_offsets[successor + 1]++;
+            }
+        }
+        counts_to_offsets(cfg.predecessor_offsets);
+        cfg.predecessor_list.resize(cfg.predecessor_offsets[n]);
+        std::vector<int> next(cfg.predecessor_offsets.begin(), cfg.predecessor_offsets.end() - 1);
+        for(const auto& bb : fn.basic_blocks) {
+            for(int successor : bb.successors) {
+                cfg.predecessor_list[next[successor]++] = bb.index;
+            }
+        }
+        cfg.rpo_number.assign(n, -1);
+        if(n == 0) {
+            return cfg;
+        }
+        // iterative dfs, rpo_number doubles as the visited marker until the real numbers are assigned
+        std::vector<std::pair<int, std::size_t>> stack;
+        cfg.rpo.reserve(n);
+        stack.push_back({0, 0});
+        cfg.rpo_number[0] = 0;
+        while(!stack.empty()) {
+            auto& [block, edge] = stack.back();
+            const auto& successors = fn.basic_blocks[block].successors;
+            if(edge < successors.size()) {
+                int successor = successors[edge++];
+                if(cfg.rpo_number[successor] < 0) {
+                    cfg.rpo_number[successor] = 0;
+                    stack.push_back({successor, 0});
+                }
+            } else {
+                cfg.rpo.push_back(block);
+                stack.pop_back();
+            }
+        }
+        std::reverse(cfg.rpo.begin(), cfg.rpo.end());
+        for(std::size_t i = 0; i < cfg.rpo.size(); i++) {
+            cfg.rpo_number[cfg.rpo[i]] = int(i);
+        }
+        return cfg;
+    }
+
+    dominator_tree compute_dominators(const function& fn, const cfg_info& cfg) {
+        dominator_tree tree;
+        std::size_t n = fn.basic_blocks.size();
+        tree.idom.assign(n, -1);
+        tree.child_offsets.assign(n + 1, 0);
+        tree.dfs_in.assign(n, -1);
+        tree.dfs_out.assign(n, -1);
+        if(n == 0) {
+            return tree;
+        }
+        // "A Simple, Fast Dominance Algorithm", Cooper, Harvey, and Kennedy
+        auto intersect = [&](int a, int b) {
+            while(a != b) {
+                while(cfg.rpo_number[a] > cfg.rpo_number[b]) {
+                    a = tree.idom[a];
+                }
+                while(cfg.rpo_number[b] > cfg.rpo_number[a]) {
+                    b = tree.idom[b];
+                }
+            }
+            return a;
+        };
+        tree.idom[0] = 0;
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(std::size_t i = 1; i < cfg.rpo.size(); i++) {
+                int block = cfg.rpo[i];
+                int new_idom = -1;
+                for(int predecessor : cfg.predecessors(block)) {
+                    // unreachable or not processed yet
+                    if(tree.idom[predecessor] < 0) {
+                        continue;
+                    }
+                    new_idom = new_idom < 0 ? predecessor : intersect(predecessor, new_idom);
+                }
+                if(tree.idom[block] != new_idom) {
+                    tree.idom[block] = new_idom;
+                    changed = true;
+                }
+            }
+        }
+        tree.idom[0] = -1;
+        for(int block : cfg.rpo) {
+            if(tree.idom[block] >= 0) {
+                tree.child_offsets[tree.idom[block] + 1]++;
+            }
+        }
+        counts_to_offsets(tree.child_offsets);
+        tree.child_list.resize(tree.child_offsets[n]);
+        std::vector<int> next(tree.child_offsets.begin(), tree.child_offsets.end() - 1);
+        for(int block : cfg.rpo) {
+            if(tree.idom[block] >= 0) {
+                tree.child_list[next[tree.idom[block]]++] = block;
+            }
+        }
+        // number the tree
+        int counter = 0;
+        std::vector<std::pair<int, std::size_t>> stack;
+        stack.push_back({0, 0});
+        tree.dfs_in[0] = counter++;
+        while(!stack.empty()) {
+            auto& [block, child] = stack.back();
+            auto children = tree.children(block);
+            if(child < children.size()) {
+                int next_block = children[child++];
+                tree.dfs_in[next_block] = counter++;
+                stack.push_back({next_block, 0});
+            } else {
+                tree.dfs_out[block] = counter++;
+                stack.pop_back();
+            }
+        }
+        return tree;
+    }
+
+    dominance_frontiers compute_frontiers(const function& fn, const cfg_info& cfg, const dominator_tree& dominators) {
+        dominance_frontiers frontiers;
+        std::size_t n = fn.basic_blocks.size();
+        // (block, frontier block) pairs, a block is only added to a frontier once per join point
+        std::vector<std::pair<int, int>> pairs;
+        std::vector<int> last_join(n, -1);
+        for(int join : cfg.rpo) {
+            auto predecessors = cfg.predecessors(join);
+            if(predecessors.size() < 2) {
+                continue;
+            }
+            for(int predecessor : predecessors) {
+                if(!cfg.is_reachable(predecessor)) {
+                    continue;
+                }
+                for(int runner = predecessor; runner != dominators.idom[join]; runner = dominators.idom[runner]) {
+                    if(last_join[runner] != join) {
+                        last_join[runner] = join;
+                        pairs.push_back({runner, join});
+                    }
+                }
+            }
+        }
+        frontiers.offsets.assign(n + 1, 0);
+        for(const auto& [block, _] : pairs) {
+            frontiers.offsets[block + 1]++;
+        }
+        counts_to_offsets(frontiers.offsets);
+        frontiers.list.resize(pairs.size());
+        std::vector<int> next(frontiers.offsets.begin(), frontiers.offsets.end() - 1);
+        for(const auto& [block, join] : pairs) {
+            frontiers.list[next[block]++] = join;
+        }
+        return frontiers;
+    }
+
+    loop_nest compute_loops(const function& fn, const cfg_info& cfg, const dominator_tree& dominators) {
+        loop_nest nest;
+        std::size_t n = fn.basic_blocks.size();
+        nest.innermost.assign(n, -1);
+        nest.latch_offsets.push_back(0);
+        auto outermost = [&](int loop) {
+            while(nest.loops[loop].parent >= 0) {
+                loop = nest.loops[loop].parent;
+            }
+            return loop;
+        };
+        // headers are visited in postorder so inner loops are found before the loops containing them. The body of a
+        // loop is everything that reaches a latch backwards without passing the header, inner loops already found are
+        // skipped over through their header and become children.
+        std::vector<int> worklist;
+        for(auto it = cfg.rpo.rbegin(); it != cfg.rpo.rend(); ++it) {
+            int header = *it;
+            for(int predecessor : cfg.predecessors(header)) {
+                if(dominators.dominates(header, predecessor)) {
+                    nest.latch_list.push_back(predecessor);
+                    worklist.push_back(predecessor);
+                }
+            }
+            if(worklist.empty()) {
+                continue;
+            }
+            int loop = int(nest.loops.size());
+            nest.loops.push_back({header, -1, 0});
+            nest.latch_offsets.push_back(int(nest.latch_list.size()));
+            nest.innermost[header] = loop;
+            while(!worklist.empty()) {
+                int block = worklist.back();
+                worklist.pop_back();
+                if(nest.innermost[block] < 0) {
+                    nest.innermost[block] = loop;
+                    for(int predecessor : cfg.predecessors(block)) {
+                        if(cfg.is_reachable(predecessor)) {
+                            worklist.push_back(predecessor);
+                        }
+                    }
+                } else if(int inner = outermost(nest.innermost[block]); inner != loop) {
+                    nest.loops[inner].parent = loop;
+                    for(int predecessor : cfg.predecessors(nest.loops[inner].header)) {
+                        if(cfg.is_reachable(predecessor)) {
+                            worklist.push_back(predecessor);
+                        }
+                    }
+                }
+            }
+        }
+        // parents have larger indices
+        for(auto it = nest.loops.rbegin(); it != nest.loops.rend(); ++it) {
+            it->depth = it->parent < 0 ? 1 : nest.loops[it->parent].depth + 1;
+        }
+        nest.block_offsets.assign(nest.loops.size() + 1, 0);
+        for(int block : cfg.rpo) {
+            for(int loop = nest.innermost[block]; loop >= 0; loop = nest.loops[loop].parent) {
+                nest.block_offsets[loop + 1]++;
+            }
+        }
+        counts_to_offsets(nest.block_offsets);
+        nest.block_list.resize(nest.block_offsets.back());
+        // headers come first in their loop, they're also first in rpo among the loop's blocks
+        std::vector<int> next(nest.block_offsets.begin(), nest.block_offsets.end() - 1);
+        for(int block : cfg.rpo) {
+            for(int loop = nest.innermost[block]; loop >= 0; loop = nest.loops[loop].parent) {
+                nest.block_list[next[loop]++] = block;
+            }
+        }
+        for(std::size_t loop = 0; loop < nest.loops.size(); loop++) {
+            ASSERT(nest.block_list[nest.block_offsets[loop]] == nest.loops[loop].header);
+        }
+        return nest;
+    }
+
+    analysis_manager::analysis_manager(const function& fn) : fn(fn), version(fn.cfg_version) {}
+
+    void analysis_manager::validate() {
+        if(version != fn.cfg_version) {
+            invalidate();
+        }
+    }
+
+    const cfg_info& analysis_manager::get_cfg() {
+        validate();
+        if(!cfg) {
+            cfg = compute_cfg(fn);
+        }
+        return *cfg;
+    }
+
+    const dominator_tree& analysis_manager::get_dominators() {
+        validate();
+        if(!dominators) {
+            dominators = compute_dominators(fn, get_cfg());
+        }
+        return *dominators;
+    }
+
+    const dominance_frontiers& analysis_manager::get_frontiers() {
+        validate();
+        if(!frontiers) {
+            frontiers = compute_frontiers(fn, get_cfg(), get_dominators());
+        }
+        return *frontiers;
+    }
+
+    const loop_nest& analysis_manager::get_loops() {
+        validate();
+        if(!loops) {
+            loops = compute_loops(fn, get_cfg(), get_dominators());
+        }
+        return *loops;
+    }
+
+    void analysis_manager::invalidate() {
+        cfg.reset();
+        dominators.reset();
+        frontiers.reset();
+        loops.reset();
+        version = fn.cfg_version;
+    }
+}
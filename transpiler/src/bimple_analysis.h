@@ -0,0 +1,100 @@
+#ifndef BIMPLE_ANALYSIS_H
+#define BIMPLE_ANALYSIS_H
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "bimple.h"
+
+// Control flow analyses over bimple functions. Results are indexed by block index and stored in flat arrays, lists per
+// block are compressed (offsets[i] .. offsets[i + 1] into one shared array) instead of vectors of vectors.
+namespace bimple {
+    struct cfg_info {
+        std::vector<int> predecessor_offsets;
+        std::vector<int> predecessor_list;
+        // reachable blocks in reverse postorder, starting with the entry block
+        std::vector<int> rpo;
+        // position of each block in rpo, -1 for unreachable blocks
+        std::vector<int> rpo_number;
+
+        std::span<const int> predecessors(int block) const;
+        bool is_reachable(int block) const;
+    };
+
+    // Immediate dominators computed with the Cooper-Harvey-Kennedy iterative algorithm
+    struct dominator_tree {
+        // -1 for the entry block and unreachable blocks
+        std::vector<int> idom;
+        std::vector<int> child_offsets;
+        std::vector<int> child_list;
+        // dfs entry and exit numbers in the tree, a dominates b iff a's interval contains b's
+        std::vector<int> dfs_in;
+        std::vector<int> dfs_out;
+
+        std::span<const int> children(int block) const;
+        // reflexive, false if either block is unreachable
+        bool dominates(int a, int b) const;
+    };
+
+    struct dominance_frontiers {
+        std::vector<int> offsets;
+        std::vector<int> list;
+
+        std::span<const int> frontier(int block) const;
+    };
+
+    // Natural loops, loops sharing a header are one loop. Loops are numbered innermost first, so a loop's parent always
+    // has a larger index.
+    struct loop_nest {
+        struct loop {
+            int header;
+            // -1 for outermost loops
+            int parent;
+            // 1 for outermost loops
+            unsigned depth;
+        };
+        std::vector<loop> loops;
+        // innermost loop containing each block, -1 if none
+        std::vector<int> innermost;
+        // blocks of each loop including the blocks of nested loops, header first
+        std::vector<int> block_offsets;
+        std::vector<int> block_list;
+        // back edge sources of each loop
+        std::vector<int> latch_offsets;
+        std::vector<int> latch_list;
+
+        std::span<const int> blocks(int loop) const;
+        std::span<const int> latches(int loop) const;
+        // 0 outside of loops
+        unsigned depth(int block) const;
+    };
+
+    cfg_info compute_cfg(const function& fn);
+    dominator_tree compute_dominators(const function& fn, const cfg_info& cfg);
+    dominance_frontiers compute_frontiers(const function& fn, const cfg_info& cfg, const dominator_tree& dominators);
+    loop_nest compute_loops(const function& fn, const cfg_info& cfg, const dominator_tree& dominators);
+
+    // Computes analyses on demand and caches them until function::cfg_version changes. Only the shape of the cfg is
+    // analyzed, so changes to statements don't invalidate anything.
+    class analysis_manager {
+        const function& fn;
+        unsigned version;
+        std::optional<cfg_info> cfg;
+        std::optional<dominator_tree> dominators;
+        std::optional<dominance_frontiers> frontiers;
+        std::optional<loop_nest> loops;
+
+        void validate();
+    public:
+        explicit analysis_manager(const function& fn);
+        const cfg_info& get_cfg();
+        const dominator_tree& get_dominators();
+        const dominance_frontiers& get_frontiers();
+        const loop_nest& get_loops();
+        void invalidate();
+    };
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_builder.h"
+
+namespace bimple {
+    // bimple types take sizes in bits, like gcc's TYPE_SIZE
+    std::unique_ptr<integer> make_integer(unsigned bits, bool is_unsigned) {
+        return std::make_unique<integer>(bits, is_unsigned, bits == 1 ? 8 : bits);
+    }
+
+    std::unique_ptr<real> make_real(unsigned bits) {
+        return std::make_unique<real>(bits, bits == 80 ? 128 : bits);
+    }
+
+    std::unique_ptr<pointer> make_pointer(std::unique_ptr<type>&& target_type) {
+        return std::make_unique<pointer>(std::move(target_type), 64);
+    }
+
+    std::unique_ptr<void_type> make_void() {
+        return std::make_unique<void_type>();
+    }
+
+    std::unique_ptr<integer_constant> make_constant(int value, std::unique_ptr<type>&& type) {
+        return std::make_unique<integer_constant>(value, std::move(type));
+    }
+
+    builder::builder(std::string identifier, std::unique_ptr<type>&& return_type) {
+        fn.identifier = std::move(identifier);
+        fn.return_type = std::move(return_type);
+        create_block();
+        create_block();
+    }
+
+    std::unique_ptr<variable> builder::add_argument(std::string name, std::unique_ptr<type>&& type) {
+        auto ref = std::make_unique<variable>(std::string(name), type->clone());
+        fn.args.push_back({std::move(name), std::move(type)});
+        return ref;
+    }
+
+    std::unique_ptr<local_ref> builder::add_local(std::string name, std::unique_ptr<type>&& type, std::size_t align) {
+        auto ref = std::make_unique<local_ref>(std::string(name), type->clone());
+        fn.locals.push_back({std::move(name), std::move(type), align});
+        return ref;
+    }
+
+    std::unique_ptr<global_ref> builder::add_global(global&& g) {
+        auto ref = std::make_unique<global_ref>(std::string(g.name), g.type->clone());
+        fn.globals.push_back(std::move(g));
+        return ref;
+    }
+
+    int builder::create_block() {
+        basic_block bb;
+        bb.index = int(fn.basic_blocks.size());
+        fn.basic_blocks.push_back(std::move(bb));
+        return fn.basic_blocks.back().index;
+    }
+
+    void builder::set_block(int index) {
+        ASSERT(index >= 0 && index < int(fn.basic_blocks.size()), index);
+        current = index;
+    }
+
+    int builder::current_block() const {
+        return current;
+    }
+
+    std::unique_ptr<variable> builder::fresh(std::unique_ptr<type>&& type) {
+        return std::make_unique<variable>(fmt::format("_{}", temp_id++), std::move(type));
+    }
+
+    std::unique_ptr<variable> builder::binary(
+        operators op,
+        std::unique_ptr<atom>&& rhs1,
+        std::unique_ptr<atom>&& rhs2,
+        std::unique_ptr<type>&& result_type
+    ) {
+        if(!result_type) {
+            switch(op) {
+                case operators::lt:
+                case operators::gt:
+                case operators::lteq:
+                case operators::gteq:
+                case operators::eq:
+                case operators::neq:
+                    result_type = make_integer(1, true);
+                    break;
+                default:
+                    result_type = rhs1->type->clone();
+            }
+        }
+        auto result = fresh(std::move(result_type));
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<binary_assignment>(result->clone(), std::move(rhs1), std::move(rhs2), op)
+        );
+        return result;
+    }
+
+    std::unique_ptr<variable> builder::unary(
+        operators op,
+        std::unique_ptr<atom>&& rhs,
+        std::unique_ptr<type>&& result_type
+    ) {
+        auto result = fresh(result_type ? std::move(result_type) : rhs->type->clone());
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<unary_assignment>(result->clone(), std::move(rhs), op)
+        );
+        return result;
+    }
+
+    std::unique_ptr<variable> builder::call(
+        std::unique_ptr<atom>&& callee,
+        std::vector<std::unique_ptr<atom>>&& args
+    ) {
+        auto* fn_type = VERIFY(downcast<function_type>(VERIFY(downcast<pointer>(callee->type))->target_type));
+        std::unique_ptr<variable> result;
+        if(fn_type->return_type->tag != type_tag::void_type) {
+            result = fresh(fn_type->return_type->clone());
+        }
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<bimple::call>(std::move(callee), result ? result->clone() : nullptr, std::move(args))
+        );
+        return result;
+    }
+
+    std::unique_ptr<variable> builder::intrinsic(
+        intrinsics id,
+        std::vector<std::unique_ptr<atom>>&& args,
+        std::unique_ptr<type>&& result_type
+    ) {
+        std::unique_ptr<variable> result;
+        if(result_type) {
+            result = fresh(std::move(result_type));
+        }
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<intrinsic_call>(id, result ? result->clone() : nullptr, std::move(args))
+        );
+        return result;
+    }
+
+    void builder::store(std::unique_ptr<atom>&& base, int offset, std::unique_ptr<atom>&& value) {
+        auto type = value->type->clone();
+        auto offset_atom = make_constant(offset, make_integer(64, false));
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<unary_assignment>(
+                std::make_unique<mem_ref>(std::move(base), std::move(offset_atom), std::move(type)),
+                std::move(value),
+                operators::assign
+            )
+        );
+    }
+
+    void builder::store(std::unique_ptr<atom>&& reference, std::unique_ptr<atom>&& value) {
+        VERIFY(is_memory_reference(*reference), reference->tag);
+        auto op = is_memory_reference(*value) ? operators::mem_ref : operators::assign;
+        fn.basic_blocks[current].statements.push_back(
+            std::make_unique<unary_assignment>(std::move(reference), std::move(value), op)
+        );
+    }
+
+    std::unique_ptr<variable> builder::phi(
+        std::unique_ptr<type>&& type,
+        std::vector<std::pair<int, std::unique_ptr<atom>>>&& values
+    ) {
+        auto result = fresh(std::move(type));
+        bimple::phi phi;
+        phi.result = variable(std::string(result->name), result->type->clone());
+        phi.values = std::move(values);
+        fn.basic_blocks[current].phis.push_back(std::move(phi));
+        return result;
+    }
+
+    void builder::ret(std::unique_ptr<atom>&& value) {
+        auto& bb = fn.basic_blocks[current];
+        bb.statements.push_back(std::make_unique<function_return>(std::move(value)));
+        bb.successors.clear();
+    }
+
+    void builder::br(int target) {
+        fn.basic_blocks[current].successors = {target};
+    }
+
+    void builder::cond_br(
+        operators op,
+        std::unique_ptr<atom>&& lhs,
+        std::unique_ptr<atom>&& rhs,
+        int if_true,
+        int if_false
+    ) {
+        auto& bb = fn.basic_blocks[current];
+        bb.statements.push_back(std::make_unique<cond>(std::move(lhs), std::move(rhs), op));
+        bb.successors = {if_true, if_false};
+    }
+
+    void builder::switch_br(
+        std::unique_ptr<atom>&& index,
+        int default_target,
+        const std::vector<std::tuple<std::int64_t, std::int64_t, int>>& cases
+    ) {
+        auto& bb = fn.basic_blocks[current];
+        bb.successors = {default_target};
+        std::vector<switch_case> switch_cases;
+        for(const auto& [low, high, target] : cases) {
+            auto it = std::ranges::find(bb.successors, target);
+            if(it == bb.successors.end()) {
+                it = bb.successors.insert(it, target);
+            }
+            switch_cases.push_back({low, high, std::size_t(it - bb.successors.begin())});
+        }
+        bb.statements.push_back(std::make_unique<switch_branch>(std::move(index), std::move(switch_cases)));
+    }
+
+    function builder::finish() && {
+        // fall through from the entry block to the first block created
+        auto& entry = fn.basic_blocks[0];
+        bool entry_returns = !entry.statements.empty() && entry.statements.back()->tag == statement_tag::function_return;
+        if(entry.successors.empty() && !entry_returns && fn.basic_blocks.size() > 2) {
+            entry.successors = {2};
+        }
+        // reverse postorder
+        std::vector<bool> visited(fn.basic_blocks.size(), false);
+        std::vector<std::pair<int, std::size_t>> stack;
+        std::vector<int> postorder;
+        stack.push_back({0, 0});
+        visited[0] = true;
+        while(!stack.empty()) {
+            auto& [index, next] = stack.back();
+            const auto& successors = fn.basic_blocks[index].successors;
+            if(next < successors.size()) {
+                int successor = successors[next++];
+                if(!visited[successor]) {
+                    visited[successor] = true;
+                    stack.push_back({successor, 0});
+                }
+            } else {
+                postorder.push_back(index);
+                stack.pop_back();
+            }
+        }
+        std::reverse(postorder.begin(), postorder.end());
+        fn.topological = std::move(postorder);
+        return std::move(fn);
+    }
+}
@@ -0,0 +1,99 @@
+#ifndef BIMPLE_BUILDER_H
+#define BIMPLE_BUILDER_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "bimple.h"
+
+namespace bimple {
+    std::unique_ptr<integer> make_integer(unsigned bits, bool is_unsigned);
+    std::unique_ptr<real> make_real(unsigned bits);
+    std::unique_ptr<pointer> make_pointer(std::unique_ptr<type>&& target_type);
+    std::unique_ptr<void_type> make_void();
+    std::unique_ptr<integer_constant> make_constant(int value, std::unique_ptr<type>&& type);
+
+    // Programmatic construction of bimple functions, e.g. for benchmarks, fuzzers, and frontends other than gcc.
+    // Mirrors the layout produced by the gimple converter: block 0 is the entry block and block 1 is the exit block,
+    // which nothing branches to.
+    class builder {
+        function fn;
+        int current = 0;
+        unsigned temp_id = 0;
+    public:
+        builder(std::string identifier, std::unique_ptr<type>&& return_type);
+
+        // returns a reference to the argument
+        std::unique_ptr<variable> add_argument(std::string name, std::unique_ptr<type>&& type);
+        // returns a reference to the local's storage
+        std::unique_ptr<local_ref> add_local(std::string name, std::unique_ptr<type>&& type, std::size_t align);
+        // returns a reference to the global's storage
+        std::unique_ptr<global_ref> add_global(global&& g);
+
+        // creates a new basic block, doesn't change the insertion block
+        int create_block();
+        void set_block(int index);
+        int current_block() const;
+
+        // new ssa name, _<n>
+        std::unique_ptr<variable> fresh(std::unique_ptr<type>&& type);
+
+        // these append to the current block and return a reference to the result
+        // result_type defaults to the operand type (or uint1 for comparisons)
+        std::unique_ptr<variable> binary(
+            operators op,
+            std::unique_ptr<atom>&& rhs1,
+            std::unique_ptr<atom>&& rhs2,
+            std::unique_ptr<type>&& result_type = nullptr
+        );
+        std::unique_ptr<variable> unary(
+            operators op,
+            std::unique_ptr<atom>&& rhs,
+            std::unique_ptr<type>&& result_type = nullptr
+        );
+        // null for functions returning void
+        std::unique_ptr<variable> call(
+            std::unique_ptr<atom>&& fn,
+            std::vector<std::unique_ptr<atom>>&& args
+        );
+        // null without a result_type
+        std::unique_ptr<variable> intrinsic(
+            intrinsics id,
+            std::vector<std::unique_ptr<atom>>&& args,
+            std::unique_ptr<type>&& result_type = nullptr
+        );
+        void store(std::unique_ptr<atom>&& base, int offset, std::unique_ptr<atom>&& value);
+        // store to a memory reference, value may be another memory reference (a copy) or a zero_initializer
+        void store(std::unique_ptr<atom>&& reference, std::unique_ptr<atom>&& value);
+        std::unique_ptr<variable> phi(
+            std::unique_ptr<type>&& type,
+            std::vector<std::pair<int, std::unique_ptr<atom>>>&& values
+        );
+
+        // terminators
+        void ret(std::unique_ptr<atom>&& value = nullptr);
+        void br(int target);
+        void cond_br(
+            operators op,
+            std::unique_ptr<atom>&& lhs,
+            std::unique_ptr<atom>&& rhs,
+            int if_true,
+            int if_false
+        );
+        // cases are {low, high, target block}, values that no case covers go to default_target
+        void switch_br(
+            std::unique_ptr<atom>&& index,
+            int default_target,
+            const std::vector<std::tuple<std::int64_t, std::int64_t, int>>& cases
+        );
+
+        // computes the topological order and returns the function
+        function finish() &&;
+    };
+}
+
+#endif
@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+
+#include "bimple.h"
+#include "bimple_analysis.h"
+#include "bimple_dataflow.h"
+
+namespace bimple {
+    namespace {
+        constexpr std::size_t word_bits = 64;
+
+        // dst |= src, branch free so it vectorizes
+        bool union_into(std::span<std::uint64_t> dst, std::span<const std::uint64_t> src) {
+            std::uint64_t changed = 0;
+            for(std::size_t i = 0; i < dst.size(); i++) {
+                std::uint64_t value = dst[i] | src[i];
+                changed |= value ^ dst[i];
+                dst[i] = value;
+            }
+            return changed != 0;
+        }
+
+        // result = gen | (meet & ~kill)
+        bool transfer(
+            std::span<std::uint64_t> result,
+            std::span<const std::uint64_t> gen,
+            std::span<const std::uint64_t> meet,
+            std::span<const std::uint64_t> kill
+        ) {
+            std::uint64_t changed = 0;
+            for(std::size_t i = 0; i < result.size(); i++) {
+                std::uint64_t value = gen[i] | (meet[i] & ~kill[i]);
+                changed |= value ^ result[i];
+                result[i] = value;
+            }
+            return changed != 0;
+        }
+    }
+
+    int value_numbering::id(const std::string& name) const {
+        auto it = ids.find(name);
+        return it == ids.end() ? -1 : it->second;
+    }
+
+    std::size_t value_numbering::size() const {
+        return names.size();
+    }
+
+    value_numbering number_values(const function& fn) {
+        value_numbering values;
+        auto add = [&](const std::string& name) {
+            if(values.ids.insert({name, int(values.names.size())}).second) {
+                values.names.push_back(name);
+            }
+        };
+        for(const auto& [name, _] : fn.args) {
+            add(name);
+        }
+        for(const auto& bb : fn.basic_blocks) {
+            for(const auto& phi : bb.phis) {
+                add(phi.result.name);
+            }
+            for(const auto& statement : bb.statements) {
+                if(auto* var = defined_variable(*statement)) {
+                    add(var->name);
+                }
+            }
+        }
+        return values;
+    }
+
+    block_sets::block_sets(std::size_t blocks, std::size_t bits) :
+        word_count((bits + word_bits - 1) / word_bits),
+        words(blocks * word_count, 0) {}
+
+    std::span<std::uint64_t> block_sets::operator[](int block) {
+        return std::span(words).subspan(std::size_t(block) * word_count, word_count);
+    }
+
+    std::span<const std::uint64_t> block_sets::operator[](int block) const {
+        return std::span(words).subspan(std::size_t(block) * word_count, word_count);
+    }
+
+    bool block_sets::test(int block, std::size_t bit) const {
+        return ((*this)[block][bit / word_bits] >> (bit % word_bits)) & 1;
+    }
+
+    void block_sets::set(int block, std::size_t bit) {
+        (*this)[block][bit / word_bits] |= std::uint64_t(1) << (bit % word_bits);
+    }
+
+    void block_sets::reset(int block, std::size_t bit) {
+        (*this)[block][bit / word_bits] &= ~(std::uint64_t(1) << (bit % word_bits));
+    }
+
+    std::size_t block_sets::count(int block) const {
+        std::size_t total = 0;
+        for(auto word : (*this)[block]) {
+            total += std::size_t(std::popcount(word));
+        }
+        return total;
+    }
+
+    std::size_t block_sets::words_per_block() const {
+        return word_count;
+    }
+
+    dataflow_result solve_dataflow(
+        const function& fn,
+        const cfg_info& cfg,
+        dataflow_direction direction,
+        const block_sets& gen,
+        const block_sets& kill,
+        const block_sets& boundary
+    ) {
+        std::size_t blocks = fn.basic_blocks.size();
+        std::size_t bits = gen.words_per_block() * word_bits;
+        dataflow_result result{block_sets(blocks, bits), block_sets(blocks, bits), 0};
+        bool forward = direction == dataflow_direction::forward;
+        auto& meet_sets = forward ? result.in : result.out;
+        auto& transfer_sets = forward ? result.out : result.in;
+        std::vector<int> order(fn.topological.begin(), fn.topological.end());
+        if(!forward) {
+            std::reverse(order.begin(), order.end());
+        }
+        // round robin in (reverse) reverse postorder, converges in loop nesting depth + 2 passes for reducible cfgs
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            result.iterations++;
+            for(int block : order) {
+                ASSERT(block >= 0 && std::size_t(block) < blocks);
+                auto meet = meet_sets[block];
+                std::copy(boundary[block].begin(), boundary[block].end(), meet.begin());
+                if(forward) {
+                    for(int predecessor : cfg.predecessors(block)) {
+                        union_into(meet, transfer_sets[predecessor]);
+                    }
+                } else {
+                    for(int successor : fn.basic_blocks[block].successors) {
+                        union_into(meet, transfer_sets[successor]);
+                    }
+                }
+                changed |= transfer(transfer_sets[block], gen[block], meet, kill[block]);
+            }
+        }
+        return result;
+    }
+
+    bool liveness::is_live_in(int block, const std::string& name) const {
+        int id = values.id(name);
+        return id >= 0 && sets.in.test(block, std::size_t(id));
+    }
+
+    bool liveness::is_live_out(int block, const std::string& name) const {
+        int id = values.id(name);
+        return id >= 0 && sets.out.test(block, std::size_t(id));
+    }
+
+    liveness compute_liveness(const function& fn, const cfg_info& cfg) {
+        auto values = number_values(fn);
+        std::size_t blocks = fn.basic_blocks.size();
+        // gen: upward exposed uses, kill: definitions, boundary: phi operands, which are used at the end of the
+        // predecessor they come from
+        block_sets gen(blocks, values.size());
+        block_sets kill(blocks, values.size());
+        block_sets boundary(blocks, values.size());
+        for(const auto& bb : fn.basic_blocks) {
+            for(const auto& phi : bb.phis) {
+                kill.set(bb.index, std::size_t(values.id(phi.result.name)));
+                for(const auto& [predecessor, value] : phi.values) {
+                    if(auto* var = downcast<variable>(value); var && values.id(var->name) >= 0) {
+                        boundary.set(predecessor, std::size_t(values.id(var->name)));
+                    }
+                }
+            }
+            for(const auto& statement : bb.statements) {
+                for_each_use(*statement, [&](const std::unique_ptr<atom>& use, bool) {
+                    auto* var = downcast<variable>(use);
+                    if(!var) {
+                        return;
+                    }
+                    int id = values.id(var->name);
+                    if(id >= 0 && !kill.test(bb.index, std::size_t(id))) {
+                        gen.set(bb.index, std::size_t(id));
+                    }
+                });
+                if(auto* var = defined_variable(*statement)) {
+                    kill.set(bb.index, std::size_t(values.id(var->name)));
+                }
+            }
+        }
+        auto sets = solve_dataflow(fn, cfg, dataflow_direction::backward, gen, kill, boundary);
+        return {std::move(values), std::move(sets)};
+    }
+
+    bool reaching_definitions::reaches_entry(int block, const std::string& name) const {
+        int id = values.id(name);
+        return id >= 0 && sets.in.test(block, std::size_t(id));
+    }
+
+    bool reaching_definitions::reaches_exit(int block, const std::string& name) const {
+        int id = values.id(name);
+        return id >= 0 && sets.out.test(block, std::size_t(id));
+    }
+
+    reaching_definitions compute_reaching_definitions(const function& fn, const cfg_info& cfg) {
+        auto values = number_values(fn);
+        std::size_t blocks = fn.basic_blocks.size();
+        block_sets gen(blocks, values.size());
+        block_sets kill(blocks, values.size());
+        block_sets boundary(blocks, values.size());
+        if(blocks > 0) {
+            for(const auto& [name, _] : fn.args) {
+                boundary.set(0, std::size_t(values.id(name)));
+            }
+        }
+        for(const auto& bb : fn.basic_blocks) {
+            for(const auto& phi : bb.phis) {
+                gen.set(bb.index, std::size_t(values.id(phi.result.name)));
+            }
+            for(const auto& statement : bb.statements) {
+                if(auto* var = defined_variable(*statement)) {
+                    gen.set(bb.index, std::size_t(values.id(var->name)));
+                }
+            }
+        }
+        auto sets = solve_dataflow(fn, cfg, dataflow_direction::forward, gen, kill, boundary);
+        return {std::move(values), std::move(sets)};
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef BIMPLE_DATAFLOW_H
+#define BIMPLE_DATAFLOW_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bimple.h"
+#include "bimple_analysis.h"
+
+// Bit vector dataflow over bimple functions. Sets are dense over value ids and every block's set lives in one flat
+// array of 64-bit words, so the meet and transfer functions are straight loops over words that the compiler vectorizes.
+namespace bimple {
+    // Dense ids for the ssa names of a function: arguments first, then phi results and assigned variables in block
+    // order
+    struct value_numbering {
+        std::vector<std::string> names;
+        std::unordered_map<std::string, int> ids;
+
+        // -1 for names that aren't defined in the function
+        int id(const std::string& name) const;
+        std::size_t size() const;
+    };
+
+    value_numbering number_values(const function& fn);
+
+    // A set of the same number of bits for every block
+    class block_sets {
+        std::size_t word_count;
+        std::vector<std::uint64_t> words;
+    public:
+        block_sets(std::size_t blocks, std::size_t bits);
+        std::span<std::uint64_t> operator[](int block);
+        std::span<const std::uint64_t> operator[](int block) const;
+        bool test(int block, std::size_t bit) const;
+        void set(int block, std::size_t bit);
+        void reset(int block, std::size_t bit);
+        std::size_t count(int block) const;
+        std::size_t words_per_block() const;
+    };
+
+    enum class dataflow_direction {
+        forward,
+        backward
+    };
+
+    // in and out are in program order for both directions: a forward problem computes out from in, a backward problem
+    // computes in from out
+    struct dataflow_result {
+        block_sets in;
+        block_sets out;
+        // passes over the blocks until nothing changed
+        unsigned iterations;
+    };
+
+    // Solves transfer(b) = gen(b) | (meet(b) & ~kill(b)), where meet(b) is boundary(b) plus the union of transfer() over
+    // the predecessors (forward) or successors (backward). Blocks are visited in function::topological order (reversed
+    // for backward problems), which has to be current; blocks not in it are unreachable and keep empty sets.
+    dataflow_result solve_dataflow(
+        const function& fn,
+        const cfg_info& cfg,
+        dataflow_direction direction,
+        const block_sets& gen,
+        const block_sets& kill,
+        const block_sets& boundary
+    );
+
+    // Live ssa values at block boundaries. A phi operand is live out of the predecessor it comes from, not live into
+    // the phi's block.
+    struct liveness {
+        value_numbering values;
+        dataflow_result sets;
+
+        bool is_live_in(int block, const std::string& name) const;
+        bool is_live_out(int block, const std::string& name) const;
+    };
+
+    liveness compute_liveness(const function& fn, const cfg_info& cfg);
+
+    // Definitions (indexed by the id of the value they define) that reach block boundaries, arguments are defined on
+    // entry. In ssa form nothing is killed, so this is the set of definitions on some path from the entry block.
+    struct reaching_definitions {
+        value_numbering values;
+        dataflow_result sets;
+
+        bool reaches_entry(int block, const std::string& name) const;
+        bool reaches_exit(int block, const std::string& name) const;
+    };
+
+    reaching_definitions compute_reaching_definitions(const function& fn, const cfg_info& cfg);
+}
+
+#endif
@@ -0,0 +1,743 @@
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_passes.h"
+#include "bimple_uses.h"
+#include "utils.h"
+
+namespace bimple {
+    namespace {
+        // whether a value of type a can stand in for a value of type b in llvm ir, i.e. a copy between them is a no-op
+        bool same_representation(const type& a, const type& b) {
+            if(a.tag != b.tag) {
+                return false;
+            }
+            if(auto* int_a = downcast<integer>(&a)) {
+                return int_a->bits == downcast<integer>(&b)->bits;
+            } else if(auto* real_a = downcast<real>(&a)) {
+                return real_a->bits == downcast<real>(&b)->bits;
+            } else if(a.tag == type_tag::pointer) {
+                return true;
+            } else {
+                return a == b;
+            }
+        }
+
+        bool is_copy(const statement& statement) {
+            auto* assign = downcast<unary_assignment>(&statement);
+            return assign
+                && assign->op == operators::assign
+                && assign->lhs->tag == atom_tag::variable
+                && (
+                    assign->rhs->tag == atom_tag::variable
+                    || assign->rhs->tag == atom_tag::integer_constant
+                    || assign->rhs->tag == atom_tag::real_constant
+                )
+                && same_representation(*assign->lhs->type, *assign->rhs->type);
+        }
+
+        // Constants are folded as the value codegen prints: integer_constant::value sign-extended to the type's width
+
+        std::int64_t wrap(std::uint64_t value, const integer& type) {
+            if(type.bits >= 64) {
+                return std::int64_t(value);
+            }
+            std::uint64_t mask = (std::uint64_t(1) << type.bits) - 1;
+            value &= mask;
+            if(!type.is_unsigned && (value >> (type.bits - 1)) & 1) {
+                value |= ~mask;
+            }
+            return std::int64_t(value);
+        }
+
+        const integer* foldable_integer(const type& type) {
+            auto* int_type = downcast<integer>(&type);
+            return int_type && int_type->bits <= 64 ? int_type : nullptr;
+        }
+
+        const real* foldable_real(const type& type) {
+            auto* real_type = downcast<real>(&type);
+            return real_type && (real_type->bits == 32 || real_type->bits == 64) ? real_type : nullptr;
+        }
+
+        std::optional<std::int64_t> integer_value(const atom& atom) {
+            auto* constant = downcast<integer_constant>(&atom);
+            if(!constant) {
+                return std::nullopt;
+            }
+            auto* type = foldable_integer(*constant->type);
+            if(!type) {
+                return std::nullopt;
+            }
+            return wrap(std::uint64_t(std::int64_t(constant->value)), *type);
+        }
+
+        // real constants are either decimal (from gcc) or the bits of a double in llvm's hex notation (from folding)
+        std::optional<double> real_value(const atom& atom) {
+            auto* constant = downcast<real_constant>(&atom);
+            if(!constant || !foldable_real(*constant->type)) {
+                return std::nullopt;
+            }
+            const std::string& text = constant->value;
+            double value;
+            if(text.starts_with("0x")) {
+                if(text.size() != 18) {
+                    return std::nullopt;
+                }
+                char* end;
+                std::uint64_t bits = std::strtoull(text.c_str() + 2, &end, 16);
+                if(*end != 0) {
+                    return std::nullopt;
+                }
+                value = std::bit_cast<double>(bits);
+            } else {
+                char* end;
+                value = downcast<real>(constant->type)->bits == 32
+                    ? double(std::strtof(text.c_str(), &end))
+                    : std::strtod(text.c_str(), &end);
+                if(*end != 0) {
+                    return std::nullopt;
+                }
+            }
+            if(!std::isfinite(value)) {
+                return std::nullopt;
+            }
+            return value;
+        }
+
+        // null if the value can't be written as an integer_constant of the type, i.e. needs more than 32 bits
+        std::unique_ptr<atom> make_integer_constant(std::int64_t value, const type& type) {
+            value = wrap(std::uint64_t(value), *downcast<integer>(&type));
+            int stored;
+            if(value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+                stored = int(value);
+            } else if(downcast<integer>(&type)->bits <= 32) {
+                stored = int(std::uint32_t(value));
+            } else {
+                return nullptr;
+            }
+            return std::make_unique<integer_constant>(stored, type.clone());
+        }
+
+        std::unique_ptr<atom> make_real_constant(double value, const type& type) {
+            if(downcast<real>(&type)->bits == 32) {
+                value = double(float(value));
+            }
+            if(!std::isfinite(value)) {
+                return nullptr;
+            }
+            return std::make_unique<real_constant>(
+                fmt::format("0x{:016X}", std::bit_cast<std::uint64_t>(value)),
+                type.clone()
+            );
+        }
+
+        template<typename T>
+        std::optional<bool> compare(operators op, T a, T b) {
+            switch(op) {
+                case operators::lt: return a < b;
+                case operators::gt: return a > b;
+                case operators::lteq: return a <= b;
+                case operators::gteq: return a >= b;
+                case operators::eq: return a == b;
+                case operators::neq: return a != b;
+                default: return std::nullopt;
+            }
+        }
+
+        std::optional<bool> fold_comparison(operators op, const atom& lhs, const atom& rhs) {
+            auto a = integer_value(lhs);
+            auto b = integer_value(rhs);
+            if(a && b) {
+                if(downcast<integer>(lhs.type.get())->is_unsigned) {
+                    return compare(op, std::uint64_t(*a), std::uint64_t(*b));
+                } else {
+                    return compare(op, *a, *b);
+                }
+            }
+            auto x = real_value(lhs);
+            auto y = real_value(rhs);
+            if(x && y) {
+                return compare(op, *x, *y);
+            }
+            return std::nullopt;
+        }
+
+        std::optional<std::int64_t> fold_integer(operators op, std::int64_t a, std::int64_t b, const integer& type, const integer& b_type) {
+            auto ua = std::uint64_t(a);
+            auto ub = std::uint64_t(b);
+            // shift amounts are read with their own type's signedness
+            bool valid_shift = (b_type.is_unsigned || b >= 0) && ub < type.bits;
+            switch(op) {
+                case operators::add: return std::int64_t(ua + ub);
+                case operators::sub: return std::int64_t(ua - ub);
+                case operators::mul: return std::int64_t(ua * ub);
+                case operators::bit_and: return std::int64_t(ua & ub);
+                case operators::bit_or: return std::int64_t(ua | ub);
+                case operators::bit_xor: return std::int64_t(ua ^ ub);
+                case operators::trunc_div:
+                case operators::trunc_mod:
+                    if(b == 0) {
+                        return std::nullopt;
+                    }
+                    if(type.is_unsigned) {
+                        return std::int64_t(op == operators::trunc_div ? ua / ub : ua % ub);
+                    }
+                    // the most negative value divided by -1 overflows
+                    if(b == -1 && a == wrap(std::uint64_t(1) << (type.bits - 1), type)) {
+                        return std::nullopt;
+                    }
+                    return op == operators::trunc_div ? a / b : a % b;
+                case operators::lshift:
+                    return valid_shift ? std::optional(std::int64_t(ua << ub)) : std::nullopt;
+                case operators::rshift:
+                    if(!valid_shift) {
+                        return std::nullopt;
+                    }
+                    return type.is_unsigned ? std::int64_t(ua >> ub) : a >> b;
+                default:
+                    return std::nullopt;
+            }
+        }
+
+        template<typename T>
+        std::optional<T> fold_real(operators op, T a, T b) {
+            switch(op) {
+                case operators::add: return a + b;
+                case operators::sub: return a - b;
+                case operators::mul: return a * b;
+                case operators::rdiv: return b == 0 ? std::nullopt : std::optional(a / b);
+                default: return std::nullopt;
+            }
+        }
+
+        std::unique_ptr<atom> fold_binary(const binary_assignment& assign) {
+            const type& result_type = *assign.lhs->type;
+            if(auto result = fold_comparison(assign.op, *assign.rhs1, *assign.rhs2)) {
+                return foldable_integer(result_type) ? make_integer_constant(*result, result_type) : nullptr;
+            }
+            auto a = integer_value(*assign.rhs1);
+            auto b = integer_value(*assign.rhs2);
+            if(a && b && foldable_integer(result_type)) {
+                auto result = fold_integer(
+                    assign.op,
+                    *a,
+                    *b,
+                    *downcast<integer>(assign.rhs1->type.get()),
+                    *downcast<integer>(assign.rhs2->type.get())
+                );
+                return result ? make_integer_constant(*result, result_type) : nullptr;
+            }
+            auto x = real_value(*assign.rhs1);
+            auto y = real_value(*assign.rhs2);
+            if(x && y && foldable_real(result_type)) {
+                // single precision is evaluated as float so the result is rounded once
+                std::optional<double> result;
+                if(downcast<real>(&result_type)->bits == 32) {
+                    result = fold_real(assign.op, float(*x), float(*y));
+                } else {
+                    result = fold_real(assign.op, *x, *y);
+                }
+                return result ? make_real_constant(*result, result_type) : nullptr;
+            }
+            return nullptr;
+        }
+
+        std::unique_ptr<atom> fold_unary(const unary_assignment& assign) {
+            const type& result_type = *assign.lhs->type;
+            auto* result_int = foldable_integer(result_type);
+            auto* result_real = foldable_real(result_type);
+            if(auto a = integer_value(*assign.rhs)) {
+                bool is_unsigned = downcast<integer>(assign.rhs->type.get())->is_unsigned;
+                switch(assign.op) {
+                    case operators::assign:
+                        if(result_int) {
+                            return make_integer_constant(*a, result_type);
+                        } else if(result_real && result_real->bits == 32) {
+                            return make_real_constant(is_unsigned ? float(std::uint64_t(*a)) : float(*a), result_type);
+                        } else if(result_real) {
+                            return make_real_constant(is_unsigned ? double(std::uint64_t(*a)) : double(*a), result_type);
+                        }
+                        return nullptr;
+                    case operators::neg:
+                        return result_int ? make_integer_constant(std::int64_t(0 - std::uint64_t(*a)), result_type) : nullptr;
+                    case operators::bit_not:
+                        return result_int ? make_integer_constant(~*a, result_type) : nullptr;
+                    default:
+                        return nullptr;
+                }
+            }
+            if(auto x = real_value(*assign.rhs)) {
+                switch(assign.op) {
+                    case operators::assign:
+                        if(result_real) {
+                            return make_real_constant(*x, result_type);
+                        } else if(result_int) {
+                            // conversions of values that don't fit are undefined
+                            double truncated = std::trunc(*x);
+                            double limit = std::ldexp(1.0, int(result_int->bits) - (result_int->is_unsigned ? 0 : 1));
+                            if(truncated < (result_int->is_unsigned ? 0 : -limit) || truncated >= limit) {
+                                return nullptr;
+                            }
+                            return make_integer_constant(
+                                result_int->is_unsigned ? std::int64_t(std::uint64_t(truncated)) : std::int64_t(truncated),
+                                result_type
+                            );
+                        }
+                        return nullptr;
+                    case operators::neg:
+                        return result_real ? make_real_constant(-*x, result_type) : nullptr;
+                    default:
+                        return nullptr;
+                }
+            }
+            return nullptr;
+        }
+
+        void remove_incoming(basic_block& bb, int predecessor) {
+            for(auto& phi : bb.phis) {
+                std::erase_if(phi.values, [&](const auto& value) { return value.first == predecessor; });
+            }
+        }
+
+        void rename_incoming(basic_block& bb, int from, int to) {
+            for(auto& phi : bb.phis) {
+                for(auto& [predecessor, _] : phi.values) {
+                    if(predecessor == from) {
+                        predecessor = to;
+                    }
+                }
+            }
+        }
+
+        std::vector<int> reverse_postorder(const function& fn) {
+            std::vector<bool> visited(fn.basic_blocks.size(), false);
+            std::vector<std::pair<int, std::size_t>> stack;
+            std::vector<int> postorder;
+            stack.push_back({0, 0});
+            visited[0] = true;
+            while(!stack.empty()) {
+                auto& [index, next] = stack.back();
+                const auto& successors = fn.basic_blocks[index].successors;
+                if(next < successors.size()) {
+                    int successor = successors[next++];
+                    if(!visited[successor]) {
+                        visited[successor] = true;
+                        stack.push_back({successor, 0});
+                    }
+                } else {
+                    postorder.push_back(index);
+                    stack.pop_back();
+                }
+            }
+            std::reverse(postorder.begin(), postorder.end());
+            return postorder;
+        }
+
+        // blocks reverse_postorder doesn't reach, phis in the remaining blocks drop their values from them
+        std::vector<bool> unreachable_blocks(function& fn) {
+            std::vector<bool> removed(fn.basic_blocks.size(), true);
+            for(int index : reverse_postorder(fn)) {
+                removed[index] = false;
+            }
+            for(auto& bb : fn.basic_blocks) {
+                if(!removed[bb.index]) {
+                    for(auto& phi : bb.phis) {
+                        std::erase_if(phi.values, [&](const auto& value) { return removed[value.first]; });
+                    }
+                }
+            }
+            return removed;
+        }
+
+        // drops the removed blocks and renumbers the rest densely, nothing left may refer to a removed block
+        void remove_blocks(function& fn, const std::vector<bool>& removed) {
+            auto& blocks = fn.basic_blocks;
+            std::vector<int> new_index(blocks.size(), -1);
+            std::vector<basic_block> kept;
+            for(auto& bb : blocks) {
+                if(!removed[bb.index]) {
+                    new_index[bb.index] = int(kept.size());
+                    kept.push_back(std::move(bb));
+                }
+            }
+            for(auto& bb : kept) {
+                bb.index = new_index[bb.index];
+                for(int& successor : bb.successors) {
+                    successor = new_index[successor];
+                    ASSERT(successor >= 0);
+                }
+                for(auto& phi : bb.phis) {
+                    for(auto& [predecessor, _] : phi.values) {
+                        predecessor = new_index[predecessor];
+                        ASSERT(predecessor >= 0);
+                    }
+                }
+            }
+            blocks = std::move(kept);
+            fn.topological = reverse_postorder(fn);
+            fn.cfg_version++;
+        }
+
+        // assignments to a variable that neither access memory nor have side effects
+        bool is_pure(const statement& statement) {
+            auto is_memory = [](const std::unique_ptr<atom>& atom) { return is_memory_reference(*atom); };
+            if(auto* assign = downcast<binary_assignment>(&statement)) {
+                return assign->lhs->tag == atom_tag::variable && !is_memory(assign->rhs1) && !is_memory(assign->rhs2);
+            } else if(auto* assign = downcast<unary_assignment>(&statement)) {
+                return assign->lhs->tag == atom_tag::variable && !is_memory(assign->rhs);
+            } else {
+                return false;
+            }
+        }
+    }
+
+    bool propagate_copies(function& fn) {
+        use_lists uses(fn);
+        bool changed = false;
+        // a copy's source may itself be renamed by a later copy in the chain, ssa guarantees chains are acyclic
+        for(auto& bb : fn.basic_blocks) {
+            for(auto& statement : bb.statements) {
+                if(is_copy(*statement)) {
+                    auto* copy = downcast<unary_assignment>(statement);
+                    changed |= uses.replace_all_uses_with(downcast<variable>(copy->lhs)->name, *copy->rhs) > 0;
+                }
+            }
+        }
+        // copies still used as an address or pointer keep their constant source
+        for(auto& bb : fn.basic_blocks) {
+            changed |= std::erase_if(bb.statements, [&](const std::unique_ptr<statement>& statement) {
+                if(!is_copy(*statement) || !uses.unused(downcast<variable>(downcast<unary_assignment>(statement)->lhs)->name)) {
+                    return false;
+                }
+                uses.remove(*statement);
+                return true;
+            }) > 0;
+        }
+        return changed;
+    }
+
+    bool fold_constants(function& fn) {
+        use_lists uses(fn);
+        bool changed = false;
+        bool folded_branch = false;
+        // folded values are substituted into their uses right away, visiting blocks in reverse postorder sees
+        // definitions before their (non-phi) uses so chains fold in one run
+        for(int index : reverse_postorder(fn)) {
+            auto& bb = fn.basic_blocks[index];
+            for(auto& statement : bb.statements) {
+                if(auto* assign = downcast<binary_assignment>(statement)) {
+                    if(assign->lhs->tag != atom_tag::variable) {
+                        continue;
+                    }
+                    if(auto result = fold_binary(*assign)) {
+                        uses.remove(*statement);
+                        statement = std::make_unique<unary_assignment>(
+                            std::move(assign->lhs),
+                            std::move(result),
+                            operators::assign
+                        );
+                        uses.add(*statement);
+                        changed = true;
+                    }
+                } else if(auto* assign = downcast<unary_assignment>(statement)) {
+                    // copies are already as folded as they get
+                    if(assign->lhs->tag != atom_tag::variable || is_copy(*assign)) {
+                        continue;
+                    }
+                    if(auto result = fold_unary(*assign)) {
+                        uses.remove(*statement);
+                        assign->rhs = std::move(result);
+                        assign->op = operators::assign;
+                        uses.add(*statement);
+                        changed = true;
+                    }
+                }
+                if(is_copy(*statement)) {
+                    auto* copy = downcast<unary_assignment>(statement);
+                    if(copy->rhs->tag != atom_tag::variable) {
+                        changed |= uses.replace_all_uses_with(downcast<variable>(copy->lhs)->name, *copy->rhs) > 0;
+                    }
+                }
+            }
+            if(bb.statements.empty()) {
+                continue;
+            }
+            if(auto* cond = downcast<bimple::cond>(bb.statements.back())) {
+                if(auto taken = fold_comparison(cond->op, *cond->lhs, *cond->rhs)) {
+                    ASSERT(bb.successors.size() == 2);
+                    int target = bb.successors[*taken ? 0 : 1];
+                    int other = bb.successors[*taken ? 1 : 0];
+                    if(other != target) {
+                        // erasing incoming values moves the others
+                        auto& phis = fn.basic_blocks[other].phis;
+                        for(auto& phi : phis) {
+                            uses.remove(phi);
+                        }
+                        remove_incoming(fn.basic_blocks[other], bb.index);
+                        for(auto& phi : phis) {
+                            uses.add(phi);
+                        }
+                    }
+                    uses.remove(*cond);
+                    bb.statements.pop_back();
+                    bb.successors = {target};
+                    fn.cfg_version++;
+                    folded_branch = true;
+                    changed = true;
+                }
+            }
+        }
+        // the blocks only the folded branches reached are left with phis that have no incoming values, and values from
+        // them may still flow into phis in live blocks, drop them here rather than relying on simplify-cfg running next
+        if(folded_branch) {
+            auto removed = unreachable_blocks(fn);
+            if(std::ranges::count(removed, true) > 0) {
+                remove_blocks(fn, removed);
+            }
+        }
+        return changed;
+    }
+
+    bool eliminate_dead_code(function& fn) {
+        // mark everything that an impure statement depends on, then sweep the rest
+        struct definition {
+            const bimple::statement* statement;
+            bimple::phi* phi;
+        };
+        std::unordered_map<std::string_view, definition> definitions;
+        for(auto& bb : fn.basic_blocks) {
+            for(auto& phi : bb.phis) {
+                definitions.insert({phi.result.name, {nullptr, &phi}});
+            }
+            for(auto& statement : bb.statements) {
+                if(is_pure(*statement)) {
+                    const auto& lhs = static_cast<const assignment&>(*statement).lhs;
+                    definitions.insert({downcast<variable>(lhs)->name, {statement.get(), nullptr}});
+                }
+            }
+        }
+        std::unordered_set<const void*> live;
+        std::vector<definition> worklist;
+        auto mark = [&](std::unique_ptr<atom>& use, bool) {
+            auto* var = downcast<variable>(use);
+            if(!var) {
+                return;
+            }
+            auto it = definitions.find(var->name);
+            if(it == definitions.end()) {
+                return;
+            }
+            const void* key = it->second.phi ? static_cast<const void*>(it->second.phi) : it->second.statement;
+            if(live.insert(key).second) {
+                worklist.push_back(it->second);
+            }
+        };
+        for(auto& bb : fn.basic_blocks) {
+            for(auto& statement : bb.statements) {
+                if(!is_pure(*statement)) {
+                    for_each_use(*statement, mark);
+                }
+            }
+        }
+        while(!worklist.empty()) {
+            auto definition = worklist.back();
+            worklist.pop_back();
+            if(definition.phi) {
+                for(auto& [_, value] : definition.phi->values) {
+                    mark(value, false);
+                }
+            } else {
+                for_each_use(const_cast<statement&>(*definition.statement), mark);
+            }
+        }
+        bool changed = false;
+        for(auto& bb : fn.basic_blocks) {
+            changed |= std::erase_if(bb.phis, [&](const phi& phi) { return !live.contains(&phi); }) > 0;
+            changed |= std::erase_if(bb.statements, [&](const std::unique_ptr<statement>& statement) {
+                return is_pure(*statement) && !live.contains(statement.get());
+            }) > 0;
+        }
+        return changed;
+    }
+
+    bool simplify_cfg(function& fn) {
+        auto& blocks = fn.basic_blocks;
+        auto removed = unreachable_blocks(fn);
+        bool changed = std::ranges::count(removed, true) > 0;
+        std::vector<std::vector<int>> predecessors(blocks.size());
+        for(auto& bb : blocks) {
+            if(!removed[bb.index]) {
+                for(int successor : bb.successors) {
+                    predecessors[successor].push_back(bb.index);
+                }
+            }
+        }
+        // forward edges through empty blocks, unless that would give a predecessor two edges into the same block
+        for(auto& bb : blocks) {
+            if(
+                removed[bb.index]
+                || bb.index == 0
+                || !bb.phis.empty()
+                || !bb.statements.empty()
+                || bb.successors.size() != 1
+                || bb.successors[0] == bb.index
+            ) {
+                continue;
+            }
+            int target = bb.successors[0];
+            auto& target_predecessors = predecessors[target];
+            if(std::ranges::any_of(predecessors[bb.index], [&](int p) { return std::ranges::count(target_predecessors, p); })) {
+                continue;
+            }
+            for(auto& phi : blocks[target].phis) {
+                auto it = std::ranges::find_if(phi.values, [&](const auto& value) { return value.first == bb.index; });
+                VERIFY(it != phi.values.end());
+                auto value = std::move(it->second);
+                phi.values.erase(it);
+                for(int predecessor : predecessors[bb.index]) {
+                    phi.values.push_back({predecessor, value->clone()});
+                }
+            }
+            for(int predecessor : predecessors[bb.index]) {
+                std::ranges::replace(blocks[predecessor].successors, bb.index, target);
+                target_predecessors.push_back(predecessor);
+            }
+            std::erase(target_predecessors, bb.index);
+            predecessors[bb.index].clear();
+            bb.successors.clear();
+            removed[bb.index] = true;
+            changed = true;
+        }
+        // merge blocks into their only predecessor, phis there have a single incoming value and become copies
+        for(auto& bb : blocks) {
+            while(!removed[bb.index] && bb.successors.size() == 1) {
+                int index = bb.successors[0];
+                if(index == bb.index || index == 0 || predecessors[index].size() != 1) {
+                    break;
+                }
+                auto& next = blocks[index];
+                for(auto& phi : next.phis) {
+                    VERIFY(phi.values.size() == 1, phi.to_string());
+                    bb.statements.push_back(
+                        std::make_unique<unary_assignment>(
+                            phi.result.clone(),
+                            std::move(phi.values[0].second),
+                            operators::assign
+                        )
+                    );
+                }
+                for(auto& statement : next.statements) {
+                    bb.statements.push_back(std::move(statement));
+                }
+                bb.successors = std::move(next.successors);
+                for(int successor : bb.successors) {
+                    rename_incoming(blocks[successor], index, bb.index);
+                    std::ranges::replace(predecessors[successor], index, bb.index);
+                }
+                next.phis.clear();
+                next.statements.clear();
+                next.successors.clear();
+                predecessors[index].clear();
+                removed[index] = true;
+                changed = true;
+            }
+        }
+        if(!changed) {
+            return false;
+        }
+        remove_blocks(fn, removed);
+        return true;
+    }
+
+    namespace {
+        struct named_pass {
+            std::string_view name;
+            pass_manager::pass_function run;
+        };
+
+        constexpr named_pass known_passes[] = {
+            {"copy-prop", propagate_copies},
+            {"fold", fold_constants},
+            {"dce", eliminate_dead_code},
+            {"simplify-cfg", simplify_cfg},
+        };
+    }
+
+    pass_manager::pass_manager(unsigned max_iterations) : max_iterations(max_iterations) {}
+
+    pass_manager pass_manager::default_pipeline() {
+        pass_manager manager;
+        for(const auto& pass : known_passes) {
+            manager.add(std::string(pass.name), pass.run);
+        }
+        return manager;
+    }
+
+    pass_manager pass_manager::parse(std::string_view pipeline) {
+        pass_manager manager;
+        if(pipeline.empty() || pipeline == "none") {
+            return manager;
+        }
+        for(const auto& name : split(pipeline, ",")) {
+            auto it = std::ranges::find(known_passes, std::string_view(name), &named_pass::name);
+            if(it == std::end(known_passes)) {
+                throw std::invalid_argument(fmt::format("unknown pass \"{}\"", name));
+            }
+            manager.add(std::string(it->name), it->run);
+        }
+        return manager;
+    }
+
+    void pass_manager::add(std::string name, pass_function run) {
+        passes.push_back({std::move(name), run});
+    }
+
+    bool pass_manager::run(function& fn) {
+        bool changed = false;
+        for(unsigned i = 0; i < max_iterations; i++) {
+            bool iteration_changed = false;
+            for(auto& pass : passes) {
+                auto start = std::chrono::steady_clock::now();
+                bool pass_changed = pass.run(fn);
+                pass.time += std::chrono::steady_clock::now() - start;
+                pass.runs++;
+                if(pass_changed) {
+                    pass.changes++;
+                    iteration_changed = true;
+                }
+            }
+            if(!iteration_changed) {
+                break;
+            }
+            changed = true;
+        }
+        return changed;
+    }
+
+    const std::vector<pass_manager::pass>& pass_manager::get_passes() const {
+        return passes;
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef BIMPLE_PASSES_H
+#define BIMPLE_PASSES_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bimple.h"
+
+// Transformations over bimple functions, run between conversion and codegen. Each returns whether it changed anything.
+namespace bimple {
+    // Forwards the source of same-representation copies (including the argument copies in the entry block) to their
+    // uses, including phi operands, and removes the copies. Uses keep their own type so signedness-dependent codegen is
+    // unchanged. Constants aren't forwarded into pointer or address operands.
+    bool propagate_copies(function& fn);
+
+    // Evaluates integer and float/double operations whose operands are all constants, replacing them with copies of
+    // the result, and turns conditional branches on constants into unconditional ones. Operations that would trap,
+    // overflow a conversion, or produce a constant codegen can't represent are left alone.
+    bool fold_constants(function& fn);
+
+    // Removes assignments and phis whose results don't contribute to a store, call, load, branch, or return. Loads
+    // are kept since bimple doesn't know whether they're volatile.
+    bool eliminate_dead_code(function& fn);
+
+    // Removes unreachable blocks (including the exit block, which nothing branches to), forwards edges through empty
+    // blocks, and merges blocks into their only predecessor. Blocks are then renumbered densely, keeping their order,
+    // so block 1 is only the exit block before this has run.
+    bool simplify_cfg(function& fn);
+
+    // Runs a pipeline of passes over a function, repeating it until nothing changes or max_iterations is reached, and
+    // accumulates per-pass timings over every function it has run on
+    class pass_manager {
+    public:
+        using pass_function = bool(*)(function&);
+        struct pass {
+            std::string name;
+            pass_function run;
+            std::chrono::nanoseconds time{};
+            std::size_t runs = 0;
+            // runs that changed the function
+            std::size_t changes = 0;
+        };
+    private:
+        std::vector<pass> passes;
+        unsigned max_iterations;
+    public:
+        explicit pass_manager(unsigned max_iterations = 4);
+        // copy-prop, fold, dce, and simplify-cfg
+        static pass_manager default_pipeline();
+        // comma separated pass names, an empty string or "none" gives an empty pipeline. Throws std::invalid_argument
+        // on unknown names.
+        static pass_manager parse(std::string_view pipeline);
+        void add(std::string name, pass_function run);
+        bool run(function& fn);
+        const std::vector<pass>& get_passes() const;
+    };
+}
+
+#endif
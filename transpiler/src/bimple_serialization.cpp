@@ -0,0 +1,701 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_serialization.h"
+
+namespace bimple {
+    namespace {
+        constexpr std::uint32_t magic = 0x4d525957; // "WYRM"
+        constexpr std::uint32_t none = UINT32_MAX;
+        constexpr std::size_t header_words = 7;
+        constexpr std::size_t type_words = 7;
+        constexpr std::size_t function_header_words = 16;
+        constexpr std::size_t arg_words = 2;
+        constexpr std::size_t atom_words = 4;
+        constexpr std::size_t statement_words = 5;
+        constexpr std::size_t block_words = 4;
+        constexpr std::size_t phi_words = 2;
+        constexpr std::size_t phi_value_words = 2;
+        constexpr std::size_t local_words = 3;
+        constexpr std::size_t initializer_words = 6;
+        constexpr std::size_t initializer_element_words = 2;
+        constexpr std::size_t global_words = 8;
+        // in statement operands
+        constexpr std::size_t switch_case_words = 5;
+
+        enum type_flags : std::uint32_t {
+            is_unsigned = 1
+        };
+
+        enum global_flags : std::uint32_t {
+            is_constant = 1,
+            is_unnamed_addr = 2
+        };
+
+        void append(std::vector<std::uint32_t>& words, std::initializer_list<std::uint32_t> values) {
+            words.insert(words.end(), values);
+        }
+
+        // operators and intrinsics share their word with the fp flags, in the upper half
+        template<typename E>
+        std::uint32_t with_flags(E value, fp_flags flags) {
+            return std::uint32_t(value) | std::uint32_t(flags) << 16;
+        }
+
+        template<typename E>
+        E without_flags(std::uint32_t word) {
+            return E(word & 0xffff);
+        }
+
+        fp_flags flags_of(std::uint32_t word) {
+            return fp_flags(word >> 16);
+        }
+    }
+
+    std::uint32_t serializer::intern_string(const std::string& string) {
+        auto [it, inserted] = string_ids.insert({string, std::uint32_t(strings.size())});
+        if(inserted) {
+            strings.push_back(string);
+        }
+        return it->second;
+    }
+
+    std::uint32_t serializer::intern_type(const type& t) {
+        std::uint32_t record[type_words] = {
+            std::uint32_t(t.tag), 0, 0, std::uint32_t(t.size * 8), none, 0, 0
+        };
+        std::vector<std::uint32_t> operands;
+        visit(t, [&] (const auto& derived) {
+            using T = std::remove_cvref_t<decltype(derived)>;
+            if constexpr(std::is_same_v<T, integer>) {
+                record[1] = derived.is_unsigned ? std::uint32_t(is_unsigned) : 0;
+                record[2] = derived.bits;
+            } else if constexpr(std::is_same_v<T, real>) {
+                record[2] = derived.bits;
+            } else if constexpr(std::is_same_v<T, pointer>) {
+                record[4] = intern_type(*derived.target_type);
+            } else if constexpr(std::is_same_v<T, function_type>) {
+                record[4] = intern_type(*derived.return_type);
+                for(const auto& arg : derived.args) {
+                    operands.push_back(intern_type(*arg));
+                }
+            } else if constexpr(std::is_same_v<T, array>) {
+                record[2] = std::uint32_t(derived.count);
+                record[4] = intern_type(*derived.element_type);
+            } else if constexpr(std::is_same_v<T, struct_type> || std::is_same_v<T, union_type>) {
+                record[2] = intern_string(derived.name);
+                for(const auto& f : derived.fields) {
+                    operands.push_back(intern_type(*f.type));
+                    operands.push_back(std::uint32_t(f.offset));
+                    operands.push_back(intern_string(f.name));
+                }
+            }
+        });
+        std::string key(reinterpret_cast<const char*>(record), sizeof(record));
+        key.append(reinterpret_cast<const char*>(operands.data()), operands.size() * sizeof(std::uint32_t));
+        auto [it, inserted] = type_ids.insert({std::move(key), std::uint32_t(types.size() / type_words)});
+        if(inserted) {
+            record[5] = std::uint32_t(type_operands.size());
+            record[6] = std::uint32_t(operands.size());
+            types.insert(types.end(), std::begin(record), std::end(record));
+            type_operands.insert(type_operands.end(), operands.begin(), operands.end());
+        }
+        return it->second;
+    }
+
+    void serializer::add(const function& fn) {
+        std::unordered_map<std::string, std::uint32_t> value_ids;
+        std::vector<std::uint32_t> args, values, atoms, statements, operands, blocks, phis, phi_values, successors;
+        auto value_id = [&] (const std::string& name) {
+            auto [it, inserted] = value_ids.insert({name, std::uint32_t(values.size())});
+            if(inserted) {
+                values.push_back(intern_string(name));
+            }
+            return it->second;
+        };
+        auto write_atom = [&] (auto& self, const atom& a) -> std::uint32_t {
+            std::uint32_t record[atom_words] = {std::uint32_t(a.tag), intern_type(*a.type), 0, 0};
+            visit(a, [&] (const auto& derived) {
+                using T = std::remove_cvref_t<decltype(derived)>;
+                if constexpr(std::is_same_v<T, variable>) {
+                    record[2] = value_id(derived.name);
+                } else if constexpr(std::is_same_v<T, addr_expr>) {
+                    record[2] = intern_string(derived.name);
+                } else if constexpr(std::is_same_v<T, mem_ref>) {
+                    record[2] = self(self, *derived.base);
+                    record[3] = self(self, *derived.offset);
+                } else if constexpr(std::is_same_v<T, integer_constant>) {
+                    record[2] = std::uint32_t(derived.value);
+                } else if constexpr(std::is_same_v<T, real_constant>) {
+                    record[2] = intern_string(derived.value);
+                } else if constexpr(std::is_same_v<T, component_ref>) {
+                    record[2] = self(self, *derived.base);
+                    record[3] = derived.field;
+                } else if constexpr(std::is_same_v<T, array_ref>) {
+                    record[2] = self(self, *derived.base);
+                    record[3] = self(self, *derived.index);
+                } else if constexpr(std::is_same_v<T, address_of>) {
+                    record[2] = self(self, *derived.reference);
+                } else if constexpr(std::is_same_v<T, local_ref> || std::is_same_v<T, global_ref>) {
+                    record[2] = intern_string(derived.name);
+                }
+            });
+            atoms.insert(atoms.end(), std::begin(record), std::end(record));
+            return std::uint32_t(atoms.size() / atom_words - 1);
+        };
+        auto atom_id = [&] (const std::unique_ptr<atom>& a) {
+            return a ? write_atom(write_atom, *a) : none;
+        };
+        // elements are written before the aggregate that holds them, each aggregate's elements are contiguous
+        std::vector<std::uint32_t> initializers, initializer_elements;
+        auto write_initializer = [&] (auto& self, const initializer& value) -> std::uint32_t {
+            std::vector<std::uint32_t> elements;
+            for(const auto& element : value.elements) {
+                elements.push_back(self(self, element));
+            }
+            std::uint32_t begin = std::uint32_t(initializer_elements.size() / initializer_element_words);
+            for(std::size_t j = 0; j < elements.size(); j++) {
+                append(initializer_elements, {std::uint32_t(value.indices[j]), elements[j]});
+            }
+            std::uint64_t integer = std::uint64_t(value.integer);
+            append(initializers, {
+                std::uint32_t(value.kind),
+                std::uint32_t(integer),
+                std::uint32_t(integer >> 32),
+                value.text.empty() ? none : intern_string(value.text),
+                begin,
+                std::uint32_t(elements.size())
+            });
+            return std::uint32_t(initializers.size() / initializer_words - 1);
+        };
+        for(const auto& [name, type] : fn.args) {
+            append(args, {intern_string(name), intern_type(*type)});
+        }
+        for(const auto& bb : fn.basic_blocks) {
+            append(blocks, {std::uint32_t(bb.index), std::uint32_t(bb.phis.size()), std::uint32_t(bb.statements.size()), std::uint32_t(bb.successors.size())});
+            for(const auto& phi : bb.phis) {
+                append(phis, {write_atom(write_atom, phi.result), std::uint32_t(phi.values.size())});
+                for(const auto& [src, value] : phi.values) {
+                    append(phi_values, {std::uint32_t(src), atom_id(value)});
+                }
+            }
+            for(const auto& statement : bb.statements) {
+                visit(statement, [&] (const auto& derived) {
+                    using T = std::remove_cvref_t<decltype(derived)>;
+                    if constexpr(std::is_same_v<T, binary_assignment>) {
+                        append(statements, {std::uint32_t(derived.tag), with_flags(derived.op, derived.flags), atom_id(derived.lhs), atom_id(derived.rhs1), atom_id(derived.rhs2)});
+                    } else if constexpr(std::is_same_v<T, unary_assignment>) {
+                        append(statements, {std::uint32_t(derived.tag), with_flags(derived.op, derived.flags), atom_id(derived.lhs), atom_id(derived.rhs), 0});
+                    } else if constexpr(std::is_same_v<T, call>) {
+                        std::uint32_t callee = atom_id(derived.fn);
+                        std::uint32_t lhs = atom_id(derived.lhs);
+                        std::uint32_t begin = std::uint32_t(operands.size());
+                        for(const auto& arg : derived.args) {
+                            operands.push_back(atom_id(arg));
+                        }
+                        append(statements, {std::uint32_t(derived.tag), std::uint32_t(derived.args.size()), callee, lhs, begin});
+                    } else if constexpr(std::is_same_v<T, function_return>) {
+                        append(statements, {std::uint32_t(derived.tag), 0, atom_id(derived.value), 0, 0});
+                    } else if constexpr(std::is_same_v<T, cond>) {
+                        append(statements, {std::uint32_t(derived.tag), std::uint32_t(derived.op), atom_id(derived.lhs), atom_id(derived.rhs), 0});
+                    } else if constexpr(std::is_same_v<T, intrinsic_call>) {
+                        std::uint32_t lhs = atom_id(derived.lhs);
+                        std::uint32_t begin = std::uint32_t(operands.size());
+                        for(const auto& arg : derived.args) {
+                            operands.push_back(atom_id(arg));
+                        }
+                        append(statements, {std::uint32_t(derived.tag), std::uint32_t(derived.args.size()), with_flags(derived.id, derived.flags), lhs, begin});
+                    } else if constexpr(std::is_same_v<T, switch_branch>) {
+                        std::uint32_t begin = std::uint32_t(operands.size());
+                        for(const auto& c : derived.cases) {
+                            std::uint64_t low = std::uint64_t(c.low);
+                            std::uint64_t high = std::uint64_t(c.high);
+                            append(operands, {
+                                std::uint32_t(low),
+                                std::uint32_t(low >> 32),
+                                std::uint32_t(high),
+                                std::uint32_t(high >> 32),
+                                std::uint32_t(c.successor)
+                            });
+                        }
+                        append(statements, {std::uint32_t(derived.tag), std::uint32_t(derived.cases.size()), atom_id(derived.index), 0, begin});
+                    }
+                });
+            }
+            for(int successor : bb.successors) {
+                successors.push_back(std::uint32_t(successor));
+            }
+        }
+        std::vector<std::uint32_t> words = {
+            intern_string(fn.identifier),
+            intern_type(*fn.return_type),
+            std::uint32_t(fn.args.size()),
+            std::uint32_t(values.size()),
+            std::uint32_t(atoms.size() / atom_words),
+            std::uint32_t(statements.size() / statement_words),
+            std::uint32_t(operands.size()),
+            std::uint32_t(fn.basic_blocks.size()),
+            std::uint32_t(phis.size() / phi_words),
+            std::uint32_t(phi_values.size() / phi_value_words),
+            std::uint32_t(successors.size()),
+            std::uint32_t(fn.topological.size()),
+            std::uint32_t(fn.locals.size()),
+            0,
+            0,
+            std::uint32_t(fn.globals.size())
+        };
+        std::vector<std::uint32_t> globals;
+        for(const auto& g : fn.globals) {
+            std::uint32_t flags = (g.is_constant ? std::uint32_t(is_constant) : 0) | (g.unnamed_addr ? std::uint32_t(is_unnamed_addr) : 0);
+            append(globals, {
+                intern_string(g.name),
+                intern_type(*g.type),
+                std::uint32_t(g.linkage),
+                std::uint32_t(g.align),
+                g.section.empty() ? none : intern_string(g.section),
+                flags,
+                g.value ? write_initializer(write_initializer, *g.value) : none,
+                std::uint32_t(g.tls_model)
+            });
+        }
+        words[13] = std::uint32_t(initializers.size() / initializer_words);
+        words[14] = std::uint32_t(initializer_elements.size() / initializer_element_words);
+        for(auto* section : {&args, &values, &atoms, &statements, &operands, &blocks, &phis, &phi_values, &successors}) {
+            words.insert(words.end(), section->begin(), section->end());
+        }
+        for(int index : fn.topological) {
+            words.push_back(std::uint32_t(index));
+        }
+        for(const auto& l : fn.locals) {
+            append(words, {intern_string(l.name), intern_type(*l.type), std::uint32_t(l.align)});
+        }
+        for(auto* section : {&initializers, &initializer_elements, &globals}) {
+            words.insert(words.end(), section->begin(), section->end());
+        }
+        functions.push_back(std::move(words));
+    }
+
+    std::size_t serializer::size() const {
+        return functions.size();
+    }
+
+    std::vector<std::byte> serializer::finish() const {
+        std::vector<std::uint32_t> words = {
+            magic,
+            serialization_version,
+            std::uint32_t(strings.size()),
+            0,
+            std::uint32_t(types.size() / type_words),
+            std::uint32_t(type_operands.size()),
+            std::uint32_t(functions.size())
+        };
+        std::string string_data;
+        for(const auto& string : strings) {
+            words.push_back(std::uint32_t(string_data.size()));
+            string_data += string;
+        }
+        words.push_back(std::uint32_t(string_data.size()));
+        words[3] = std::uint32_t(string_data.size());
+        string_data.resize((string_data.size() + 3) / 4 * 4, '\0');
+        std::size_t string_begin = words.size();
+        words.resize(words.size() + string_data.size() / 4);
+        std::memcpy(words.data() + string_begin, string_data.data(), string_data.size());
+        words.insert(words.end(), types.begin(), types.end());
+        words.insert(words.end(), type_operands.begin(), type_operands.end());
+        std::size_t offsets_begin = words.size();
+        words.resize(words.size() + functions.size());
+        for(std::size_t i = 0; i < functions.size(); i++) {
+            words[offsets_begin + i] = std::uint32_t(words.size());
+            words.insert(words.end(), functions[i].begin(), functions[i].end());
+        }
+        std::vector<std::byte> bytes(words.size() * sizeof(std::uint32_t));
+        std::memcpy(bytes.data(), words.data(), bytes.size());
+        return bytes;
+    }
+
+    void serializer::write(const std::string& path) const {
+        auto bytes = finish();
+        std::ofstream f(path, std::ios::binary);
+        VERIFY(f.good(), "Couldn't open file for writing", path);
+        f.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+    serialized_module::serialized_module(std::span<const std::byte> data) {
+        VERIFY(data.size() % sizeof(std::uint32_t) == 0 && data.size() >= header_words * sizeof(std::uint32_t), data.size());
+        VERIFY(reinterpret_cast<std::uintptr_t>(data.data()) % alignof(std::uint32_t) == 0);
+        words = reinterpret_cast<const std::uint32_t*>(data.data());
+        word_count = data.size() / sizeof(std::uint32_t);
+        VERIFY(words[0] == magic, "Not a serialized bimple module");
+        VERIFY(words[1] == serialization_version, "Unsupported serialization version", words[1], serialization_version);
+        string_count = words[2];
+        std::uint32_t string_bytes = words[3];
+        type_count = words[4];
+        type_operand_count = words[5];
+        function_count = words[6];
+        std::size_t position = header_words;
+        auto take = [&] (std::size_t n) {
+            VERIFY(position + n <= word_count, "Truncated serialized module");
+            const std::uint32_t* section = words + position;
+            position += n;
+            return section;
+        };
+        string_offsets = take(std::size_t(string_count) + 1);
+        string_data = reinterpret_cast<const char*>(take((std::size_t(string_bytes) + 3) / 4));
+        VERIFY(string_offsets[string_count] == string_bytes);
+        type_records = take(std::size_t(type_count) * type_words);
+        type_operand_data = take(type_operand_count);
+        function_offsets = take(function_count);
+        for(std::uint32_t i = 0; i < function_count; i++) {
+            VERIFY(function_offsets[i] + function_header_words <= word_count, "Truncated serialized module");
+        }
+    }
+
+    std::string_view serialized_module::string(std::uint32_t id) const {
+        VERIFY(id < string_count, id);
+        VERIFY(string_offsets[id] <= string_offsets[id + 1] && string_offsets[id + 1] <= string_offsets[string_count]);
+        return std::string_view(string_data + string_offsets[id], string_offsets[id + 1] - string_offsets[id]);
+    }
+
+    std::unique_ptr<type> serialized_module::load_type(std::uint32_t id) const {
+        VERIFY(id < type_count, id);
+        const std::uint32_t* record = type_records + std::size_t(id) * type_words;
+        switch(type_tag(record[0])) {
+            case type_tag::integer:
+                return std::make_unique<integer>(record[2], record[1] & is_unsigned, record[3]);
+            case type_tag::void_type:
+                return std::make_unique<void_type>();
+            case type_tag::boolean:
+                return std::make_unique<boolean>(record[3]);
+            case type_tag::pointer:
+                return std::make_unique<pointer>(load_type(record[4]), record[3]);
+            case type_tag::real:
+                return std::make_unique<real>(record[2], record[3]);
+            case type_tag::function:
+                {
+                    VERIFY(std::size_t(record[5]) + record[6] <= type_operand_count);
+                    std::vector<std::unique_ptr<type>> args;
+                    for(std::uint32_t i = 0; i < record[6]; i++) {
+                        args.push_back(load_type(type_operand_data[record[5] + i]));
+                    }
+                    return std::make_unique<function_type>(load_type(record[4]), std::move(args));
+                }
+            case type_tag::array:
+                return std::make_unique<array>(load_type(record[4]), record[2], record[3]);
+            case type_tag::struct_type:
+            case type_tag::union_type:
+                {
+                    VERIFY(record[6] % 3 == 0 && std::size_t(record[5]) + record[6] <= type_operand_count);
+                    std::vector<field> fields;
+                    for(std::uint32_t i = 0; i < record[6]; i += 3) {
+                        const std::uint32_t* f = type_operand_data + record[5] + i;
+                        fields.push_back({std::string(string(f[2])), load_type(f[0]), f[1]});
+                    }
+                    if(type_tag(record[0]) == type_tag::struct_type) {
+                        return std::make_unique<struct_type>(std::string(string(record[2])), std::move(fields), record[3]);
+                    } else {
+                        return std::make_unique<union_type>(std::string(string(record[2])), std::move(fields), record[3]);
+                    }
+                }
+            default:
+                VERIFY(false, "Unhandled type", record[0]);
+                __builtin_unreachable();
+        }
+    }
+
+    std::size_t serialized_module::size() const {
+        return function_count;
+    }
+
+    std::string_view serialized_module::function_name(std::size_t i) const {
+        VERIFY(i < function_count, i);
+        return string(words[function_offsets[i]]);
+    }
+
+    function serialized_module::load(std::size_t i) const {
+        VERIFY(i < function_count, i);
+        const std::uint32_t* header = words + function_offsets[i];
+        std::uint32_t n_args = header[2];
+        std::uint32_t n_values = header[3];
+        std::uint32_t n_atoms = header[4];
+        std::uint32_t n_statements = header[5];
+        std::uint32_t n_operands = header[6];
+        std::uint32_t n_blocks = header[7];
+        std::uint32_t n_phis = header[8];
+        std::uint32_t n_phi_values = header[9];
+        std::uint32_t n_successors = header[10];
+        std::uint32_t n_topological = header[11];
+        std::uint32_t n_locals = header[12];
+        std::uint32_t n_initializers = header[13];
+        std::uint32_t n_initializer_elements = header[14];
+        std::uint32_t n_globals = header[15];
+        std::size_t position = function_offsets[i] + function_header_words;
+        auto take = [&] (std::size_t n) {
+            VERIFY(position + n <= word_count, "Truncated serialized function");
+            const std::uint32_t* section = words + position;
+            position += n;
+            return section;
+        };
+        const std::uint32_t* args = take(std::size_t(n_args) * arg_words);
+        const std::uint32_t* values = take(n_values);
+        const std::uint32_t* atoms = take(std::size_t(n_atoms) * atom_words);
+        const std::uint32_t* statements = take(std::size_t(n_statements) * statement_words);
+        const std::uint32_t* operands = take(n_operands);
+        const std::uint32_t* blocks = take(std::size_t(n_blocks) * block_words);
+        const std::uint32_t* phis = take(std::size_t(n_phis) * phi_words);
+        const std::uint32_t* phi_values = take(std::size_t(n_phi_values) * phi_value_words);
+        const std::uint32_t* successors = take(n_successors);
+        const std::uint32_t* topological = take(n_topological);
+        const std::uint32_t* locals = take(std::size_t(n_locals) * local_words);
+        const std::uint32_t* initializers = take(std::size_t(n_initializers) * initializer_words);
+        const std::uint32_t* initializer_elements = take(std::size_t(n_initializer_elements) * initializer_element_words);
+        const std::uint32_t* globals = take(std::size_t(n_globals) * global_words);
+
+        auto load_atom = [&] (auto& self, std::uint32_t id) -> std::unique_ptr<atom> {
+            if(id == none) {
+                return nullptr;
+            }
+            VERIFY(id < n_atoms, id);
+            const std::uint32_t* record = atoms + std::size_t(id) * atom_words;
+            auto type = load_type(record[1]);
+            switch(atom_tag(record[0])) {
+                case atom_tag::variable:
+                    VERIFY(record[2] < n_values, record[2]);
+                    return std::make_unique<variable>(std::string(string(values[record[2]])), std::move(type));
+                case atom_tag::addr_expr:
+                    return std::make_unique<addr_expr>(std::string(string(record[2])), std::move(type));
+                case atom_tag::mem_ref:
+                    return std::make_unique<mem_ref>(self(self, record[2]), self(self, record[3]), std::move(type));
+                case atom_tag::integer_constant:
+                    return std::make_unique<integer_constant>(int(record[2]), std::move(type));
+                case atom_tag::real_constant:
+                    return std::make_unique<real_constant>(std::string(string(record[2])), std::move(type));
+                case atom_tag::component_ref:
+                    return std::make_unique<component_ref>(self(self, record[2]), record[3], std::move(type));
+                case atom_tag::array_ref:
+                    return std::make_unique<array_ref>(self(self, record[2]), self(self, record[3]), std::move(type));
+                case atom_tag::address_of:
+                    return std::make_unique<address_of>(self(self, record[2]), std::move(type));
+                case atom_tag::zero_initializer:
+                    return std::make_unique<zero_initializer>(std::move(type));
+                case atom_tag::local_ref:
+                    return std::make_unique<local_ref>(std::string(string(record[2])), std::move(type));
+                case atom_tag::global_ref:
+                    return std::make_unique<global_ref>(std::string(string(record[2])), std::move(type));
+                default:
+                    VERIFY(false, "Unhandled atom", record[0]);
+                    __builtin_unreachable();
+            }
+        };
+        auto load_variable = [&] (std::uint32_t id) {
+            auto a = load_atom(load_atom, id);
+            auto* var = VERIFY(downcast<variable>(a));
+            return variable(std::move(var->name), std::move(var->type));
+        };
+
+        function fn;
+        fn.identifier = string(header[0]);
+        fn.return_type = load_type(header[1]);
+        for(std::uint32_t j = 0; j < n_args; j++) {
+            fn.args.push_back({std::string(string(args[j * arg_words])), load_type(args[j * arg_words + 1])});
+        }
+        for(std::uint32_t j = 0; j < n_locals; j++) {
+            const std::uint32_t* l = locals + std::size_t(j) * local_words;
+            fn.locals.push_back({std::string(string(l[0])), load_type(l[1]), l[2]});
+        }
+        auto load_initializer = [&] (auto& self, std::uint32_t id) -> initializer {
+            VERIFY(id < n_initializers, id);
+            const std::uint32_t* record = initializers + std::size_t(id) * initializer_words;
+            VERIFY(std::size_t(record[4]) + record[5] <= n_initializer_elements);
+            initializer value;
+            value.kind = initializer_kind(record[0]);
+            value.integer = std::int64_t(std::uint64_t(record[1]) | std::uint64_t(record[2]) << 32);
+            if(record[3] != none) {
+                value.text = string(record[3]);
+            }
+            for(std::uint32_t k = 0; k < record[5]; k++) {
+                const std::uint32_t* element = initializer_elements + std::size_t(record[4] + k) * initializer_element_words;
+                value.indices.push_back(element[0]);
+                value.elements.push_back(self(self, element[1]));
+            }
+            return value;
+        };
+        for(std::uint32_t j = 0; j < n_globals; j++) {
+            const std::uint32_t* record = globals + std::size_t(j) * global_words;
+            global g;
+            g.name = string(record[0]);
+            g.type = load_type(record[1]);
+            g.linkage = linkages(record[2]);
+            g.align = record[3];
+            if(record[4] != none) {
+                g.section = string(record[4]);
+            }
+            g.is_constant = record[5] & is_constant;
+            g.unnamed_addr = record[5] & is_unnamed_addr;
+            if(record[6] != none) {
+                g.value = load_initializer(load_initializer, record[6]);
+            }
+            g.tls_model = tls_models(record[7]);
+            fn.globals.push_back(std::move(g));
+        }
+        std::size_t phi_index = 0, phi_value_index = 0, statement_index = 0, successor_index = 0;
+        for(std::uint32_t j = 0; j < n_blocks; j++) {
+            const std::uint32_t* block = blocks + std::size_t(j) * block_words;
+            VERIFY(phi_index + block[1] <= n_phis && statement_index + block[2] <= n_statements && successor_index + block[3] <= n_successors);
+            basic_block bb;
+            bb.index = int(block[0]);
+            for(std::uint32_t k = 0; k < block[1]; k++, phi_index++) {
+                const std::uint32_t* record = phis + phi_index * phi_words;
+                VERIFY(phi_value_index + record[1] <= n_phi_values);
+                phi p;
+                p.result = load_variable(record[0]);
+                for(std::uint32_t l = 0; l < record[1]; l++, phi_value_index++) {
+                    const std::uint32_t* incoming = phi_values + phi_value_index * phi_value_words;
+                    p.values.push_back({int(incoming[0]), load_atom(load_atom, incoming[1])});
+                }
+                bb.phis.push_back(std::move(p));
+            }
+            for(std::uint32_t k = 0; k < block[2]; k++, statement_index++) {
+                const std::uint32_t* record = statements + statement_index * statement_words;
+                switch(statement_tag(record[0])) {
+                    case statement_tag::binary_assignment:
+                        {
+                            auto assignment = std::make_unique<binary_assignment>(
+                                load_atom(load_atom, record[2]),
+                                load_atom(load_atom, record[3]),
+                                load_atom(load_atom, record[4]),
+                                without_flags<operators>(record[1])
+                            );
+                            assignment->flags = flags_of(record[1]);
+                            bb.statements.push_back(std::move(assignment));
+                        }
+                        break;
+                    case statement_tag::unary_assignment:
+                        {
+                            auto assignment = std::make_unique<unary_assignment>(
+                                load_atom(load_atom, record[2]),
+                                load_atom(load_atom, record[3]),
+                                without_flags<operators>(record[1])
+                            );
+                            assignment->flags = flags_of(record[1]);
+                            bb.statements.push_back(std::move(assignment));
+                        }
+                        break;
+                    case statement_tag::call:
+                        {
+                            VERIFY(std::size_t(record[4]) + record[1] <= n_operands);
+                            std::vector<std::unique_ptr<atom>> call_args;
+                            for(std::uint32_t l = 0; l < record[1]; l++) {
+                                call_args.push_back(load_atom(load_atom, operands[record[4] + l]));
+                            }
+                            bb.statements.push_back(
+                                std::make_unique<call>(
+                                    load_atom(load_atom, record[2]),
+                                    load_atom(load_atom, record[3]),
+                                    std::move(call_args)
+                                )
+                            );
+                        }
+                        break;
+                    case statement_tag::function_return:
+                        bb.statements.push_back(std::make_unique<function_return>(load_atom(load_atom, record[2])));
+                        break;
+                    case statement_tag::cond:
+                        bb.statements.push_back(
+                            std::make_unique<cond>(
+                                load_atom(load_atom, record[2]),
+                                load_atom(load_atom, record[3]),
+                                operators(record[1])
+                            )
+                        );
+                        break;
+                    case statement_tag::intrinsic_call:
+                        {
+                            VERIFY(std::size_t(record[4]) + record[1] <= n_operands);
+                            std::vector<std::unique_ptr<atom>> intrinsic_args;
+                            for(std::uint32_t l = 0; l < record[1]; l++) {
+                                intrinsic_args.push_back(load_atom(load_atom, operands[record[4] + l]));
+                            }
+                            auto intrinsic = std::make_unique<intrinsic_call>(
+                                without_flags<intrinsics>(record[2]),
+                                load_atom(load_atom, record[3]),
+                                std::move(intrinsic_args)
+                            );
+                            intrinsic->flags = flags_of(record[2]);
+                            bb.statements.push_back(std::move(intrinsic));
+                        }
+                        break;
+                    case statement_tag::switch_branch:
+                        {
+                            VERIFY(std::size_t(record[4]) + std::size_t(record[1]) * switch_case_words <= n_operands);
+                            std::vector<switch_case> cases;
+                            for(std::uint32_t l = 0; l < record[1]; l++) {
+                                const std::uint32_t* c = operands + record[4] + l * switch_case_words;
+                                cases.push_back({
+                                    std::int64_t(std::uint64_t(c[0]) | std::uint64_t(c[1]) << 32),
+                                    std::int64_t(std::uint64_t(c[2]) | std::uint64_t(c[3]) << 32),
+                                    c[4]
+                                });
+                            }
+                            bb.statements.push_back(
+                                std::make_unique<switch_branch>(load_atom(load_atom, record[2]), std::move(cases))
+                            );
+                        }
+                        break;
+                    default:
+                        VERIFY(false, "Unhandled statement", record[0]);
+                }
+            }
+            for(std::uint32_t k = 0; k < block[3]; k++, successor_index++) {
+                bb.successors.push_back(int(successors[successor_index]));
+            }
+            fn.basic_blocks.push_back(std::move(bb));
+        }
+        for(std::uint32_t j = 0; j < n_topological; j++) {
+            fn.topological.push_back(int(topological[j]));
+        }
+        return fn;
+    }
+
+    mapped_file::mapped_file(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        VERIFY(fd != -1, "Couldn't open file", path, std::strerror(errno));
+        struct stat st;
+        VERIFY(fstat(fd, &st) == 0, "Couldn't stat file", path, std::strerror(errno));
+        length = std::size_t(st.st_size);
+        if(length > 0) {
+            data = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            VERIFY(data != MAP_FAILED, "Couldn't map file", path, std::strerror(errno));
+        }
+        close(fd);
+    }
+
+    mapped_file::~mapped_file() {
+        if(data) {
+            munmap(data, length);
+        }
+    }
+
+    std::span<const std::byte> mapped_file::bytes() const {
+        return {static_cast<const std::byte*>(data), length};
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef BIMPLE_SERIALIZATION_H
+#define BIMPLE_SERIALIZATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "bimple.h"
+
+// Compact binary format for bimple functions, used to capture a translation unit once and replay codegen without gcc.
+//
+// Everything is stored as native-endian 32-bit words so a file can be mmapped and read in place:
+//   header         magic, version, string count, string bytes, type count, type operand count, function count
+//   strings        string count + 1 offsets followed by the character data, padded to a word
+//   types          interned type records {tag, flags, bits, size, target, operand begin, operand count}
+//   type operands  function argument type ids, and {type, offset, name} triples for record fields
+//   functions      function offsets (in words) followed by the function records
+// Each function record is a header of 16 words, {identifier, return type} followed by the counts of the sections after
+// it: arguments {name, type}, values (dense ids for ssa names), atoms {tag, type, two operands}, statements {tag, op or
+// argument count, three operands}, statement operands (call arguments and switch cases {low, high, successor} with
+// 64-bit bounds), blocks {index, phi count, statement count, successor count}, phis {result, incoming count}, phi
+// incomings {source block, value}, successors, the topological order, locals {name, type, align}, initializers {kind,
+// integer low, integer high, text, element begin, element count}, aggregate elements {index, initializer}, and globals
+// {name, type, linkage, align, section, flags, initializer, tls model}. Operands that refer to atoms are atom ids, so
+// constants can appear wherever a value can, and mem_ref, component_ref, array_ref and address_of atoms refer to their
+// operands the same way. Operator and intrinsic words carry fp_flags in their upper 16 bits. Only files written with
+// the current serialization_version are loaded.
+namespace bimple {
+    constexpr std::uint32_t serialization_version = 12;
+
+    class serializer {
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, std::uint32_t> string_ids;
+        std::vector<std::uint32_t> types;
+        std::vector<std::uint32_t> type_operands;
+        std::unordered_map<std::string, std::uint32_t> type_ids;
+        std::vector<std::vector<std::uint32_t>> functions;
+
+        std::uint32_t intern_string(const std::string& string);
+        std::uint32_t intern_type(const type& type);
+    public:
+        void add(const function& fn);
+        std::size_t size() const;
+        std::vector<std::byte> finish() const;
+        void write(const std::string& path) const;
+    };
+
+    // Reads a serialized module in place, the underlying memory must outlive the module
+    class serialized_module {
+        const std::uint32_t* words;
+        std::size_t word_count;
+        std::uint32_t string_count;
+        const std::uint32_t* string_offsets;
+        const char* string_data;
+        std::uint32_t type_count;
+        const std::uint32_t* type_records;
+        std::uint32_t type_operand_count;
+        const std::uint32_t* type_operand_data;
+        std::uint32_t function_count;
+        const std::uint32_t* function_offsets;
+
+        std::string_view string(std::uint32_t id) const;
+        std::unique_ptr<type> load_type(std::uint32_t id) const;
+    public:
+        explicit serialized_module(std::span<const std::byte> data);
+        std::size_t size() const;
+        std::string_view function_name(std::size_t i) const;
+        function load(std::size_t i) const;
+    };
+
+    // Read-only memory mapping of a file
+    class mapped_file {
+        void* data = nullptr;
+        std::size_t length = 0;
+    public:
+        explicit mapped_file(const std::string& path);
+        ~mapped_file();
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+        std::span<const std::byte> bytes() const;
+    };
+}
+
+#endif
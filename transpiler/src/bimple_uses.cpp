@@ -0,0 +1,146 @@
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+
+#include "bimple.h"
+#include "bimple_uses.h"
+
+namespace bimple {
+    void use_lists::add_use(std::unique_ptr<atom>& slot, bool is_address) {
+        auto* var = downcast<variable>(slot);
+        if(!var) {
+            return;
+        }
+        auto& list = lists[var->name];
+        auto [it, inserted] = positions.insert({var, list.size()});
+        ASSERT(inserted, "Use added twice", var->name);
+        list.push_back({&slot, is_address});
+    }
+
+    // swaps the last use of the value into the removed one's place
+    void use_lists::remove_use(std::unique_ptr<atom>& slot) {
+        auto* var = downcast<variable>(slot);
+        if(!var) {
+            return;
+        }
+        auto position = positions.find(var);
+        VERIFY(position != positions.end(), "Use was never added", var->name);
+        auto list = lists.find(var->name);
+        VERIFY(list != lists.end());
+        auto& uses = list->second;
+        std::size_t index = position->second;
+        positions.erase(position);
+        if(index != uses.size() - 1) {
+            uses[index] = uses.back();
+            positions[uses[index].slot->get()] = index;
+        }
+        uses.pop_back();
+        if(uses.empty()) {
+            lists.erase(list);
+        }
+    }
+
+    use_lists::use_lists(function& fn) {
+        for(auto& bb : fn.basic_blocks) {
+            for(auto& phi : bb.phis) {
+                add(phi);
+            }
+            for(auto& statement : bb.statements) {
+                add(*statement);
+            }
+        }
+    }
+
+    std::span<const use> use_lists::uses(const std::string& name) const {
+        auto it = lists.find(name);
+        if(it == lists.end()) {
+            return {};
+        }
+        return it->second;
+    }
+
+    std::size_t use_lists::use_count(const std::string& name) const {
+        return uses(name).size();
+    }
+
+    bool use_lists::unused(const std::string& name) const {
+        return !lists.contains(name);
+    }
+
+    void use_lists::add(statement& statement) {
+        for_each_use(statement, [this] (std::unique_ptr<atom>& slot, bool is_address) {
+            add_use(slot, is_address);
+        });
+    }
+
+    void use_lists::remove(statement& statement) {
+        for_each_use(statement, [this] (std::unique_ptr<atom>& slot, bool) {
+            remove_use(slot);
+        });
+    }
+
+    void use_lists::add(phi& phi) {
+        for(auto& [_, value] : phi.values) {
+            add_use(value, false);
+        }
+    }
+
+    void use_lists::remove(phi& phi) {
+        for(auto& [_, value] : phi.values) {
+            remove_use(value);
+        }
+    }
+
+    std::size_t use_lists::replace_all_uses_with(const std::string& name, const atom& replacement) {
+        auto* replacement_var = downcast<variable>(&replacement);
+        VERIFY(
+            replacement_var
+                || replacement.tag == atom_tag::integer_constant
+                || replacement.tag == atom_tag::real_constant,
+            "Values can only be replaced with variables or constants",
+            replacement.tag
+        );
+        auto it = lists.find(name);
+        if(it == lists.end() || (replacement_var && replacement_var->name == name)) {
+            return 0;
+        }
+        // name may refer to one of the variables that are renamed
+        std::string old_name = name;
+        auto old_uses = std::move(it->second);
+        lists.erase(it);
+        std::vector<use> kept;
+        std::size_t replaced = 0;
+        for(auto& use : old_uses) {
+            auto& slot = *use.slot;
+            if(replacement_var) {
+                // renaming keeps the atom, only the list it's on changes
+                downcast<variable>(slot)->name = replacement_var->name;
+                auto& list = lists[replacement_var->name];
+                positions[slot.get()] = list.size();
+                list.push_back(use);
+                replaced++;
+            } else if(!use.is_address && slot->type->tag != type_tag::pointer) {
+                positions.erase(slot.get());
+                auto constant = replacement.clone();
+                constant->type = slot->type->clone();
+                slot = std::move(constant);
+                replaced++;
+            } else {
+                positions[slot.get()] = kept.size();
+                kept.push_back(use);
+            }
+        }
+        if(!kept.empty()) {
+            lists.insert({std::move(old_name), std::move(kept)});
+        }
+        return replaced;
+    }
+}
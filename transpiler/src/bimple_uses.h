@@ -0,0 +1,54 @@
+#ifndef BIMPLE_USES_H
+#define BIMPLE_USES_H
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bimple.h"
+
+// Use lists for the ssa values of a bimple function, covering statement operands (including the address operands of
+// stores and the operands of conds) and phi incoming values. A use is the operand slot holding a variable with the
+// value's name.
+namespace bimple {
+    struct use {
+        std::unique_ptr<atom>* slot;
+        // base or offset of a mem_ref
+        bool is_address;
+    };
+
+    // Built in one walk over the function and then kept up to date by the pass editing it: statements and phis have to
+    // be removed before their operands are changed or they are erased and added again afterwards. Operand slots are
+    // stable while their statement is alive and their phi's incoming values aren't resized, so phis may move between
+    // blocks' vectors.
+    class use_lists {
+        std::unordered_map<std::string, std::vector<use>> lists;
+        // index of each use in its value's list
+        std::unordered_map<const atom*, std::size_t> positions;
+
+        void add_use(std::unique_ptr<atom>& slot, bool is_address);
+        void remove_use(std::unique_ptr<atom>& slot);
+    public:
+        explicit use_lists(function& fn);
+
+        // in no particular order
+        std::span<const use> uses(const std::string& name) const;
+        std::size_t use_count(const std::string& name) const;
+        bool unused(const std::string& name) const;
+
+        void add(statement& statement);
+        void remove(statement& statement);
+        void add(phi& phi);
+        void remove(phi& phi);
+
+        // Rewrites the uses of name to replacement, a variable or a constant, and returns how many were rewritten.
+        // Uses keep their own type. Constants aren't put in address operands or pointer typed uses, those stay uses of
+        // name. Costs O(uses of name).
+        std::size_t replace_all_uses_with(const std::string& name, const atom& replacement);
+    };
+}
+
+#endif
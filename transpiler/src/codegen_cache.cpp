@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_serialization.h"
+#include "codegen_cache.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+    std::uint64_t fnv1a(const std::vector<std::byte>& data) {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for(auto byte : data) {
+            hash ^= std::uint64_t(byte);
+            hash *= 0x100000001b3;
+        }
+        return hash;
+    }
+
+    bool is_temporary(const fs::path& path) {
+        return path.extension() == ".tmp";
+    }
+}
+
+codegen_cache::codegen_cache(fs::path directory, std::uintmax_t max_bytes, std::string salt) :
+    directory(std::move(directory)),
+    max_bytes(max_bytes),
+    salt(std::move(salt)) {}
+
+std::vector<std::byte> codegen_cache::key_data(const bimple::function& function) {
+    bimple::serializer serializer;
+    serializer.add(function);
+    return serializer.finish();
+}
+
+fs::path codegen_cache::entry_path(const std::vector<std::byte>& key_data) const {
+    std::vector<std::byte> salted = key_data;
+    for(char c : salt) {
+        salted.push_back(std::byte(c));
+    }
+    auto hash = fmt::format("{:016x}", fnv1a(salted));
+    return directory / hash.substr(0, 2) / hash.substr(2);
+}
+
+// entry layout: u64 key size, key data, salt size, salt, then the ir until the end of the file
+std::optional<std::string> codegen_cache::lookup(const std::vector<std::byte>& key_data) {
+    auto path = entry_path(key_data);
+    std::ifstream f(path, std::ios::binary);
+    if(!f) {
+        stats.misses++;
+        return std::nullopt;
+    }
+    auto read_block = [&f](std::uint64_t& size, std::vector<char>& data) {
+        if(!f.read(reinterpret_cast<char*>(&size), sizeof(size)) || size > (1ull << 32)) {
+            return false;
+        }
+        data.resize(size);
+        return bool(f.read(data.data(), std::streamsize(size)));
+    };
+    std::uint64_t key_size, salt_size;
+    std::vector<char> stored_key, stored_salt;
+    if(
+        !read_block(key_size, stored_key)
+        || !read_block(salt_size, stored_salt)
+        || key_size != key_data.size()
+        || std::memcmp(stored_key.data(), key_data.data(), key_data.size()) != 0
+        || std::string_view(stored_salt.data(), stored_salt.size()) != salt
+    ) {
+        stats.collisions++;
+        stats.misses++;
+        return std::nullopt;
+    }
+    std::string ir(std::istreambuf_iterator<char>(f), {});
+    f.close();
+    // mark as recently used, failure only makes the entry more likely to be evicted
+    std::error_code ec;
+    fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    stats.hits++;
+    return ir;
+}
+
+void codegen_cache::store(const std::vector<std::byte>& key_data, const std::string& ir) {
+    auto path = entry_path(key_data);
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if(ec) {
+        return;
+    }
+    auto temporary = path;
+    temporary += fmt::format(".{}.tmp", getpid());
+    {
+        std::ofstream f(temporary, std::ios::binary);
+        if(!f) {
+            return;
+        }
+        std::uint64_t key_size = key_data.size();
+        std::uint64_t salt_size = salt.size();
+        f.write(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+        f.write(reinterpret_cast<const char*>(key_data.data()), std::streamsize(key_data.size()));
+        f.write(reinterpret_cast<const char*>(&salt_size), sizeof(salt_size));
+        f.write(salt.data(), std::streamsize(salt.size()));
+        f.write(ir.data(), std::streamsize(ir.size()));
+        if(!f) {
+            f.close();
+            fs::remove(temporary, ec);
+            return;
+        }
+    }
+    fs::rename(temporary, path, ec);
+    if(ec) {
+        fs::remove(temporary, ec);
+        return;
+    }
+    stats.stores++;
+}
+
+void codegen_cache::evict() {
+    struct entry {
+        fs::path path;
+        std::uintmax_t size;
+        fs::file_time_type last_used;
+    };
+    std::vector<entry> entries;
+    std::uintmax_t total = 0;
+    std::error_code ec;
+    for(auto it = fs::recursive_directory_iterator(directory, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if(!it->is_regular_file(ec) || is_temporary(it->path())) {
+            continue;
+        }
+        auto size = it->file_size(ec);
+        auto last_used = it->last_write_time(ec);
+        if(ec) {
+            // removed by another process while iterating
+            ec.clear();
+            continue;
+        }
+        entries.push_back({it->path(), size, last_used});
+        total += size;
+    }
+    if(total <= max_bytes) {
+        return;
+    }
+    std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) { return a.last_used < b.last_used; });
+    for(const auto& entry : entries) {
+        if(total <= max_bytes) {
+            break;
+        }
+        bool removed = fs::remove(entry.path, ec);
+        if(ec) {
+            // an entry that can't be removed still takes up space, keep evicting newer ones
+            ec.clear();
+            continue;
+        }
+        // not removed without an error means another process already evicted it
+        if(removed) {
+            stats.evictions++;
+        }
+        total -= entry.size;
+    }
+}
+
+const codegen_cache::counters& codegen_cache::get_counters() const {
+    return stats;
+}
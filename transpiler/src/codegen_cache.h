@@ -0,0 +1,47 @@
+#ifndef CODEGEN_CACHE_H
+#define CODEGEN_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "bimple.h"
+
+// On-disk cache of generated llvm ir, keyed by the content of the bimple function (in its serialized form) together with
+// everything else that affects codegen. Entries are stored as <directory>/<2 hex digits>/<remaining hex digits> and hold
+// the full key data followed by the ir, so a hash collision is detected instead of returning wrong code. Entries are
+// written to a temporary file and renamed into place so concurrent compiler processes can share a directory.
+// Recency is tracked through the files' modification times, which evict() uses to trim the cache to its size limit.
+class codegen_cache {
+public:
+    struct counters {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        // entries that existed but didn't match the key data or couldn't be read
+        std::uint64_t collisions = 0;
+        std::uint64_t stores = 0;
+        std::uint64_t evictions = 0;
+    };
+private:
+    std::filesystem::path directory;
+    std::uintmax_t max_bytes;
+    // identifies the codegen version and options, mixed into every key
+    std::string salt;
+    counters stats;
+
+    std::filesystem::path entry_path(const std::vector<std::byte>& key_data) const;
+public:
+    codegen_cache(std::filesystem::path directory, std::uintmax_t max_bytes, std::string salt);
+    // the bytes a function is keyed by, used for both lookup and store
+    static std::vector<std::byte> key_data(const bimple::function& function);
+    std::optional<std::string> lookup(const std::vector<std::byte>& key_data);
+    void store(const std::vector<std::byte>& key_data, const std::string& ir);
+    // removes the least recently used entries until the cache fits in max_bytes
+    void evict();
+    const counters& get_counters() const;
+};
+
+#endif
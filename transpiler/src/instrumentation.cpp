@@ -0,0 +1,104 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+#include <sys/resource.h>
+
+#include "instrumentation.h"
+
+namespace instrumentation {
+    namespace {
+        thread_local allocation_counters counters;
+
+        void* allocate(std::size_t size) {
+            void* ptr = std::malloc(size == 0 ? 1 : size);
+            if(!ptr) {
+                throw std::bad_alloc();
+            }
+            auto usable = malloc_usable_size(ptr);
+            counters.allocations++;
+            counters.bytes += usable;
+            counters.live += usable;
+            if(counters.live > counters.peak) {
+                counters.peak = counters.live;
+            }
+            return ptr;
+        }
+
+        void deallocate(void* ptr) {
+            if(ptr) {
+                counters.live -= malloc_usable_size(ptr);
+                std::free(ptr);
+            }
+        }
+    }
+
+    allocation_counters allocations() {
+        return counters;
+    }
+
+    void reset_peak() {
+        counters.peak = counters.live;
+    }
+
+    std::size_t peak_rss() {
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        // ru_maxrss is in kilobytes on linux
+        return std::size_t(usage.ru_maxrss) * 1024;
+    }
+
+    stage_timer::stage_timer(stage_measurement& into) : into(into) {
+        reset_peak();
+        start_counters = allocations();
+        start = std::chrono::steady_clock::now();
+    }
+
+    stage_timer::~stage_timer() {
+        stop();
+    }
+
+    void stage_timer::stop() {
+        if(stopped) {
+            return;
+        }
+        stopped = true;
+        auto end = std::chrono::steady_clock::now();
+        auto end_counters = allocations();
+        into += {
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start),
+            end_counters.allocations - start_counters.allocations,
+            end_counters.bytes - start_counters.bytes,
+            end_counters.peak - start_counters.live
+        };
+    }
+}
+
+// Replacements for wyrm's own allocations. The plugin is linked with -Bsymbolic-functions so references from the plugin
+// bind to these while gcc's allocations (and other libraries') keep using the default operator new.
+void* operator new(std::size_t size) {
+    return instrumentation::allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return instrumentation::allocate(size);
+}
+
+void operator delete(void* ptr) noexcept {
+    instrumentation::deallocate(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    instrumentation::deallocate(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    instrumentation::deallocate(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    instrumentation::deallocate(ptr);
+}
@@ -0,0 +1,57 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Lightweight measurement of wyrm's own cost, used for -fplugin-arg-libplugin-timings and the benchmark suite.
+// Allocation counters only see allocations made by wyrm code (operator new is replaced inside the plugin) and are
+// per-thread.
+namespace instrumentation {
+    struct allocation_counters {
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        // live bytes can go negative when freeing memory allocated outside of wyrm code
+        std::int64_t live = 0;
+        std::int64_t peak = 0;
+    };
+
+    allocation_counters allocations();
+    // resets the peak to the current live bytes
+    void reset_peak();
+    // peak resident set size of the process in bytes
+    std::size_t peak_rss();
+
+    struct stage_measurement {
+        std::chrono::nanoseconds time{};
+        std::uint64_t allocations = 0;
+        std::uint64_t bytes = 0;
+        // peak live bytes above the live bytes at the start of the stage
+        std::int64_t peak_bytes = 0;
+
+        stage_measurement& operator+=(const stage_measurement& other) {
+            time += other.time;
+            allocations += other.allocations;
+            bytes += other.bytes;
+            peak_bytes = peak_bytes > other.peak_bytes ? peak_bytes : other.peak_bytes;
+            return *this;
+        }
+    };
+
+    // Measures from construction until stop() or destruction and adds the measurement to `into`
+    class stage_timer {
+        stage_measurement& into;
+        std::chrono::steady_clock::time_point start;
+        allocation_counters start_counters;
+        bool stopped = false;
+    public:
+        explicit stage_timer(stage_measurement& into);
+        ~stage_timer();
+        stage_timer(const stage_timer&) = delete;
+        stage_timer& operator=(const stage_timer&) = delete;
+        void stop();
+    };
+}
+
+#endif
@@ -0,0 +1,321 @@
+// wyrm-jit: loads transpiled .ll/.bc files into an ORC JIT and calls functions in-process
+//
+// usage: wyrm-jit <file.ll|file.bc>... [--repeat N] [--warmup N] --call <symbol> [args...] [--expect <value>] ...
+//
+// Every --call starts a new invocation, arguments are parsed according to the function's llvm signature.
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/SourceMgr.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <fmt/core.h>
+#include <fmt/ranges.h>
+
+namespace orc = llvm::orc;
+
+struct invocation {
+    std::string symbol;
+    std::vector<std::string> args;
+    std::optional<std::string> expected;
+    // filled in once the signature is known
+    llvm::FunctionType* type = nullptr;
+    std::string thunk;
+};
+
+// every argument and the return value are passed through 8 byte slots
+using thunk_fn = void(*)(const uint64_t* args, uint64_t* ret);
+
+static uint64_t cycles() {
+    #if defined(__x86_64__) || defined(__i386__)
+    unsigned aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+    #else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+    #endif
+}
+
+[[noreturn]] static void fail(const std::string& message) {
+    fmt::print(stderr, "wyrm-jit: {}\n", message);
+    std::exit(2);
+}
+
+static void check(llvm::Error error) {
+    if(error) {
+        fail(llvm::toString(std::move(error)));
+    }
+}
+
+template<typename T>
+static T check(llvm::Expected<T> value) {
+    if(!value) {
+        fail(llvm::toString(value.takeError()));
+    }
+    return std::move(*value);
+}
+
+static bool is_supported(llvm::Type* type) {
+    return (type->isIntegerTy() && type->getIntegerBitWidth() <= 64) || type->isFloatTy() || type->isDoubleTy();
+}
+
+// thunk calling `target` with arguments loaded from the args buffer and storing the result into ret
+static std::unique_ptr<llvm::Module> build_thunk(
+    llvm::LLVMContext& context,
+    const invocation& call
+) {
+    auto module = std::make_unique<llvm::Module>(call.thunk, context);
+    auto* i64 = llvm::Type::getInt64Ty(context);
+    auto* slot_ptr = llvm::PointerType::getUnqual(i64);
+    auto* target = llvm::Function::Create(
+        call.type,
+        llvm::GlobalValue::ExternalLinkage,
+        call.symbol,
+        *module
+    );
+    auto* thunk = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), {slot_ptr, slot_ptr}, false),
+        llvm::GlobalValue::ExternalLinkage,
+        call.thunk,
+        *module
+    );
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", thunk));
+    auto load_slot = [&] (llvm::Type* type, unsigned i) -> llvm::Value* {
+        auto* slot = builder.CreateConstInBoundsGEP1_64(i64, thunk->getArg(0), i);
+        if(type->isIntegerTy()) {
+            return builder.CreateTrunc(builder.CreateLoad(i64, slot), type);
+        } else {
+            return builder.CreateLoad(type, builder.CreatePointerCast(slot, llvm::PointerType::getUnqual(type)));
+        }
+    };
+    std::vector<llvm::Value*> args;
+    for(unsigned i = 0; i < call.type->getNumParams(); i++) {
+        args.push_back(load_slot(call.type->getParamType(i), i));
+    }
+    auto* result = builder.CreateCall(target, args);
+    auto* return_type = call.type->getReturnType();
+    if(return_type->isIntegerTy()) {
+        auto* extended = return_type->getIntegerBitWidth() == 1
+            ? builder.CreateZExt(result, i64)
+            : builder.CreateSExt(result, i64);
+        builder.CreateStore(extended, thunk->getArg(1));
+    } else if(!return_type->isVoidTy()) {
+        builder.CreateStore(result, builder.CreatePointerCast(thunk->getArg(1), llvm::PointerType::getUnqual(return_type)));
+    }
+    builder.CreateRetVoid();
+    return module;
+}
+
+static uint64_t parse_value(llvm::Type* type, const std::string& text) {
+    char* end = nullptr;
+    uint64_t slot = 0;
+    if(type->isIntegerTy()) {
+        slot = text.starts_with('-') ? uint64_t(std::strtoll(text.c_str(), &end, 0)) : std::strtoull(text.c_str(), &end, 0);
+    } else if(type->isFloatTy()) {
+        float f = std::strtof(text.c_str(), &end);
+        std::memcpy(&slot, &f, sizeof(f));
+    } else {
+        double d = std::strtod(text.c_str(), &end);
+        std::memcpy(&slot, &d, sizeof(d));
+    }
+    if(end == text.c_str() || *end != 0) {
+        fail(fmt::format("Can't parse \"{}\" as an argument", text));
+    }
+    return slot;
+}
+
+static std::string format_value(llvm::Type* type, uint64_t slot) {
+    if(type->isVoidTy()) {
+        return "void";
+    } else if(type->isIntegerTy()) {
+        unsigned bits = type->getIntegerBitWidth();
+        if(bits < 64 && bits > 1) {
+            // the thunk sign extended the result, truncate back to the value's width
+            slot &= (uint64_t(1) << bits) - 1;
+            if(slot >> (bits - 1)) {
+                slot |= ~((uint64_t(1) << bits) - 1);
+            }
+        }
+        return std::to_string(int64_t(slot));
+    } else if(type->isFloatTy()) {
+        float f;
+        std::memcpy(&f, &slot, sizeof(f));
+        return fmt::format("{}", f);
+    } else {
+        double d;
+        std::memcpy(&d, &slot, sizeof(d));
+        return fmt::format("{}", d);
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> files;
+    std::vector<invocation> calls;
+    unsigned repeat = 0;
+    unsigned warmup = 0;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto next = [&] () -> std::string {
+            if(i + 1 >= argc) {
+                fail(fmt::format("Missing value for {}", arg));
+            }
+            return argv[++i];
+        };
+        if(arg == "--call") {
+            calls.push_back({next()});
+        } else if(arg == "--expect") {
+            if(calls.empty()) {
+                fail("--expect must follow --call");
+            }
+            calls.back().expected = next();
+        } else if(arg == "--repeat") {
+            repeat = std::stoul(next());
+        } else if(arg == "--warmup") {
+            warmup = std::stoul(next());
+        } else if(!calls.empty()) {
+            calls.back().args.push_back(std::string(arg));
+        } else {
+            files.push_back(std::string(arg));
+        }
+    }
+    if(files.empty() || calls.empty()) {
+        fail("usage: wyrm-jit <file.ll|file.bc>... [--repeat N] [--warmup N] --call <symbol> [args...] [--expect <value>] ...");
+    }
+
+    llvm::InitializeNativeTarget();
+    llvm::InitializeNativeTargetAsmPrinter();
+    llvm::InitializeNativeTargetAsmParser();
+
+    auto jit = check(orc::LLJITBuilder().create());
+    jit->getMainJITDylib().addGenerator(
+        check(orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(jit->getDataLayout().getGlobalPrefix()))
+    );
+    // all modules share one context so signatures can be looked up across files
+    orc::ThreadSafeContext context(std::make_unique<llvm::LLVMContext>());
+    auto& llvm_context = *context.getContext();
+    // wyrm emits `ptr`, older llvm versions only parse it with opaque pointers turned on
+    #if LLVM_VERSION_MAJOR < 15
+    const char* llvm_args[] = {"wyrm-jit", "-opaque-pointers"};
+    llvm::cl::ParseCommandLineOptions(2, llvm_args);
+    #elif LLVM_VERSION_MAJOR < 17
+    llvm_context.setOpaquePointers(true);
+    #endif
+    std::vector<std::unique_ptr<llvm::Module>> modules;
+    for(const auto& file : files) {
+        llvm::SMDiagnostic diagnostic;
+        auto module = llvm::parseIRFile(file, diagnostic, llvm_context);
+        if(!module) {
+            std::string message;
+            llvm::raw_string_ostream s(message);
+            diagnostic.print("wyrm-jit", s);
+            fail(s.str());
+        }
+        module->setDataLayout(jit->getDataLayout());
+        modules.push_back(std::move(module));
+    }
+    for(auto& call : calls) {
+        for(const auto& module : modules) {
+            if(auto* fn = module->getFunction(call.symbol); fn && !fn->isDeclaration()) {
+                call.type = fn->getFunctionType();
+            }
+        }
+        if(!call.type) {
+            fail(fmt::format("No definition of {} found", call.symbol));
+        }
+        if(call.type->isVarArg() || call.type->getNumParams() != call.args.size()) {
+            fail(fmt::format("{} expects {} arguments, got {}", call.symbol, call.type->getNumParams(), call.args.size()));
+        }
+        for(auto* type : call.type->params()) {
+            if(!is_supported(type)) {
+                fail(fmt::format("Unsupported parameter type for {}", call.symbol));
+            }
+        }
+        if(!call.type->getReturnType()->isVoidTy() && !is_supported(call.type->getReturnType())) {
+            fail(fmt::format("Unsupported return type for {}", call.symbol));
+        }
+        call.thunk = fmt::format("__wyrm_jit_thunk_{}", &call - calls.data());
+    }
+    for(auto& module : modules) {
+        check(jit->addIRModule(orc::ThreadSafeModule(std::move(module), context)));
+    }
+    for(const auto& call : calls) {
+        auto module = build_thunk(llvm_context, call);
+        module->setDataLayout(jit->getDataLayout());
+        check(jit->addIRModule(orc::ThreadSafeModule(std::move(module), context)));
+    }
+
+    bool ok = true;
+    for(const auto& call : calls) {
+        auto symbol = check(jit->lookup(call.thunk));
+        #if LLVM_VERSION_MAJOR >= 15
+        auto thunk = symbol.toPtr<thunk_fn>();
+        #else
+        auto thunk = reinterpret_cast<thunk_fn>(symbol.getAddress());
+        #endif
+        std::vector<uint64_t> args;
+        for(unsigned i = 0; i < call.args.size(); i++) {
+            args.push_back(parse_value(call.type->getParamType(i), call.args[i]));
+        }
+        uint64_t result = 0;
+        thunk(args.data(), &result);
+        auto* return_type = call.type->getReturnType();
+        auto printed = format_value(return_type, result);
+        std::string status;
+        if(call.expected) {
+            bool matches = return_type->isVoidTy()
+                || format_value(return_type, parse_value(return_type, *call.expected)) == printed;
+            status = matches ? " [ok]" : fmt::format(" [FAIL, expected {}]", *call.expected);
+            ok &= matches;
+        }
+        fmt::print("{}({}) = {}{}\n", call.symbol, fmt::join(call.args, ", "), printed, status);
+        if(repeat > 0) {
+            // results are discarded, each call is timed individually and the median is reported
+            for(unsigned i = 0; i < warmup; i++) {
+                thunk(args.data(), &result);
+            }
+            std::vector<uint64_t> samples(repeat);
+            auto start = std::chrono::steady_clock::now();
+            for(auto& sample : samples) {
+                auto before = cycles();
+                thunk(args.data(), &result);
+                sample = cycles() - before;
+            }
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            std::sort(samples.begin(), samples.end());
+            fmt::print(
+                "    {} calls: median {} cycles, min {} cycles, {:.2f} ns/call\n",
+                repeat,
+                samples[samples.size() / 2],
+                samples.front(),
+                double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()) / repeat
+            );
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -1,13 +1,18 @@
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <new>
+#include <optional>
+#include <set>
 #include <stack>
 #include <string_view>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #ifndef ASSERT_USE_MAGIC_ENUM
@@ -29,80 +34,134 @@ class llvm_codegen::impl {
     // temporaries used for conditional results
     std::unordered_map<const bimple::cond*, std::string> cond_temps;
     unsigned llvmir_id = 0;
+    block_layout layout;
+    // declarations of the intrinsics the current function calls, emitted ahead of it
+    std::set<std::string> declarations;
+    // addresses of locals used as operands, computed once after the allocas since they dominate every use
+    std::vector<std::string> entry_lines;
+    std::unordered_map<std::string, std::string> invariant_addresses;
+    // (block ending in a switch, successor) -> edges between them
+    std::map<std::pair<int, int>, std::size_t> switch_edges;
 public:
-    std::string generate_type(const std::unique_ptr<bimple::type>& type) {
-        // std::cout<<*type<<std::endl;
-        if(auto* ptr = bimple::downcast<bimple::integer>(type)) {
-            return fmt::format("i{}", ptr->bits);
-        } else if(auto* ptr = bimple::downcast<bimple::real>(type)) {
-            // TODO bfloat, ppc_fp128
-            switch(ptr->bits) {
-                case 16: return "half";
-                case 32: return "float";
-                case 64: return "double";
-                case 80: return "x86_fp80";
-                case 128: return "fp128";
-                default:
-                    VERIFY(false, ptr->bits);
-                    __builtin_unreachable();
+    impl(block_layout layout) : layout(layout) {}
+
+    // llvm element index of each field of a struct, with the element types of the packed struct it's emitted as when
+    // elements isn't null. Fields overlapping an earlier one (or running past the end) have no element and are -1.
+    std::vector<int> struct_layout(const bimple::record& r, std::vector<std::string>* elements) {
+        std::vector<int> indices;
+        std::size_t position = 0;
+        int next = 0;
+        auto pad = [&] (std::size_t to) {
+            if(to > position) {
+                if(elements) {
+                    elements->push_back(fmt::format("[{} x i8]", to - position));
+                }
+                next++;
+                position = to;
             }
-        } else if(auto* ptr = bimple::downcast<bimple::void_type>(type)) {
-            return "void";
-        } else if(auto* ptr = bimple::downcast<bimple::pointer>(type)) {
-            return "ptr";
-        } else {
-            VERIFY(false, "Unhandled type", type->tag);
-            __builtin_unreachable();
+        };
+        for(const auto& f : r.fields) {
+            if(f.offset < position || f.offset + f.type->size > r.size) {
+                indices.push_back(-1);
+                continue;
+            }
+            pad(f.offset);
+            if(elements) {
+                elements->push_back(generate_type(f.type));
+            }
+            indices.push_back(next++);
+            position += f.type->size;
         }
+        pad(r.size);
+        return indices;
+    }
+
+    std::string generate_type(const std::unique_ptr<bimple::type>& type) {
+        return bimple::visit(type, [this] (const auto& t) -> std::string {
+            using T = std::remove_cvref_t<decltype(t)>;
+            if constexpr(std::is_same_v<T, bimple::integer>) {
+                return fmt::format("i{}", t.bits);
+            } else if constexpr(std::is_same_v<T, bimple::real>) {
+                // TODO bfloat, ppc_fp128
+                switch(t.bits) {
+                    case 16: return "half";
+                    case 32: return "float";
+                    case 64: return "double";
+                    case 80: return "x86_fp80";
+                    case 128: return "fp128";
+                    default:
+                        VERIFY(false, t.bits);
+                        __builtin_unreachable();
+                }
+            } else if constexpr(std::is_same_v<T, bimple::void_type>) {
+                return "void";
+            } else if constexpr(std::is_same_v<T, bimple::pointer>) {
+                return "ptr";
+            } else if constexpr(std::is_same_v<T, bimple::array>) {
+                return fmt::format("[{} x {}]", t.count, generate_type(t.element_type));
+            } else if constexpr(std::is_same_v<T, bimple::struct_type>) {
+                // there's no datalayout to lay a named struct out with, a packed literal struct spells out gcc's
+                // offsets with explicit padding
+                std::vector<std::string> elements;
+                struct_layout(t, &elements);
+                return fmt::format("<{{ {} }}>", fmt::join(elements, ", "));
+            } else if constexpr(std::is_same_v<T, bimple::union_type>) {
+                // members are reached through byte offsets
+                return fmt::format("[{} x i8]", t.size);
+            } else {
+                VERIFY(false, "Unhandled type", t.tag);
+                __builtin_unreachable();
+            }
+        });
     }
 
     std::string generate_atom(const std::unique_ptr<bimple::atom>& atom) {
-        if(auto* ptr = bimple::downcast<bimple::variable>(atom)) {
-            return llvm_name(ptr->name);
-        } else if(auto* ptr = bimple::downcast<bimple::addr_expr>(atom)) {
-            return fmt::format("@{}", ptr->name);
-        } else if(auto* ptr = bimple::downcast<bimple::integer_constant>(atom)) {
-            return std::to_string(ptr->value);
-        } else if(auto* ptr = bimple::downcast<bimple::real_constant>(atom)) {
-            return ptr->to_string(); // FIXME
-        } else {
-            VERIFY(false, "Unhandled atom", atom->tag);
-            __builtin_unreachable();
-        }
+        return bimple::visit(atom, [this] (const auto& a) -> std::string {
+            using T = std::remove_cvref_t<decltype(a)>;
+            if constexpr(std::is_same_v<T, bimple::variable>) {
+                return llvm_name(a.name);
+            } else if constexpr(std::is_same_v<T, bimple::addr_expr>) {
+                return fmt::format("@{}", a.name);
+            } else if constexpr(std::is_same_v<T, bimple::integer_constant>) {
+                return std::to_string(a.value);
+            } else if constexpr(std::is_same_v<T, bimple::real_constant>) {
+                return a.to_string(); // FIXME
+            } else if constexpr(std::is_same_v<T, bimple::zero_initializer>) {
+                return "zeroinitializer";
+            } else if constexpr(std::is_same_v<T, bimple::address_of>) {
+                return invariant_address(a.reference);
+            } else {
+                VERIFY(false, "Unhandled atom", a.tag);
+                __builtin_unreachable();
+            }
+        });
     }
 
     std::string generate_basic_assign(const bimple::unary_assignment* assignment) {
         ASSERT(assignment->op == bimple::operators::assign);
         // handle stores
-        if(auto* l_mem = bimple::downcast<bimple::mem_ref>(assignment->lhs)) {
-            auto scaled = new_temp();
-            auto tmp = new_temp();
-            return join(
-                {
-                    fmt::format(
-                        "{} = udiv i64 {}, {}",
-                        scaled,
-                        // generate_type(memref->offset->type),
-                        generate_atom(l_mem->offset),
-                        assignment->lhs->type->size
-                    ),
-                    fmt::format(
-                        "{} = getelementptr inbounds {}, ptr {}, {} {}",
-                        tmp,
-                        generate_type(assignment->rhs->type),
-                        generate_atom(l_mem->base),
-                        "i64", // generate_type(l_mem->offset->type),
-                        scaled // generate_atom(l_mem->offset)
-                    ),
-                    fmt::format(
-                        "store {} {}, ptr {}",
-                        generate_type(assignment->rhs->type),
-                        generate_atom(assignment->rhs),
-                        tmp
-                    )
-                },
-                '\n'
+        if(bimple::is_memory_reference(*assignment->lhs)) {
+            std::vector<std::string> lines;
+            auto address = generate_address(assignment->lhs, lines);
+            lines.push_back(
+                fmt::format(
+                    "store {} {}, ptr {}",
+                    generate_type(assignment->rhs->type),
+                    generate_atom(assignment->rhs),
+                    address
+                )
             );
+            return join(lines, '\n');
+        }
+        if(assignment->rhs->tag == bimple::atom_tag::address_of) {
+            std::vector<std::string> lines;
+            auto lhs = generate_atom(assignment->lhs);
+            const auto& reference = VERIFY(bimple::downcast<bimple::address_of>(assignment->rhs))->reference;
+            auto address = generate_address(reference, lines, lhs);
+            if(address != lhs) {
+                lines.push_back(fmt::format("{} = bitcast ptr {} to ptr", lhs, address));
+            }
+            return join(lines, '\n');
         }
         auto lhs = generate_atom(assignment->lhs);
         auto rhs = generate_atom(assignment->rhs);
@@ -213,41 +272,38 @@ public:
                 return generate_basic_assign(assignment);
             case bimple::operators::mem_ref:
                 {
-                    auto* memref = VERIFY(bimple::downcast<bimple::mem_ref>(assignment->rhs));
-                    // return fmt::format(
-                    //     "{} = load {}, ptr {}",
-                    //     generate_atom(assignment->lhs),
-                    //     generate_type(assignment->lhs->type),
-                    //     generate_atom(assignment->rhs)
-                    // );
-                    auto scaled = new_temp();
-                    auto tmp = new_temp();
-                    return join(
-                        {
-                            fmt::format(
-                                "{} = udiv i64 {}, {}",
-                                scaled,
-                                // generate_type(memref->offset->type),
-                                generate_atom(memref->offset),
-                                assignment->lhs->type->size
-                            ),
-                            fmt::format(
-                                "{} = getelementptr inbounds {}, ptr {}, {} {}",
-                                tmp,
-                                generate_type(assignment->lhs->type),
-                                generate_atom(memref->base),
-                                "i64", // generate_type(memref->offset->type),
-                                scaled // generate_atom(memref->offset)
-                            ),
-                            fmt::format(
-                                "{} = load {}, ptr {}",
-                                generate_atom(assignment->lhs),
-                                generate_type(assignment->lhs->type),
-                                tmp
-                            )
-                        },
-                        '\n'
+                    std::vector<std::string> lines;
+                    auto source = generate_address(assignment->rhs, lines);
+                    if(bimple::is_memory_reference(*assignment->lhs)) {
+                        // memory to memory, aggregates are copied whole
+                        auto destination = generate_address(assignment->lhs, lines);
+                        if(bimple::is_aggregate(*assignment->rhs->type)) {
+                            declare("declare void @llvm.memcpy.p0.p0.i64(ptr, ptr, i64, i1)");
+                            lines.push_back(
+                                fmt::format(
+                                    "call void @llvm.memcpy.p0.p0.i64(ptr {}, ptr {}, i64 {}, i1 false)",
+                                    destination,
+                                    source,
+                                    assignment->rhs->type->size
+                                )
+                            );
+                        } else {
+                            auto value = new_temp();
+                            auto type = generate_type(assignment->rhs->type);
+                            lines.push_back(fmt::format("{} = load {}, ptr {}", value, type, source));
+                            lines.push_back(fmt::format("store {} {}, ptr {}", type, value, destination));
+                        }
+                        return join(lines, '\n');
+                    }
+                    lines.push_back(
+                        fmt::format(
+                            "{} = load {}, ptr {}",
+                            generate_atom(assignment->lhs),
+                            generate_type(assignment->lhs->type),
+                            source
+                        )
                     );
+                    return join(lines, '\n');
                 }
             case bimple::operators::bit_not:
                 // llvm doesn't have a bitwise not
@@ -272,8 +328,9 @@ public:
                     );
                 } else if(bimple::downcast<bimple::real>(assignment->rhs->type)) {
                     return fmt::format(
-                        "{} = fneg {} {}",
+                        "{} = fneg{} {} {}",
                         generate_atom(assignment->lhs),
+                        fast_math_flags(assignment->flags),
                         generate_type(assignment->rhs->type),
                         generate_atom(assignment->rhs)
                     );
@@ -287,6 +344,130 @@ public:
         }
     }
 
+    // only locals, globals and constants, the address is the same wherever it's computed
+    static bool is_invariant_address(const std::unique_ptr<bimple::atom>& reference) {
+        auto is_constant = [] (const std::unique_ptr<bimple::atom>& a) {
+            return a->tag == bimple::atom_tag::integer_constant;
+        };
+        if(reference->tag == bimple::atom_tag::local_ref || reference->tag == bimple::atom_tag::global_ref) {
+            return true;
+        } else if(auto* ref = bimple::downcast<bimple::mem_ref>(reference)) {
+            if(!is_constant(ref->offset)) {
+                return false;
+            } else if(ref->base->tag == bimple::atom_tag::addr_expr) {
+                return true;
+            }
+            auto* base = bimple::downcast<bimple::address_of>(ref->base);
+            return base && is_invariant_address(base->reference);
+        } else if(auto* ref = bimple::downcast<bimple::component_ref>(reference)) {
+            return is_invariant_address(ref->base);
+        } else if(auto* ref = bimple::downcast<bimple::array_ref>(reference)) {
+            return is_invariant_address(ref->base) && is_constant(ref->index);
+        }
+        return false;
+    }
+
+    std::string invariant_address(const std::unique_ptr<bimple::atom>& reference) {
+        VERIFY(is_invariant_address(reference), "Address operand isn't invariant", reference->to_string());
+        auto key = reference->to_string();
+        if(auto it = invariant_addresses.find(key); it != invariant_addresses.end()) {
+            return it->second;
+        }
+        std::vector<std::string> lines;
+        auto address = generate_address(reference, lines);
+        entry_lines.insert(entry_lines.end(), lines.begin(), lines.end());
+        invariant_addresses.insert({std::move(key), address});
+        return address;
+    }
+
+    // Emits what computes the address of a memory reference into lines and returns the pointer. The outermost
+    // getelementptr is named destination when one is given, references that need no instruction return their base.
+    std::string generate_address(
+        const std::unique_ptr<bimple::atom>& reference,
+        std::vector<std::string>& lines,
+        const std::string& destination = ""
+    ) {
+        auto result = [&] {
+            return destination.empty() ? new_temp() : destination;
+        };
+        auto byte_offset = [&] (const std::string& base, const std::string& offset) {
+            auto address = result();
+            lines.push_back(fmt::format("{} = getelementptr inbounds i8, ptr {}, i64 {}", address, base, offset));
+            return address;
+        };
+        if(auto* local = bimple::downcast<bimple::local_ref>(reference)) {
+            return llvm_name(local->name);
+        } else if(auto* global = bimple::downcast<bimple::global_ref>(reference)) {
+            return fmt::format("@{}", global->name);
+        } else if(auto* ref = bimple::downcast<bimple::mem_ref>(reference)) {
+            auto base = generate_atom(ref->base);
+            auto* offset = bimple::downcast<bimple::integer_constant>(ref->offset);
+            if(offset && offset->value == 0) {
+                return base;
+            }
+            return byte_offset(base, generate_atom(ref->offset));
+        } else if(auto* ref = bimple::downcast<bimple::component_ref>(reference)) {
+            auto base = generate_address(ref->base, lines);
+            const auto& record_type = ref->base->type;
+            auto* record = VERIFY(bimple::as_record(*record_type));
+            VERIFY(ref->field < record->fields.size(), ref->field, record->fields.size());
+            std::size_t offset = record->fields[ref->field].offset;
+            if(record_type->tag == bimple::type_tag::struct_type) {
+                int index = struct_layout(*record, nullptr)[ref->field];
+                if(index >= 0) {
+                    auto address = result();
+                    lines.push_back(
+                        fmt::format(
+                            "{} = getelementptr inbounds {}, ptr {}, i64 0, i32 {}",
+                            address,
+                            generate_type(record_type),
+                            base,
+                            index
+                        )
+                    );
+                    return address;
+                }
+            }
+            if(offset == 0) {
+                return base;
+            }
+            return byte_offset(base, std::to_string(offset));
+        } else if(auto* ref = bimple::downcast<bimple::array_ref>(reference)) {
+            auto base = generate_address(ref->base, lines);
+            auto index = generate_atom(ref->index);
+            // getelementptr indices are signed, narrower unsigned ones are zero extended first
+            auto* index_type = VERIFY(bimple::downcast<bimple::integer>(ref->index->type));
+            auto* constant = bimple::downcast<bimple::integer_constant>(ref->index);
+            if(index_type->bits < 64 && !(constant && constant->value >= 0)) {
+                auto extended = new_temp();
+                lines.push_back(
+                    fmt::format(
+                        "{} = {} {} {} to i64",
+                        extended,
+                        index_type->is_unsigned ? "zext" : "sext",
+                        generate_type(ref->index->type),
+                        index
+                    )
+                );
+                index = extended;
+            }
+            auto address = result();
+            lines.push_back(
+                fmt::format(
+                    "{} = getelementptr inbounds {}, ptr {}, i64 0, i64 {}",
+                    address,
+                    generate_type(ref->base->type),
+                    base,
+                    index
+                )
+            );
+            return address;
+        } else {
+            VERIFY(false, "Not a memory reference", reference->tag);
+            __builtin_unreachable();
+        }
+    }
+
     const char* nsw(const std::unique_ptr<bimple::type>& type) {
         return VERIFY(bimple::downcast<bimple::integer>(type))->is_unsigned ? "" : " nsw";
     }
@@ -345,15 +526,28 @@ public:
         auto rhs1 = generate_atom(assignment->rhs1);
         auto rhs2 = generate_atom(assignment->rhs2);
         return fmt::format(
-            "{} = {} {} {}, {}",
+            "{} = {}{} {} {}, {}",
             lhs,
             generate_llvm_op(assignment->op, assignment->rhs1->type),
+            fast_math_flags(assignment->flags),
             generate_type(assignment->rhs1->type),
             rhs1,
             rhs2
         );
     }
 
+    // " reassoc nsz ..." after the opcode, nothing without flags
+    static std::string fast_math_flags(bimple::fp_flags flags) {
+        return flags == bimple::fp_flags::none ? "" : " " + bimple::to_string(flags);
+    }
+
+    static std::string compare_instruction(const bimple::binary_assignment* assignment) {
+        if(assignment->rhs1->type->tag == bimple::type_tag::integer) {
+            return "icmp";
+        }
+        return "fcmp" + fast_math_flags(assignment->flags);
+    }
+
     std::string generate_boolean_assignment(const bimple::binary_assignment* assignment) {
         ASSERT(*assignment->rhs1->type == *assignment->rhs2->type);
         ASSERT(assignment->rhs1->type->tag == bimple::type_tag::integer || assignment->rhs1->type->tag == bimple::type_tag::real);
@@ -369,7 +563,7 @@ public:
                     fmt::format(
                         "{} = {} {} {} {}, {}",
                         tmp,
-                        assignment->rhs1->type->tag == bimple::type_tag::integer ? "icmp" : "fcmp",
+                        compare_instruction(assignment),
                         generate_llvm_boolean_op(assignment->op, assignment->rhs1->type),
                         generate_type(assignment->rhs2->type),
                         rhs1,
@@ -392,7 +586,7 @@ public:
             return fmt::format(
                 "{} = {} {} {} {}, {}",
                 lhs,
-                assignment->rhs1->type->tag == bimple::type_tag::integer ? "icmp" : "fcmp",
+                compare_instruction(assignment),
                 generate_llvm_boolean_op(assignment->op, assignment->rhs1->type),
                 generate_type(assignment->rhs2->type),
                 rhs1,
@@ -553,71 +747,404 @@ public:
     }
 
     std::string generate_statement(const std::unique_ptr<bimple::statement>& statement) {
-        if(auto* ptr = bimple::downcast<bimple::unary_assignment>(statement)) {
-            return generate_unary_assignment(ptr);
-        } else if(auto* ptr = bimple::downcast<bimple::binary_assignment>(statement)) {
-            return generate_binary_assignment(ptr);
-        } else if(auto* ptr = bimple::downcast<bimple::cond>(statement)) {
-            return generate_cond(ptr);
-        } else if(auto* ptr = bimple::downcast<bimple::function_return>(statement)) {
-            if(ptr->value) {
-                return fmt::format(
-                    "ret {} {}",
-                    generate_type(ptr->value->type),
-                    llvm_name(ptr->value->name)
-                );
-            } else {
-                return "ret void";
+        return bimple::visit(statement, [this] (const auto& s) -> std::string {
+            using T = std::remove_cvref_t<decltype(s)>;
+            if constexpr(std::is_same_v<T, bimple::unary_assignment>) {
+                return generate_unary_assignment(&s);
+            } else if constexpr(std::is_same_v<T, bimple::binary_assignment>) {
+                return generate_binary_assignment(&s);
+            } else if constexpr(std::is_same_v<T, bimple::cond>) {
+                return generate_cond(&s);
+            } else if constexpr(std::is_same_v<T, bimple::function_return>) {
+                if(s.value) {
+                    return fmt::format(
+                        "ret {} {}",
+                        generate_type(s.value->type),
+                        generate_atom(s.value)
+                    );
+                } else {
+                    return "ret void";
+                }
+            } else if constexpr(std::is_same_v<T, bimple::call>) {
+                return generate_call(s);
+            } else if constexpr(std::is_same_v<T, bimple::intrinsic_call>) {
+                return generate_intrinsic(s.id, s.lhs, s.args, s.flags);
+            } else if constexpr(std::is_same_v<T, bimple::switch_branch>) {
+                VERIFY(false, "A switch is emitted as its block's terminator");
+                __builtin_unreachable();
             }
-        } else if(auto* ptr = bimple::downcast<bimple::call>(statement)) {
-            // FIXME libassert issue due to a pragma when this was inlined...?
-            auto* fnptr = VERIFY(bimple::downcast<bimple::pointer>(ptr->fn->type));
-            return fmt::format(
-                "{} = call noundef {} {}({})",
-                generate_atom(ptr->lhs),
-                generate_type(
-                    VERIFY(
-                        bimple::downcast<bimple::function_type>(
-                            fnptr->target_type
+        });
+    }
+
+    std::string generate_call(const bimple::call& call) {
+        // FIXME libassert issue due to a pragma when this was inlined...?
+        auto* fnptr = VERIFY(bimple::downcast<bimple::pointer>(call.fn->type));
+        const auto& return_type = VERIFY(bimple::downcast<bimple::function_type>(fnptr->target_type))->return_type;
+        bool returns_void = return_type->tag == bimple::type_tag::void_type;
+        VERIFY(!(call.lhs && returns_void), "Void call with a result");
+        return fmt::format(
+            "{}call {}{} {}({})",
+            call.lhs ? generate_atom(call.lhs) + " = " : "",
+            returns_void ? "" : "noundef ",
+            generate_type(return_type),
+            generate_atom(call.fn),
+            format_list(
+                call.args,
+                [this] (const std::unique_ptr<bimple::atom>& arg) {
+                    return fmt::format("{} noundef {}", generate_type(arg->type), generate_atom(arg));
+                }
+            )
+        );
+    }
+
+    std::string generate_declaration(const bimple::call& call) {
+        if(call.fn->tag != bimple::atom_tag::addr_expr) {
+            return "";
+        }
+        auto* fnptr = VERIFY(bimple::downcast<bimple::pointer>(call.fn->type));
+        const auto& return_type = VERIFY(bimple::downcast<bimple::function_type>(fnptr->target_type))->return_type;
+        // parameters as the call passes them, the way generate_call spells the call's function type
+        return fmt::format(
+            "declare {} {}({})",
+            generate_type(return_type),
+            generate_atom(call.fn),
+            format_list(
+                call.args,
+                [this] (const std::unique_ptr<bimple::atom>& arg) {
+                    return generate_type(arg->type);
+                }
+            )
+        );
+    }
+
+    void declare(std::string declaration) {
+        declarations.insert(std::move(declaration));
+    }
+
+    // result of a bit counting intrinsic, computed in the value's width, as an integer of the destination's width, or
+    // bswap's operand in its result's width. Counts are never negative and bswap's operand is unsigned, so widening is a
+    // zext.
+    std::string resize_integer(const std::string& destination, const std::string& value, const std::unique_ptr<bimple::type>& from, const std::unique_ptr<bimple::type>& to) {
+        auto from_bits = VERIFY(bimple::downcast<bimple::integer>(from))->bits;
+        auto to_bits = VERIFY(bimple::downcast<bimple::integer>(to))->bits;
+        ASSERT(from_bits != to_bits);
+        return fmt::format(
+            "{} = {} {} {} to {}",
+            destination,
+            to_bits < from_bits ? "trunc" : "zext",
+            generate_type(from),
+            value,
+            generate_type(to)
+        );
+    }
+
+    std::string generate_intrinsic(
+        bimple::intrinsics id,
+        const std::unique_ptr<bimple::atom>& lhs,
+        const std::vector<std::unique_ptr<bimple::atom>>& args,
+        bimple::fp_flags flags
+    ) {
+        using enum bimple::intrinsics;
+        auto arg = [&] (std::size_t i) -> const std::unique_ptr<bimple::atom>& {
+            VERIFY(i < args.size(), "Missing intrinsic operand", id, i);
+            return args[i];
+        };
+        auto typed = [this] (const std::unique_ptr<bimple::atom>& a) {
+            return fmt::format("{} {}", generate_type(a->type), generate_atom(a));
+        };
+        // results nobody reads still need a name
+        auto result = [&] {
+            return lhs ? generate_atom(lhs) : new_temp();
+        };
+        switch(id) {
+            case memcpy:
+            case memmove:
+                {
+                    auto size_type = generate_type(arg(2)->type);
+                    auto name = fmt::format("llvm.{}.p0.p0.{}", id == memcpy ? "memcpy" : "memmove", size_type);
+                    declare(fmt::format("declare void @{}(ptr, ptr, {}, i1)", name, size_type));
+                    return fmt::format(
+                        "call void @{}(ptr {}, ptr {}, {}, i1 false)",
+                        name,
+                        generate_atom(arg(0)),
+                        generate_atom(arg(1)),
+                        typed(arg(2))
+                    );
+                }
+            case memset:
+                {
+                    auto size_type = generate_type(arg(2)->type);
+                    auto name = fmt::format("llvm.memset.p0.{}", size_type);
+                    declare(fmt::format("declare void @{}(ptr, i8, {}, i1)", name, size_type));
+                    // memset takes the byte as an int
+                    std::vector<std::string> lines;
+                    auto byte = generate_atom(arg(1));
+                    if(VERIFY(bimple::downcast<bimple::integer>(arg(1)->type))->bits != 8) {
+                        byte = new_temp();
+                        lines.push_back(fmt::format("{} = trunc {} to i8", byte, typed(arg(1))));
+                    }
+                    lines.push_back(
+                        fmt::format(
+                            "call void @{}(ptr {}, i8 {}, {}, i1 false)",
+                            name,
+                            generate_atom(arg(0)),
+                            byte,
+                            typed(arg(2))
                         )
-                    )->return_type
-                ),
-                generate_atom(ptr->fn),
-                format_list(
-                    ptr->args,
-                    [this] (const std::unique_ptr<bimple::atom>& arg) {
-                        return fmt::format("{} noundef {}", generate_type(arg->type), generate_atom(arg));
+                    );
+                    return join(lines, '\n');
+                }
+            case popcount:
+            case ctz:
+            case clz:
+            case bswap:
+                {
+                    const auto& value = arg(0);
+                    auto width = [] (const std::unique_ptr<bimple::type>& t) {
+                        return VERIFY(bimple::downcast<bimple::integer>(t))->bits;
+                    };
+                    std::vector<std::string> lines;
+                    // gcc can pass bswap a promoted operand, e.g. __builtin_bswap16 an int, the bytes are swapped in
+                    // the result's width
+                    const auto& operand_type = id == bswap && lhs ? lhs->type : value->type;
+                    auto operand = generate_atom(value);
+                    if(width(operand_type) != width(value->type)) {
+                        operand = new_temp();
+                        lines.push_back(resize_integer(operand, generate_atom(value), value->type, operand_type));
                     }
-                )
-            );
-        } else {
-            VERIFY(false, "Unhandled statement", statement->tag);
-            __builtin_unreachable();
+                    auto type = generate_type(operand_type);
+                    auto name = fmt::format(
+                        "llvm.{}.{}",
+                        id == popcount ? "ctpop" : id == ctz ? "cttz" : id == clz ? "ctlz" : "bswap",
+                        type
+                    );
+                    bool counts_zeros = id == ctz || id == clz;
+                    // gcc's builtins leave the result for zero undefined, its internal functions may pass one
+                    bool result_for_zero = counts_zeros && args.size() > 1;
+                    declare(fmt::format("declare {0} @{1}({0}{2})", type, name, counts_zeros ? ", i1" : ""));
+                    bool same_width = lhs && width(lhs->type) == width(operand_type);
+                    bool direct = same_width && !result_for_zero;
+                    auto count = direct ? generate_atom(lhs) : new_temp();
+                    lines.push_back(
+                        fmt::format(
+                            "{} = call {} @{}({} {}{})",
+                            count,
+                            type,
+                            name,
+                            type,
+                            operand,
+                            counts_zeros ? (result_for_zero ? ", i1 false" : ", i1 true") : ""
+                        )
+                    );
+                    if(!lhs || direct) {
+                        return join(lines, '\n');
+                    }
+                    if(!result_for_zero) {
+                        lines.push_back(resize_integer(generate_atom(lhs), count, operand_type, lhs->type));
+                        return join(lines, '\n');
+                    }
+                    auto resized = count;
+                    if(!same_width) {
+                        resized = new_temp();
+                        lines.push_back(resize_integer(resized, count, operand_type, lhs->type));
+                    }
+                    auto is_zero = new_temp();
+                    lines.push_back(fmt::format("{} = icmp eq {}, 0", is_zero, typed(value)));
+                    lines.push_back(
+                        fmt::format(
+                            "{0} = select i1 {1}, {2} {3}, {2} {4}",
+                            generate_atom(lhs),
+                            is_zero,
+                            generate_type(lhs->type),
+                            generate_atom(arg(1)),
+                            resized
+                        )
+                    );
+                    return join(lines, '\n');
+                }
+            case prefetch:
+                {
+                    declare("declare void @llvm.prefetch.p0(ptr, i32, i32, i32)");
+                    // rw and locality default to a read with maximal locality, the last operand selects the data cache
+                    return fmt::format(
+                        "call void @llvm.prefetch.p0(ptr {}, i32 {}, i32 {}, i32 1)",
+                        generate_atom(arg(0)),
+                        args.size() > 1 ? generate_atom(arg(1)) : "0",
+                        args.size() > 2 ? generate_atom(arg(2)) : "3"
+                    );
+                }
+            case expect:
+                {
+                    auto type = generate_type(arg(0)->type);
+                    if(args.size() > 2) {
+                        VERIFY(bimple::downcast<bimple::real>(arg(2)->type), "expect's probability isn't a real");
+                        auto name = fmt::format("llvm.expect.with.probability.{}", type);
+                        declare(fmt::format("declare {0} @{1}({0}, {0}, double)", type, name));
+                        return fmt::format(
+                            "{} = call {} @{}({}, {}, {})",
+                            result(),
+                            type,
+                            name,
+                            typed(arg(0)),
+                            typed(arg(1)),
+                            typed(arg(2))
+                        );
+                    }
+                    auto name = fmt::format("llvm.expect.{}", type);
+                    declare(fmt::format("declare {0} @{1}({0}, {0})", type, name));
+                    return fmt::format("{} = call {} @{}({}, {})", result(), type, name, typed(arg(0)), typed(arg(1)));
+                }
+            case assume_aligned:
+                {
+                    VERIFY(!lhs, "assume_aligned has no result");
+                    declare("declare void @llvm.assume(i1 noundef)");
+                    return fmt::format(
+                        "call void @llvm.assume(i1 true) [ \"align\"(ptr {}, {}{}) ]",
+                        generate_atom(arg(0)),
+                        typed(arg(1)),
+                        args.size() > 2 ? ", " + typed(arg(2)) : ""
+                    );
+                }
+            case lifetime_start:
+            case lifetime_end:
+                {
+                    const auto& object = arg(0);
+                    auto name = id == lifetime_start ? "llvm.lifetime.start.p0" : "llvm.lifetime.end.p0";
+                    declare(fmt::format("declare void @{}(i64 immarg, ptr nocapture)", name));
+                    std::vector<std::string> lines;
+                    auto address = generate_address(object, lines);
+                    lines.push_back(fmt::format("call void @{}(i64 {}, ptr {})", name, object->type->size, address));
+                    return join(lines, '\n');
+                }
+            case abs:
+                {
+                    auto type = generate_type(arg(0)->type);
+                    auto name = fmt::format("llvm.abs.{}", type);
+                    declare(fmt::format("declare {0} @{1}({0}, i1 immarg)", type, name));
+                    return fmt::format("{} = call {} @{}({}, i1 true)", result(), type, name, typed(arg(0)));
+                }
+            case sqrt:
+            case fabs:
+            case floor:
+            case ceil:
+            case trunc:
+            case round:
+            case rint:
+            case nearbyint:
+            case sin:
+            case cos:
+            case exp:
+            case exp2:
+            case log:
+            case log2:
+            case log10:
+            case pow:
+            case copysign:
+            case fmin:
+            case fmax:
+            case fma:
+                {
+                    const auto& type = arg(0)->type;
+                    auto llvm_type = generate_type(type);
+                    // overloaded on the floating point type, f32 for float and so on
+                    auto name = fmt::format(
+                        "llvm.{}.f{}",
+                        id == fmin ? "minnum" : id == fmax ? "maxnum" : bimple::to_string(id),
+                        VERIFY(bimple::downcast<bimple::real>(type))->bits
+                    );
+                    std::vector<std::string> parameters(args.size(), llvm_type);
+                    declare(fmt::format("declare {} @{}({})", llvm_type, name, fmt::join(parameters, ", ")));
+                    std::vector<std::string> operands;
+                    for(std::size_t i = 0; i < args.size(); i++) {
+                        operands.push_back(typed(arg(i)));
+                    }
+                    return fmt::format(
+                        "{} = call{} {} @{}({})",
+                        result(),
+                        fast_math_flags(flags),
+                        llvm_type,
+                        name,
+                        fmt::join(operands, ", ")
+                    );
+                }
+            default:
+                VERIFY(false, "Unhandled intrinsic", id);
+                __builtin_unreachable();
         }
     }
 
-    std::string generate_phi(const bimple::phi& phi) {
+    std::string generate_phi(const bimple::phi& phi, int block) {
+        std::vector<std::string> incoming;
+        for(const auto& [src, value] : phi.values) {
+            ASSERT(*phi.result.type == *value->type);
+            // llvm wants an entry for every edge, a switch has one per case value going to the block
+            auto edges = switch_edges.find({src, block});
+            std::size_t count = edges == switch_edges.end() ? 1 : edges->second;
+            for(std::size_t i = 0; i < count; i++) {
+                incoming.push_back(fmt::format("[ {}, %{} ]", generate_atom(value), llvm_bb(src)));
+            }
+        }
         return fmt::format(
             "{} = phi {} {}",
             llvm_name(phi.result.name),
             generate_type(phi.result.type),
-            format_list(
-                phi.values,
-                [this, &phi] (const std::pair<int, bimple::variable>& pair) {
-                    const auto& [src, var] = pair;
-                    ASSERT(*phi.result.type == *var.type);
-                    return fmt::format(
-                        "[ {}, %{} ]",
-                        llvm_name(var.name),
-                        llvm_bb(src)
-                    );
+            fmt::join(incoming, ", ")
+        );
+    }
+
+    // the number of edges from each block ending in a switch to each of its successors
+    void count_switch_edges(const bimple::function& fn) {
+        switch_edges.clear();
+        for(const auto& bb : fn.basic_blocks) {
+            if(bb.statements.empty()) {
+                continue;
+            }
+            if(auto* branch = bimple::downcast<bimple::switch_branch>(bb.statements.back())) {
+                auto bits = VERIFY(bimple::downcast<bimple::integer>(branch->index->type))->bits;
+                switch_edges[{bb.index, bb.successors[0]}]++;
+                for(const auto& c : branch->cases) {
+                    switch_edges[{bb.index, bb.successors[c.successor]}] += case_values(c, bits).size();
                 }
-            )
+            }
+        }
+    }
+
+    // the values a case covers in the index's width, llvm reads them as either signed or unsigned
+    static std::vector<std::uint64_t> case_values(const bimple::switch_case& c, unsigned bits) {
+        std::uint64_t mask = bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+        std::uint64_t count = ((std::uint64_t(c.high) - std::uint64_t(c.low)) & mask) + 1;
+        std::vector<std::uint64_t> values;
+        for(std::uint64_t i = 0; i < count; i++) {
+            values.push_back((std::uint64_t(c.low) + i) & mask);
+        }
+        return values;
+    }
+
+    std::string generate_switch(const bimple::switch_branch& branch, const bimple::basic_block& bb) {
+        auto bits = VERIFY(bimple::downcast<bimple::integer>(branch.index->type))->bits;
+        auto type = generate_type(branch.index->type);
+        std::string code = fmt::format(
+            "switch {} {}, label %{} [\n",
+            type,
+            generate_atom(branch.index),
+            llvm_bb(bb.successors[0])
         );
+        for(const auto& c : branch.cases) {
+            VERIFY(c.successor < bb.successors.size(), bb.index, c.successor);
+            for(auto value : case_values(c, bits)) {
+                code += fmt::format("    {} {}, label %{}\n", type, value, llvm_bb(bb.successors[c.successor]));
+            }
+        }
+        return code + "]";
     }
 
     std::string generate_terminator(const bimple::basic_block& bb) {
-        if(bb.successors.size() == 1) {
+        if(!bb.statements.empty() && bb.statements.back()->tag == bimple::statement_tag::function_return) {
+            // the return is the terminator
+            return "";
+        } else if(!bb.statements.empty() && bb.statements.back()->tag == bimple::statement_tag::switch_branch) {
+            return generate_switch(*bimple::downcast<bimple::switch_branch>(bb.statements.back()), bb);
+        } else if(bb.successors.size() == 1) {
             // Assuming fallthrough TODO
             return fmt::format("br label %{}", llvm_bb(bb.successors[0]));
         } else if(bb.successors.size() == 2) {
@@ -630,40 +1157,244 @@ public:
                 llvm_bb(bb.successors[1])
             );
         } else {
-            VERIFY(false, bb.index, bb.successors.size());
-            __builtin_unreachable();
+            // no successors and no return, e.g. after a noreturn call or the exit block when passes are disabled
+            VERIFY(bb.successors.empty(), bb.index, bb.successors.size());
+            return "unreachable";
+        }
+    }
+
+    // the order blocks are emitted in, the entry block is always first and every block is emitted once
+    std::vector<int> block_order(const bimple::function& fn) {
+        std::size_t n = fn.basic_blocks.size();
+        std::vector<int> order;
+        order.reserve(n);
+        std::vector<bool> placed(n, false);
+        auto place = [&](int index) {
+            placed[index] = true;
+            order.push_back(index);
+        };
+        auto place_rest = [&] {
+            for(const auto& bb : fn.basic_blocks) {
+                if(!placed[bb.index]) {
+                    place(bb.index);
+                }
+            }
+        };
+        if(layout == block_layout::none || n == 0) {
+            place_rest();
+            return order;
+        }
+        const auto& rpo = fn.topological;
+        ASSERT(rpo.empty() || rpo.front() == 0);
+        place(0);
+        for(int index : rpo) {
+            if(!placed[index]) {
+                place(index);
+            }
         }
+        place_rest();
+        return order;
     }
 
-    // std::vector<int> topological_sort(const std::vector<bimple::basic_block>& bbs) {
-    //     std::vector<int> order;
-    //     std::vector<bool> visited(bbs.size(), false);
-    //     // dfs
-    //     for(const auto& bb : bbs) {
-    //         ASSERT(bb.index == &bb - &bbs.front());
-    //         if(!visited[bb.index]) {
-    //             std::stack<int> stack;
-    //             stack.push(bb.index);
-    //             while(!stack.empty()) {
-    //                 auto node = stack.top();
-    //                 // fmt::print("node {} : {}\n", order);
-    //                 stack.pop();
-    //                 if(!visited[node]) {
-    //                     order.push_back(node);
-    //                     visited[node] = true;
-    //                     for(const auto& tgt : bbs[node].successors) {
-    //                         stack.push(tgt);
-    //                     }
-    //                 }
-    //             }
-    //         }
-    //     }
-    //     // std::reverse(order.begin(), order.end());
-    //     // fmt::print("->->->->->->->-> {}\n", order);
-    //     return order;
-    // }
+    // elements and fields as {type, value} pairs, spelled out as a packed struct
+    static std::pair<std::string, std::string> packed_constant(const std::vector<std::pair<std::string, std::string>>& parts) {
+        std::vector<std::string> types, values;
+        for(const auto& [type, value] : parts) {
+            types.push_back(type);
+            values.push_back(fmt::format("{} {}", type, value));
+        }
+        return {fmt::format("<{{ {} }}>", fmt::join(types, ", ")), fmt::format("<{{ {} }}>", fmt::join(values, ", "))};
+    }
+
+    // llvm type and value of an initializer. Aggregates whose elements' types differ from the declared ones (a union
+    // holds the member it was initialized through) or that have long runs of zeros are emitted as packed structs with
+    // the same layout, memory accesses don't depend on the type a global was defined with.
+    std::pair<std::string, std::string> generate_constant(
+        const bimple::initializer& value,
+        const std::unique_ptr<bimple::type>& type
+    ) {
+        // runs of zero elements at least this long become one zeroinitializer
+        constexpr std::size_t zero_run = 16;
+        switch(value.kind) {
+            case bimple::initializer_kind::zero:
+                return {generate_type(type), "zeroinitializer"};
+            case bimple::initializer_kind::integer:
+                if(type->tag == bimple::type_tag::pointer) {
+                    return {"ptr", value.integer == 0 ? "null" : fmt::format("inttoptr (i64 {} to ptr)", value.integer)};
+                }
+                return {generate_type(type), std::to_string(value.integer)};
+            case bimple::initializer_kind::real:
+                return {generate_type(type), value.text};
+            case bimple::initializer_kind::string:
+                {
+                    auto* a = VERIFY(bimple::downcast<bimple::array>(type));
+                    // the literal may be shorter than the array, or longer when it has no room for the terminator
+                    auto bytes = value.text;
+                    bytes.resize(a->count, '\0');
+                    std::string escaped;
+                    for(unsigned char c : bytes) {
+                        if(c >= 0x20 && c < 0x7f && c != '"' && c != '\\') {
+                            escaped += char(c);
+                        } else {
+                            escaped += fmt::format("\\{:02X}", c);
+                        }
+                    }
+                    return {generate_type(type), fmt::format("c\"{}\"", escaped)};
+                }
+            case bimple::initializer_kind::address:
+                if(value.integer == 0) {
+                    return {"ptr", fmt::format("@{}", value.text)};
+                }
+                return {"ptr", fmt::format("getelementptr inbounds (i8, ptr @{}, i64 {})", value.text, value.integer)};
+            case bimple::initializer_kind::aggregate:
+                if(auto* a = bimple::downcast<bimple::array>(type)) {
+                    std::vector<const bimple::initializer*> elements(a->count, nullptr);
+                    for(std::size_t j = 0; j < value.elements.size(); j++) {
+                        VERIFY(value.indices[j] < a->count, value.indices[j], a->count);
+                        elements[value.indices[j]] = &value.elements[j];
+                    }
+                    auto element_type = generate_type(a->element_type);
+                    std::vector<std::pair<std::string, std::string>> parts;
+                    bool uniform = true;
+                    for(std::size_t i = 0; i < elements.size(); i++) {
+                        if(!elements[i]) {
+                            std::size_t end = i;
+                            while(end < elements.size() && !elements[end]) {
+                                end++;
+                            }
+                            if(end - i >= zero_run) {
+                                parts.push_back({fmt::format("[{} x {}]", end - i, element_type), "zeroinitializer"});
+                                uniform = false;
+                                i = end - 1;
+                                continue;
+                            }
+                        }
+                        parts.push_back(
+                            elements[i] ? generate_constant(*elements[i], a->element_type)
+                                        : std::pair{element_type, "zeroinitializer"s}
+                        );
+                        uniform = uniform && parts.back().first == element_type;
+                    }
+                    if(!uniform) {
+                        return packed_constant(parts);
+                    }
+                    std::vector<std::string> values;
+                    for(const auto& [element, part] : parts) {
+                        values.push_back(fmt::format("{} {}", element, part));
+                    }
+                    return {generate_type(type), fmt::format("[{}]", fmt::join(values, ", "))};
+                } else {
+                    // fields that aren't initialized are zero padding, a union has one field initialized
+                    auto* record = VERIFY(bimple::as_record(*type));
+                    std::vector<const bimple::initializer*> fields(record->fields.size(), nullptr);
+                    for(std::size_t j = 0; j < value.elements.size(); j++) {
+                        VERIFY(value.indices[j] < fields.size(), value.indices[j], fields.size());
+                        fields[value.indices[j]] = &value.elements[j];
+                    }
+                    std::vector<std::pair<std::string, std::string>> parts;
+                    std::size_t position = 0;
+                    auto pad = [&] (std::size_t to) {
+                        if(to > position) {
+                            parts.push_back({fmt::format("[{} x i8]", to - position), "zeroinitializer"});
+                            position = to;
+                        }
+                    };
+                    for(std::size_t j = 0; j < fields.size(); j++) {
+                        if(!fields[j]) {
+                            continue;
+                        }
+                        const auto& f = record->fields[j];
+                        VERIFY(f.offset >= position, "Initialized fields overlap", record->name, f.name);
+                        pad(f.offset);
+                        parts.push_back(generate_constant(*fields[j], f.type));
+                        position += f.type->size;
+                    }
+                    pad(record->size);
+                    return packed_constant(parts);
+                }
+            default:
+                VERIFY(false, "Unhandled initializer", value.kind);
+                __builtin_unreachable();
+        }
+    }
+
+    std::string generate_global(const bimple::global& g) {
+        std::string attributes;
+        if(!g.section.empty()) {
+            attributes += fmt::format(", section \"{}\"", g.section);
+        }
+        if(g.align) {
+            attributes += fmt::format(", align {}", g.align);
+        }
+        auto kind = g.is_constant ? "constant" : "global";
+        // global-dynamic is llvm's default model
+        std::string_view thread_local_model;
+        switch(g.tls_model) {
+            case bimple::tls_models::none: thread_local_model = ""; break;
+            case bimple::tls_models::global_dynamic: thread_local_model = "thread_local "; break;
+            case bimple::tls_models::local_dynamic: thread_local_model = "thread_local(localdynamic) "; break;
+            case bimple::tls_models::initial_exec: thread_local_model = "thread_local(initialexec) "; break;
+            case bimple::tls_models::local_exec: thread_local_model = "thread_local(localexec) "; break;
+        }
+        if(!g.value) {
+            return fmt::format(
+                "@{} = external {}{} {}{}",
+                g.name,
+                thread_local_model,
+                kind,
+                generate_type(g.type),
+                attributes
+            );
+        }
+        std::string_view linkage;
+        switch(g.linkage) {
+            case bimple::linkages::external: linkage = ""; break;
+            case bimple::linkages::internal: linkage = "internal "; break;
+            case bimple::linkages::weak: linkage = "weak "; break;
+            case bimple::linkages::common: linkage = "common "; break;
+        }
+        auto [type, value] = generate_constant(*g.value, g.type);
+        return fmt::format(
+            "@{} = {}{}{}{} {} {}{}",
+            g.name,
+            linkage,
+            thread_local_model,
+            g.unnamed_addr ? "unnamed_addr " : "",
+            kind,
+            type,
+            value,
+            attributes
+        );
+    }
+
+    std::string generate_allocas(const std::vector<bimple::local>& locals) {
+        std::string code;
+        for(const auto& l : locals) {
+            code += indent(
+                fmt::format("{} = alloca {}, align {}", llvm_name(l.name), generate_type(l.type), l.align),
+                4,
+                ' '
+            ) + "\n";
+        }
+        return code;
+    }
+
+    // the entry block's invariant addresses go after its allocas
+    std::string with_entry_lines(std::string&& code, std::size_t position) {
+        std::string lines;
+        for(const auto& line : entry_lines) {
+            lines += indent(line, 4, ' ') + "\n";
+        }
+        code.insert(position, lines);
+        return std::move(code);
+    }
 
     std::string generate(const bimple::function& fn) {
+        declarations.clear();
+        entry_lines.clear();
+        invariant_addresses.clear();
+        count_switch_edges(fn);
+        std::size_t entry_position = 0;
         std::string code;
         code += fmt::format("define noundef {} @{}(", generate_type(fn.return_type), fn.identifier);
         // generate function arguments
@@ -674,25 +1405,44 @@ public:
         }
         code += fmt::format(") {{\n");
         // function body
-        // for(const auto& index : topological_sort(fn.basic_blocks)) {
-        // for(const auto& index : fn.topological) {
-        for(const auto& bb : fn.basic_blocks) {
-            if(bb.index == 1) continue; // TODO
+        for(int index : block_order(fn)) {
+            const auto& bb = fn.basic_blocks[index];
             code += fmt::format("{}:\n", llvm_bb(bb.index));
+            if(bb.index == 0) {
+                code += generate_allocas(fn.locals);
+                entry_position = code.size();
+            }
             for(const auto& phi : bb.phis) {
-                code += indent(generate_phi(phi), 4, ' ') + "\n";
+                code += indent(generate_phi(phi, bb.index), 4, ' ') + "\n";
             }
             for(const auto& statement : bb.statements) {
+                // a switch is the block's terminator
+                if(statement->tag == bimple::statement_tag::switch_branch) {
+                    continue;
+                }
                 code += indent(generate_statement(statement), 4, ' ') + "\n";
             }
             // Handle terminator
-            if(bb.successors[0] == 1) continue; // TODO: Hacky
-            code += indent(generate_terminator(bb), 4, ' ') + "\n";
+            if(auto terminator = generate_terminator(bb); !terminator.empty()) {
+                code += indent(terminator, 4, ' ') + "\n";
+            }
         }
         code += fmt::format("}}\n");
-        return code;
+        return with_declarations(with_entry_lines(std::move(code), entry_position));
     }
+
 private:
+    std::string with_declarations(std::string&& code) {
+        if(declarations.empty()) {
+            return std::move(code);
+        }
+        std::string declared;
+        for(const auto& declaration : declarations) {
+            declared += declaration + "\n";
+        }
+        return declared + code;
+    }
+
     // Note: Including %
     std::string llvm_name(const std::string& bimple_name) {
         if(name_map.contains(bimple_name)) {
@@ -712,9 +1462,81 @@ private:
     }
 };
 
-llvm_codegen::llvm_codegen() : pimpl(std::make_unique<impl>()) {}
+std::optional<block_layout> parse_block_layout(std::string_view name) {
+    if(name == "none") {
+        return block_layout::none;
+    } else if(name == "rpo") {
+        return block_layout::reverse_postorder;
+    }
+    return std::nullopt;
+}
+
+llvm_codegen::llvm_codegen(block_layout layout) : pimpl(std::make_unique<impl>(layout)) {}
 llvm_codegen::~llvm_codegen() = default;
 
 std::string llvm_codegen::generate(const bimple::function& fn) {
     return pimpl->generate(fn);
 }
+
+std::string llvm_codegen::generate(const bimple::global& g) {
+    return pimpl->generate_global(g);
+}
+
+std::string llvm_codegen::generate_declaration(const bimple::call& call) {
+    return pimpl->generate_declaration(call);
+}
+
+std::string declaration_filter::operator()(std::string_view ir) {
+    std::string filtered;
+    filtered.reserve(ir.size());
+    while(!ir.empty()) {
+        auto end = ir.find('\n');
+        auto line = ir.substr(0, end == std::string_view::npos ? ir.size() : end + 1);
+        ir.remove_prefix(line.size());
+        if(line.starts_with("declare ") && !declared.insert(std::string(line)).second) {
+            continue;
+        }
+        filtered += line;
+    }
+    return filtered;
+}
+
+void global_table::add(const bimple::function& fn) {
+    llvm_codegen codegen;
+    for(const auto& g : fn.globals) {
+        auto [it, inserted] = indices.insert({g.name, entries.size()});
+        if(inserted) {
+            entries.push_back({codegen.generate(g), !g.value});
+        } else if(entries[it->second].is_declaration && g.value) {
+            entries[it->second] = {codegen.generate(g), false};
+        }
+    }
+    defined.insert(fn.identifier);
+    for(const auto& bb : fn.basic_blocks) {
+        for(const auto& statement : bb.statements) {
+            auto* call = bimple::downcast<bimple::call>(statement.get());
+            if(!call) {
+                continue;
+            }
+            if(auto declaration = codegen.generate_declaration(*call); !declaration.empty()) {
+                auto* callee = VERIFY(bimple::downcast<bimple::addr_expr>(call->fn));
+                if(callee_names.insert(callee->name).second) {
+                    callees.push_back({callee->name, std::move(declaration)});
+                }
+            }
+        }
+    }
+}
+
+std::string global_table::generate() const {
+    std::string code;
+    for(const auto& entry : entries) {
+        code += entry.ir + "\n";
+    }
+    for(const auto& [name, declaration] : callees) {
+        if(!defined.contains(name)) {
+            code += declaration + "\n";
+        }
+    }
+    return code;
+}
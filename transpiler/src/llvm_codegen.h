@@ -1,18 +1,72 @@
 #ifndef LLVM_CODEGEN
 #define LLVM_CODEGEN
 
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "bimple.h"
 
+// Bumped whenever the ir generated for the same bimple function changes, it keys the codegen cache
+constexpr std::uint32_t codegen_version = 1;
+
+// Order of the blocks in the emitted function, llvm's -O0 and -O1 pipelines mostly keep it
+enum class block_layout {
+    // gcc's block numbers
+    none,
+    // function::topological, which passes keep in reverse postorder
+    reverse_postorder
+};
+
+// "none" or "rpo"
+std::optional<block_layout> parse_block_layout(std::string_view name);
+
+// Functions that call intrinsics start with their declarations, and llvm rejects a module that declares a function
+// twice. Passing every function of a module through one filter drops the declarations it has already let through.
+class declaration_filter {
+    std::unordered_set<std::string> declared;
+public:
+    std::string operator()(std::string_view ir);
+};
+
+// The globals of a module, one per symbol. A function carries the globals it uses as gcc described them when it was
+// converted, so two functions can spell the same symbol differently, e.g. an extern declaration seen before the
+// definition or an array whose bound was completed later. A definition replaces an external declaration, otherwise the
+// first global added for a symbol is kept. The table also declares the functions the module calls but doesn't define,
+// which is only known once every function has been added.
+class global_table {
+    struct entry {
+        std::string ir;
+        bool is_declaration;
+    };
+    std::vector<entry> entries;
+    std::unordered_map<std::string, std::size_t> indices;
+    // symbol -> declaration, from the first direct call seen
+    std::vector<std::pair<std::string, std::string>> callees;
+    std::unordered_set<std::string> callee_names;
+    std::unordered_set<std::string> defined;
+public:
+    void add(const bimple::function& fn);
+    // every global once, in the order their symbols were first added, then the external functions
+    std::string generate() const;
+};
+
 class llvm_codegen {
     class impl;
     std::unique_ptr<impl> pimpl;
 public:
-    llvm_codegen();
+    explicit llvm_codegen(block_layout layout = block_layout::reverse_postorder);
     ~llvm_codegen();
+    // the function's globals aren't emitted with it, they go through a global_table
     std::string generate(const bimple::function& fn);
+    std::string generate(const bimple::global& g);
+    // declaration of a directly called function, empty for calls through a pointer
+    std::string generate_declaration(const bimple::call& call);
 };
 
 #endif
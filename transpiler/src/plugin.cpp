@@ -3,6 +3,7 @@
 #include <gcc-plugin.h>
 #include <tree-pass.h>
 #include <context.h>
+#include <timevar.h>
 #include <tree.h>
 #include <tree-cfg.h>
 #include <gimple.h>
@@ -17,16 +18,22 @@
 #include <tree-ssanames.h>
 #include <gimple-iterator.h>
 #include <gimple-pretty-print.h>
+#include <diagnostic-core.h>
 #include <plugin-version.h>
 
 #include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <memory>
 #include <new>
+#include <optional>
+#include <regex>
 #include <stack>
 #include <string_view>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -40,8 +47,14 @@
 
 #include "bs.h"
 #include "bimple.h"
+#include "bimple_passes.h"
+#include "bimple_serialization.h"
+#include "codegen_cache.h"
+#include "instrumentation.h"
 #include "utils.h"
 #include "simple_gimple_to_bimple_converter.h"
+#include "statistics.h"
+#include "thread_pool.h"
 #include "llvm_codegen.h"
 
 using namespace std::string_literals;
@@ -49,6 +62,279 @@ using namespace std::string_literals;
 // assertion for gcc
 int plugin_is_GPL_compatible;
 
+// configured through -fplugin-arg-<name>-<key>[=<value>]
+struct plugin_options {
+    // selection, a function is transpiled if it matches any configured selector (or no selectors are configured)
+    std::optional<std::regex> filter;
+    std::unordered_set<std::string> functions;
+    std::optional<std::string> marker;
+    // additionally require the function to be hot
+    bool only_hot = false;
+    // write converted bimple for wyrm-replay
+    std::optional<std::string> dump;
+    // append per-function stage timings as json lines
+    std::optional<std::string> timings;
+    // don't print gimple, bimple, and llvm ir to stdout
+    bool quiet = false;
+    // report functions that take longer than this to transpile
+    std::optional<std::chrono::nanoseconds> time_report_threshold;
+    // collect statistics, functions with unsupported nodes are skipped instead of aborting compilation
+    bool stats = false;
+    // append statistics as a json line instead of printing them to stderr
+    std::optional<std::string> stats_file;
+    // reuse llvm ir generated for identical functions in earlier compilations
+    std::optional<std::string> cache;
+    std::uintmax_t cache_size = std::uintmax_t(1024) << 20;
+    // number of codegen worker threads, codegen runs inline on gcc's thread if 0
+    unsigned jobs = 0;
+    // bimple passes run between conversion and codegen
+    bimple::pass_manager passes = bimple::pass_manager::default_pipeline();
+    // order of the blocks in the generated ir
+    block_layout layout = block_layout::reverse_postorder;
+
+    bool has_selectors() const {
+        return filter || !functions.empty() || marker;
+    }
+};
+
+static plugin_options options;
+static bimple::serializer dumped_functions;
+
+struct function_timings {
+    std::string name;
+    std::size_t blocks = 0;
+    std::size_t statements = 0;
+    std::size_t ir_bytes = 0;
+    instrumentation::stage_measurement gimple_to_bimple;
+    instrumentation::stage_measurement passes;
+    instrumentation::stage_measurement cache;
+    instrumentation::stage_measurement codegen;
+    instrumentation::stage_measurement output;
+};
+
+static std::vector<function_timings> unit_timings;
+static statistics unit_statistics;
+static std::optional<codegen_cache> ir_cache;
+
+// everything besides the bimple function that affects the generated ir, the same for every build of the same codegen
+static std::string codegen_fingerprint() {
+    return fmt::format(
+        "wyrm codegen {} bimple {} layout {}",
+        codegen_version,
+        bimple::serialization_version,
+        int(options.layout)
+    );
+}
+
+static std::string stage_json(const instrumentation::stage_measurement& stage) {
+    return fmt::format(
+        R"({{"ns": {}, "allocations": {}, "bytes": {}, "peak_bytes": {}}})",
+        stage.time.count(),
+        stage.allocations,
+        stage.bytes,
+        stage.peak_bytes
+    );
+}
+
+static void write_timings(const std::string& path) {
+    std::ofstream f(path, std::ios_base::app);
+    for(const auto& timings : unit_timings) {
+        f<<fmt::format(
+            R"({{"function": "{}", "blocks": {}, "statements": {}, "ir_bytes": {}, "stages": {{"gimple_to_bimple": {}, "passes": {}, "cache": {}, "codegen": {}, "output": {}}}}})",
+            timings.name,
+            timings.blocks,
+            timings.statements,
+            timings.ir_bytes,
+            stage_json(timings.gimple_to_bimple),
+            stage_json(timings.passes),
+            stage_json(timings.cache),
+            stage_json(timings.codegen),
+            stage_json(timings.output)
+        )<<"\n";
+    }
+    f<<fmt::format(
+        R"({{"unit": "{}", "functions": {}, "peak_rss": {}}})",
+        main_input_filename,
+        unit_timings.size(),
+        instrumentation::peak_rss()
+    )<<"\n";
+}
+
+// Measures a wyrm stage for the timings file and, when gcc is timing (-ftime-report), also reports it as a named client
+// item so it shows up separately instead of disappearing into "plugin execution"
+class stage_scope {
+    instrumentation::stage_timer timer;
+    bool pushed = false;
+public:
+    stage_scope(const char* name, instrumentation::stage_measurement& into) : timer(into) {
+        if(g_timer) {
+            g_timer->push_client_item(name);
+            pushed = true;
+        }
+    }
+    ~stage_scope() {
+        stop();
+    }
+    stage_scope(const stage_scope&) = delete;
+    stage_scope& operator=(const stage_scope&) = delete;
+    void stop() {
+        timer.stop();
+        if(pushed) {
+            g_timer->pop_client_item();
+            pushed = false;
+        }
+    }
+};
+
+static void report_slow_function(const function_timings& timings) {
+    auto total = timings.gimple_to_bimple.time
+        + timings.passes.time
+        + timings.cache.time
+        + timings.codegen.time
+        + timings.output.time;
+    if(total < *options.time_report_threshold) {
+        return;
+    }
+    auto ms = [](std::chrono::nanoseconds time) { return std::chrono::duration<double, std::milli>(time).count(); };
+    std::cerr<<fmt::format(
+        "wyrm: {} took {:.3f} ms ({} blocks, {} statements): gimple to bimple {:.3f} ms, passes {:.3f} ms, cache {:.3f} ms, "
+        "codegen {:.3f} ms, output {:.3f} ms\n",
+        timings.name,
+        ms(total),
+        timings.blocks,
+        timings.statements,
+        ms(timings.gimple_to_bimple.time),
+        ms(timings.passes.time),
+        ms(timings.cache.time),
+        ms(timings.codegen.time),
+        ms(timings.output.time)
+    );
+}
+
+// A converted function on its way through codegen and output. With a codegen pool the ir is generated on a worker
+// thread and the function is completed at the end of the unit, in the order gcc handed the functions to the pass.
+struct pending_function {
+    bimple::function function;
+    function_timings timings;
+    std::vector<std::byte> cache_key;
+    bool cached = false;
+    std::string ir;
+    std::future<void> codegen_done;
+};
+
+static std::optional<thread_pool> codegen_pool;
+static std::vector<std::unique_ptr<pending_function>> pending_functions;
+// x.ll holds one module per translation unit, its globals are written after the last function
+static declaration_filter module_declarations;
+static global_table module_globals;
+
+// everything after codegen, runs on gcc's thread
+static void complete_function(pending_function& pending) {
+    auto& timings = pending.timings;
+    if(!options.quiet) {
+        std::cout<<pending.ir;
+    }
+    if(ir_cache && !pending.cached) {
+        stage_scope cache_timer("wyrm: cache", timings.cache);
+        ir_cache->store(pending.cache_key, pending.ir);
+    }
+    stage_scope output_timer("wyrm: output", timings.output);
+    std::ofstream f("x.ll", std::ios_base::app);
+    f<<module_declarations(pending.ir);
+    f.close();
+    module_globals.add(pending.function);
+    output_timer.stop();
+    printf("TRANSPILED SUCCESSFULLY\n");
+
+    timings.blocks = pending.function.basic_blocks.size();
+    for(const auto& bb : pending.function.basic_blocks) {
+        timings.statements += bb.phis.size() + bb.statements.size();
+    }
+    timings.ir_bytes = pending.ir.size();
+    if(options.time_report_threshold) {
+        report_slow_function(timings);
+    }
+    if(options.stats) {
+        unit_statistics.add_function(pending.function, pending.ir.size());
+        unit_statistics.add_stage("gimple_to_bimple", timings.gimple_to_bimple);
+        unit_statistics.add_stage("passes", timings.passes);
+        unit_statistics.add_stage("cache", timings.cache);
+        unit_statistics.add_stage("codegen", timings.codegen);
+        unit_statistics.add_stage("output", timings.output);
+    }
+    if(options.timings) {
+        unit_timings.push_back(std::move(timings));
+    }
+    if(!options.quiet) {
+        printf("============================================\n");
+    }
+}
+
+static tree handle_wyrm_attribute(tree* node, tree name, tree, int, bool* no_add_attrs) {
+    if(TREE_CODE(*node) != FUNCTION_DECL) {
+        warning(OPT_Wattributes, "%qE attribute only applies to functions", name);
+        *no_add_attrs = true;
+    }
+    return NULL_TREE;
+}
+
+static tree handle_annotate_attribute(tree* node, tree name, tree args, int flags, bool* no_add_attrs) {
+    if(TREE_CODE(TREE_VALUE(args)) != STRING_CST) {
+        warning(OPT_Wattributes, "%qE attribute argument must be a string", name);
+        *no_add_attrs = true;
+        return NULL_TREE;
+    }
+    return handle_wyrm_attribute(node, name, args, flags, no_add_attrs);
+}
+
+// __attribute__((wyrm)) and clang-style __attribute__((annotate("wyrm")))
+static struct attribute_spec wyrm_attribute = {
+    "wyrm", 0, 0, true, false, false, false, handle_wyrm_attribute, NULL
+};
+static struct attribute_spec annotate_attribute = {
+    "annotate", 1, 1, true, false, false, false, handle_annotate_attribute, NULL
+};
+
+static void register_attributes(void*, void*) {
+    register_attribute(&wyrm_attribute);
+    register_attribute(&annotate_attribute);
+}
+
+static bool has_marker_attribute(tree decl, const std::string& marker) {
+    tree attrs = DECL_ATTRIBUTES(decl);
+    if(marker == "wyrm" && lookup_attribute("wyrm", attrs)) {
+        return true;
+    }
+    for(tree attr = lookup_attribute("annotate", attrs); attr; attr = lookup_attribute("annotate", TREE_CHAIN(attr))) {
+        tree value = TREE_VALUE(TREE_VALUE(attr));
+        if(TREE_STRING_POINTER(value) == marker) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool is_hot(function* fun) {
+    // the pass runs before profile estimation and before -fprofile-use counts are read, so neither the node frequency
+    // nor block counts say anything yet, only the attributes do
+    tree attrs = DECL_ATTRIBUTES(fun->decl);
+    return lookup_attribute("hot", attrs) && !lookup_attribute("cold", attrs);
+}
+
+static bool is_selected(function* fun) {
+    if(options.has_selectors()) {
+        const char* name = IDENTIFIER_POINTER(DECL_ASSEMBLER_NAME(fun->decl));
+        bool selected = options.functions.contains(name)
+            || options.functions.contains(get_name(fun->decl))
+            || (options.filter && std::regex_search(name, *options.filter))
+            || (options.marker && has_marker_attribute(fun->decl, *options.marker));
+        if(!selected) {
+            return false;
+        }
+    }
+    return !options.only_hot || is_hot(fun);
+}
+
 // learned how to create a pass from https://stackoverflow.com/questions/25626124/how-to-register-a-gimple-pass
 static const struct pass_data llvm_transpilation_pass_data = {
                 .type                   = GIMPLE_PASS,
@@ -56,7 +342,7 @@ static const struct pass_data llvm_transpilation_pass_data = {
                 .optinfo_flags          = OPTGROUP_NONE,
                 // .has_gate               = false,
                 // .has_execute            = true,
-                .tv_id                  = TV_NONE,
+                .tv_id                  = TV_PLUGIN_RUN,
                 .properties_required    = PROP_gimple_any,
                 .properties_provided    = 0,
                 .properties_destroyed   = 0,
@@ -67,45 +353,143 @@ static const struct pass_data llvm_transpilation_pass_data = {
 class llvm_transpilation_pass : public gimple_opt_pass {
 public:
     llvm_transpilation_pass(gcc::context* ctx) : gimple_opt_pass(llvm_transpilation_pass_data, ctx) {}
+    bool gate(function* fun) override {
+        return is_selected(fun);
+    }
     // put the function you want to execute when the pass is executed
     // unsigned int execute() {return 0;}
     unsigned int execute(function* fun) {
         ASSERT(!fun->static_chain_decl);
-        // std::vector<int> postorder(last_basic_block_for_fn(fun));
-        printf("============= Execute function =============\n");
-        print_current_pass(stdout);
-        printf("%s:\n", get_name(fun->decl));
-        // print_gimple_seq(stdout, fun->gimple_body, 4, TDF_ALL_VALUES);
-        // debug_gimple_seq(fun->gimple_body);
-        //debug_bb(fun->cfg->x_entry_block_ptr);
-        // printf("============= ================ =============\n");
-        // debug_function(fun->decl, TDF_ALL_VALUES);
-        // printf("============= ================ =============\n");
-        // custom_dump_function_to_file(fun->decl, stdout, TDF_ALL_VALUES);
-        dump_function_to_file(fun->decl, stdout, TDF_ALL_VALUES);
-        // int nof_blocks = post_order_compute(postorder.data(), true, true);
-        // for(int i = nof_blocks - 1; i >= 0; i--) {
-        //     basic_block gcc_bb = (*fun->cfg->x_basic_block_info)[postorder[i]];
-        //     //gccbb2bb[gcc_bb] = func->build_bb();
-        //     debug_bb(gcc_bb);
-        // }
-
-        printf("Converting:\n");
-
-        bimple::function function = simple_gimple_to_bimple_converter().generate_function(fun);
-        std::cout<<function.to_string(true)<<std::endl;
-        std::string x = llvm_codegen{}.generate(function);
-        std::cout<<x;
-        std::ofstream f("x.ll", std::ios_base::app);
-        f<<x;
-        f.close();
-        printf("TRANSPILED SUCCESSFULLY\n");
+        function_timings timings;
+        timings.name = IDENTIFIER_POINTER(DECL_ASSEMBLER_NAME(fun->decl));
+        if(!options.quiet) {
+            // std::vector<int> postorder(last_basic_block_for_fn(fun));
+            printf("============= Execute function =============\n");
+            print_current_pass(stdout);
+            printf("%s:\n", get_name(fun->decl));
+            // print_gimple_seq(stdout, fun->gimple_body, 4, TDF_ALL_VALUES);
+            // debug_gimple_seq(fun->gimple_body);
+            //debug_bb(fun->cfg->x_entry_block_ptr);
+            // printf("============= ================ =============\n");
+            // debug_function(fun->decl, TDF_ALL_VALUES);
+            // printf("============= ================ =============\n");
+            // custom_dump_function_to_file(fun->decl, stdout, TDF_ALL_VALUES);
+            dump_function_to_file(fun->decl, stdout, TDF_ALL_VALUES);
+            // int nof_blocks = post_order_compute(postorder.data(), true, true);
+            // for(int i = nof_blocks - 1; i >= 0; i--) {
+            //     basic_block gcc_bb = (*fun->cfg->x_basic_block_info)[postorder[i]];
+            //     //gccbb2bb[gcc_bb] = func->build_bb();
+            //     debug_bb(gcc_bb);
+            // }
 
-        printf("============================================\n");
+            printf("Converting:\n");
+        }
+
+        stage_scope convert_timer("wyrm: gimple to bimple", timings.gimple_to_bimple);
+        bimple::function function;
+        try {
+            function = simple_gimple_to_bimple_converter(options.stats).generate_function(fun);
+        } catch(const unsupported_node& node) {
+            convert_timer.stop();
+            unit_statistics.add_unsupported(node.kind, node.code);
+            unit_statistics.add_stage("gimple_to_bimple", timings.gimple_to_bimple);
+            if(!options.quiet) {
+                printf("SKIPPED: unsupported %s code %s\n", node.kind, node.code);
+            }
+            return 0;
+        }
+        convert_timer.stop();
+        stage_scope passes_timer("wyrm: bimple passes", timings.passes);
+        options.passes.run(function);
+        passes_timer.stop();
+        if(!options.quiet) {
+            std::cout<<function.to_string(true)<<std::endl;
+        }
+        if(options.dump) {
+            dumped_functions.add(function);
+        }
+        auto pending = std::make_unique<pending_function>();
+        pending->function = std::move(function);
+        pending->timings = std::move(timings);
+        if(ir_cache) {
+            stage_scope cache_timer("wyrm: cache", pending->timings.cache);
+            pending->cache_key = codegen_cache::key_data(pending->function);
+            if(auto cached = ir_cache->lookup(pending->cache_key)) {
+                pending->ir = std::move(*cached);
+                pending->cached = true;
+            }
+        }
+        if(!pending->cached && codegen_pool) {
+            // the worker only reads the function and writes ir and codegen timings, which aren't touched again until
+            // the future is ready
+            pending_function* p = pending.get();
+            pending->codegen_done = codegen_pool->submit([p] {
+                instrumentation::stage_timer codegen_timer(p->timings.codegen);
+                p->ir = llvm_codegen(options.layout).generate(p->function);
+            });
+            pending_functions.push_back(std::move(pending));
+            return 0;
+        }
+        if(!pending->cached) {
+            stage_scope codegen_timer("wyrm: codegen", pending->timings.codegen);
+            pending->ir = llvm_codegen(options.layout).generate(pending->function);
+        }
+        if(codegen_pool) {
+            // keep the output in order behind functions still in the pool
+            pending_functions.push_back(std::move(pending));
+        } else {
+            complete_function(*pending);
+        }
         return 0;
     }
 };
 
+static void finish_unit(void*, void*) {
+    if(codegen_pool) {
+        instrumentation::stage_measurement waiting;
+        stage_scope wait_timer("wyrm: waiting for codegen", waiting);
+        for(auto& pending : pending_functions) {
+            if(pending->codegen_done.valid()) {
+                pending->codegen_done.get();
+            }
+        }
+        wait_timer.stop();
+        for(auto& pending : pending_functions) {
+            complete_function(*pending);
+        }
+        pending_functions.clear();
+        codegen_pool.reset();
+    }
+    if(auto globals = module_globals.generate(); !globals.empty()) {
+        std::ofstream f("x.ll", std::ios_base::app);
+        f<<globals;
+    }
+    if(ir_cache) {
+        ir_cache->evict();
+        unit_statistics.set_cache_counters(ir_cache->get_counters());
+    }
+    if(options.dump) {
+        dumped_functions.write(*options.dump);
+    }
+    if(options.timings) {
+        write_timings(*options.timings);
+    }
+    if(options.stats) {
+        // the pass manager only measures time
+        for(const auto& pass : options.passes.get_passes()) {
+            instrumentation::stage_measurement measurement;
+            measurement.time = pass.time;
+            unit_statistics.add_stage(fmt::format("pass {}", pass.name), measurement);
+        }
+    }
+    if(options.stats_file) {
+        std::ofstream f(*options.stats_file, std::ios_base::app);
+        f<<unit_statistics.to_json(main_input_filename)<<"\n";
+    } else if(options.stats) {
+        std::cerr<<unit_statistics.to_string(main_input_filename);
+    }
+}
+
 int plugin_init(struct plugin_name_args* plugin_info, struct plugin_gcc_version* version) {
     // We check the current gcc loading this plugin against the gcc we used to
     // created this plugin
@@ -123,7 +507,84 @@ int plugin_init(struct plugin_name_args* plugin_info, struct plugin_gcc_version*
     std::cerr << "Number of arguments of this plugin:" << plugin_info->argc << "\n";
 
     for(int i = 0; i < plugin_info->argc; i++) {
-        std::cerr << "Argument " << i << ": Key: " << plugin_info->argv[i].key << ". Value: " << plugin_info->argv[i].value << "\n";
+        std::cerr << "Argument " << i << ": Key: " << plugin_info->argv[i].key << ". Value: " << (plugin_info->argv[i].value ? plugin_info->argv[i].value : "") << "\n";
+    }
+
+    for(int i = 0; i < plugin_info->argc; i++) {
+        std::string_view key = plugin_info->argv[i].key;
+        const char* value = plugin_info->argv[i].value;
+        if(key == "filter" && value) {
+            try {
+                options.filter = std::regex(value, std::regex::ECMAScript | std::regex::optimize);
+            } catch(const std::regex_error& e) {
+                std::cerr << "Invalid filter regex " << value << ": " << e.what() << "\n";
+                return 1;
+            }
+        } else if(key == "functions" && value) {
+            for(auto& name : split(value, ",")) {
+                options.functions.insert(std::move(name));
+            }
+        } else if(key == "attribute") {
+            options.marker = value ? value : "wyrm";
+        } else if(key == "only-hot") {
+            options.only_hot = true;
+        } else if(key == "dump" && value) {
+            options.dump = value;
+        } else if(key == "timings" && value) {
+            options.timings = value;
+        } else if(key == "quiet") {
+            options.quiet = true;
+        } else if(key == "stats") {
+            options.stats = true;
+            if(value) {
+                options.stats_file = value;
+            }
+        } else if(key == "cache" && value) {
+            options.cache = value;
+        } else if(key == "cache-size" && value) {
+            // megabytes
+            try {
+                options.cache_size = std::uintmax_t(std::stoull(value)) << 20;
+            } catch(const std::exception&) {
+                std::cerr << "Invalid cache-size " << value << "\n";
+                return 1;
+            }
+        } else if(key == "jobs") {
+            // all cores if no value is given
+            try {
+                options.jobs = value ? unsigned(std::stoul(value)) : std::max(std::thread::hardware_concurrency(), 1u);
+            } catch(const std::exception&) {
+                std::cerr << "Invalid jobs " << value << "\n";
+                return 1;
+            }
+        } else if(key == "passes") {
+            // comma separated, all passes run by default and none run if no value is given
+            try {
+                options.passes = bimple::pass_manager::parse(value ? value : "");
+            } catch(const std::invalid_argument& e) {
+                std::cerr << "Invalid passes " << value << ": " << e.what() << "\n";
+                return 1;
+            }
+        } else if(key == "layout" && value) {
+            if(auto layout = parse_block_layout(value)) {
+                options.layout = *layout;
+            } else {
+                std::cerr << "Invalid layout " << value << "\n";
+                return 1;
+            }
+        } else if(key == "time-report-threshold") {
+            // milliseconds, every function is reported if no value is given
+            try {
+                std::chrono::duration<double, std::milli> threshold(value ? std::stod(value) : 0);
+                options.time_report_threshold = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold);
+            } catch(const std::exception&) {
+                std::cerr << "Invalid time-report-threshold " << value << "\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown plugin argument " << key << "\n";
+            return 1;
+        }
     }
 
     std::cerr << "\n";
@@ -138,8 +599,18 @@ int plugin_init(struct plugin_name_args* plugin_info, struct plugin_gcc_version*
 
     std::cerr << "Plugin successfully initialized\n";
 
+    if(options.cache) {
+        ir_cache.emplace(*options.cache, options.cache_size, codegen_fingerprint());
+    }
+    if(options.jobs > 0) {
+        codegen_pool.emplace(options.jobs);
+    }
+
     const char* const plugin_name = plugin_info->base_name;
 
+    register_callback(plugin_name, PLUGIN_ATTRIBUTES, register_attributes, NULL);
+    register_callback(plugin_name, PLUGIN_FINISH_UNIT, finish_unit, NULL);
+
     struct register_pass_info llvm_transpilation_info;
     llvm_transpilation_info.pass                         = new llvm_transpilation_pass(g);
     llvm_transpilation_info.reference_pass_name          = "ssa" ;
@@ -0,0 +1,103 @@
+// wyrm-replay: re-runs llvm codegen on bimple functions captured with -fplugin-arg-libplugin-dump=<file>
+//
+// usage: wyrm-replay <file> [--repeat N] [--function <name>] [--layout none|rpo] [-o <output.ll>]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <optional>
+#include <string_view>
+#include <string>
+#include <vector>
+
+#include <fmt/core.h>
+
+#include "bimple.h"
+#include "bimple_serialization.h"
+#include "llvm_codegen.h"
+
+[[noreturn]] static void usage() {
+    fmt::print(stderr, "usage: wyrm-replay <file> [--repeat N] [--function <name>] [--layout none|rpo] [-o <output.ll>]\n");
+    std::exit(2);
+}
+
+int main(int argc, char** argv) {
+    std::optional<std::string> input;
+    std::optional<std::string> output;
+    std::optional<std::string> only;
+    unsigned repeat = 1;
+    block_layout layout = block_layout::reverse_postorder;
+    for(int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        auto next = [&] () -> std::string {
+            if(i + 1 >= argc) {
+                usage();
+            }
+            return argv[++i];
+        };
+        if(arg == "--repeat") {
+            repeat = std::max(1ul, std::stoul(next()));
+        } else if(arg == "--function") {
+            only = next();
+        } else if(arg == "--layout") {
+            auto parsed = parse_block_layout(next());
+            if(!parsed) {
+                usage();
+            }
+            layout = *parsed;
+        } else if(arg == "-o") {
+            output = next();
+        } else if(!input) {
+            input = std::string(arg);
+        } else {
+            usage();
+        }
+    }
+    if(!input) {
+        usage();
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    bimple::mapped_file file(*input);
+    bimple::serialized_module module(file.bytes());
+    std::vector<bimple::function> functions;
+    for(std::size_t i = 0; i < module.size(); i++) {
+        if(!only || module.function_name(i) == *only) {
+            functions.push_back(module.load(i));
+        }
+    }
+    auto load_time = clock::now() - start;
+
+    std::string code;
+    std::vector<clock::duration> times(functions.size());
+    for(unsigned r = 0; r < repeat; r++) {
+        code.clear();
+        declaration_filter declarations;
+        global_table globals;
+        for(std::size_t i = 0; i < functions.size(); i++) {
+            auto before = clock::now();
+            auto ir = llvm_codegen(layout).generate(functions[i]);
+            globals.add(functions[i]);
+            times[i] += clock::now() - before;
+            code += declarations(ir);
+        }
+        code += globals.generate();
+    }
+
+    auto ms = [] (clock::duration d) {
+        return std::chrono::duration<double, std::milli>(d).count();
+    };
+    fmt::print("loaded {} functions in {:.3f} ms\n", functions.size(), ms(load_time));
+    clock::duration total{};
+    for(std::size_t i = 0; i < functions.size(); i++) {
+        fmt::print("    {}: {:.4f} ms/codegen\n", functions[i].identifier, ms(times[i]) / repeat);
+        total += times[i];
+    }
+    fmt::print("codegen: {:.4f} ms per iteration, {} bytes of llvm ir\n", ms(total) / repeat, code.size());
+    if(output) {
+        std::ofstream f(*output);
+        f<<code;
+    }
+}
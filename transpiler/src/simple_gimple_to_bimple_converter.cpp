@@ -16,16 +16,21 @@
 #include <tree-ssanames.h>
 #include <gimple-iterator.h>
 #include <gimple-pretty-print.h>
+#include <internal-fn.h>
+#include <builtins.h>
 #include <plugin-version.h>
 
 #include <algorithm>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <memory>
 #include <new>
+#include <optional>
 #include <stack>
 #include <string_view>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -44,31 +49,100 @@
 
 using namespace std::string_literals;
 
-// done for magic enum reasons
-// copied from https://chromium.googlesource.com/chromiumos/third_party/gcc/+/refs/heads/factory-rambi-6420.B/gcc/gimple.h#71
-enum class gimple_rhs_class_class {
-    GIMPLE_INVALID_RHS,	/* The expression cannot be used on the RHS.  */
-    GIMPLE_TERNARY_RHS,	/* The expression is a ternary operation.  */
-    GIMPLE_BINARY_RHS,	/* The expression is a binary operation.  */
-    GIMPLE_UNARY_RHS,	/* The expression is a unary operation.  */
-    GIMPLE_SINGLE_RHS	/* The expression is a single object (an SSA
-                            name, a _DECL, a _REF, etc.  */
-};
-
-// done for magic enum reasons
-enum class gimple_code_class {
-#define DEFGSCODE(SYM, STRING, STRUCT)	SYM,
-#include "gimple.def"
-#undef DEFGSCODE
-    LAST_AND_UNUSED_GIMPLE_CODE
-};
-
 class simple_gimple_to_bimple_converter::impl {
 public:
+    bool keep_going;
+    // what the function's options allow on its floating point operations
+    bimple::fp_flags fp_flags = bimple::fp_flags::none;
+    // the function's locals that live in memory, VAR_DECL -> bimple::local name
+    std::unordered_map<tree, std::string> local_names;
+    // globals and string literals the function refers to, in the order they're first referenced
+    std::vector<tree> referenced_globals;
+    std::unordered_set<std::string> referenced_global_names;
+
+    impl(bool keep_going) : keep_going(keep_going) {}
+
+    [[noreturn]] void unsupported(const char* message, const char* kind, const char* code) {
+        if(keep_going) {
+            throw unsupported_node{kind, code};
+        }
+        VERIFY(false, message, code);
+        __builtin_unreachable();
+    }
+
     std::size_t type_size(tree type) {
         return TREE_INT_CST_LOW(TYPE_SIZE(type));
     }
 
+    // gcc's tag for a record, empty for anonymous ones
+    std::string type_name(tree type) {
+        tree name = TYPE_NAME(TYPE_MAIN_VARIANT(type));
+        if(name != NULL_TREE && TREE_CODE(name) == TYPE_DECL) {
+            name = DECL_NAME(name);
+        }
+        return name != NULL_TREE ? IDENTIFIER_POINTER(name) : "";
+    }
+
+    // bit position of a field from the start of its record, nullopt if it isn't a constant
+    std::optional<std::size_t> field_bit_position(tree field) {
+        if(!tree_fits_uhwi_p(DECL_FIELD_OFFSET(field)) || !tree_fits_uhwi_p(DECL_FIELD_BIT_OFFSET(field))) {
+            return std::nullopt;
+        }
+        return tree_to_uhwi(DECL_FIELD_OFFSET(field)) * BITS_PER_UNIT + tree_to_uhwi(DECL_FIELD_BIT_OFFSET(field));
+    }
+
+    // fields bimple keeps, bit-fields and fields that don't start on a byte are left to be padding
+    bool is_bimple_field(tree field) {
+        if(TREE_CODE(field) != FIELD_DECL || DECL_BIT_FIELD(field)) {
+            return false;
+        }
+        auto position = field_bit_position(field);
+        return position && *position % BITS_PER_UNIT == 0;
+    }
+
+    // index of a field among the record's bimple fields
+    unsigned field_index(tree record, tree field) {
+        unsigned index = 0;
+        for(tree f = TYPE_FIELDS(record); f != NULL_TREE; f = DECL_CHAIN(f)) {
+            if(f == field) {
+                return index;
+            }
+            if(is_bimple_field(f)) {
+                index++;
+            }
+        }
+        VERIFY(false, "Field not found in its record");
+        __builtin_unreachable();
+    }
+
+    // records behind pointers are shallow, just the name and size
+    std::unique_ptr<bimple::type> generate_record(tree type, bool shallow) {
+        std::size_t size = 0;
+        if(TYPE_SIZE(type) != NULL_TREE) {
+            if(!tree_fits_uhwi_p(TYPE_SIZE(type))) {
+                unsupported("Variable sized record", "tree", get_tree_code_name(TREE_CODE(type)));
+            }
+            size = type_size(type);
+        }
+        std::vector<bimple::field> fields;
+        if(!shallow) {
+            for(tree field = TYPE_FIELDS(type); field != NULL_TREE; field = DECL_CHAIN(field)) {
+                if(!is_bimple_field(field)) {
+                    continue;
+                }
+                fields.push_back({
+                    DECL_NAME(field) != NULL_TREE ? IDENTIFIER_POINTER(DECL_NAME(field)) : "",
+                    generate_type(TREE_TYPE(field)),
+                    *field_bit_position(field) / BITS_PER_UNIT
+                });
+            }
+        }
+        if(TREE_CODE(type) == UNION_TYPE) {
+            return std::make_unique<bimple::union_type>(type_name(type), std::move(fields), size);
+        }
+        return std::make_unique<bimple::struct_type>(type_name(type), std::move(fields), size);
+    }
+
     std::unique_ptr<bimple::type> generate_type(tree type) {
         switch(TREE_CODE(type)) {
             case VOID_TYPE:
@@ -82,7 +156,27 @@ public:
             case REAL_TYPE:
                 return std::make_unique<bimple::real>(unsigned(TYPE_PRECISION(type)), type_size(type));
             case POINTER_TYPE:
+                if(RECORD_OR_UNION_TYPE_P(TREE_TYPE(type))) {
+                    return std::make_unique<bimple::pointer>(generate_record(TREE_TYPE(type), true), type_size(type));
+                }
                 return std::make_unique<bimple::pointer>(generate_type(TREE_TYPE(type)), type_size(type));
+            case RECORD_TYPE:
+            case UNION_TYPE:
+                return generate_record(type, false);
+            case ARRAY_TYPE:
+                {
+                    tree domain = TYPE_DOMAIN(type);
+                    std::size_t count = 0;
+                    // no upper bound for flexible array members and arrays of unknown size
+                    if(domain != NULL_TREE && TYPE_MAX_VALUE(domain) != NULL_TREE) {
+                        if(!tree_fits_shwi_p(TYPE_MAX_VALUE(domain)) || !integer_zerop(TYPE_MIN_VALUE(domain))) {
+                            unsupported("Variable length array", "tree", get_tree_code_name(TREE_CODE(type)));
+                        }
+                        count = std::size_t(tree_to_shwi(TYPE_MAX_VALUE(domain)) + 1);
+                    }
+                    auto element = generate_type(TREE_TYPE(type));
+                    return std::make_unique<bimple::array>(std::move(element), count, count * element->size * 8);
+                }
             case FUNCTION_TYPE:
                 {
                     auto return_type = generate_type(TREE_TYPE(type));
@@ -98,12 +192,7 @@ public:
                     );
                 }
             default:
-                VERIFY(
-                    false,
-                    "Unhandled node",
-                    get_tree_code_name(TREE_CODE(type))
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled node", "tree", get_tree_code_name(TREE_CODE(type)));
         }
     }
 
@@ -121,30 +210,210 @@ public:
                     return "_" + std::to_string(SSA_NAME_VERSION(node));
                 }
             default:
-                VERIFY(
-                    false,
-                    "Unhandled node",
-                    get_tree_code_name(TREE_CODE(node))
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled node", "tree", get_tree_code_name(TREE_CODE(node)));
+        }
+    }
+
+    // string literals are named after their contents so every function using one emits the same definition
+    std::string literal_name(tree node) {
+        std::uint64_t hash = 0xcbf29ce484222325;
+        for(int i = 0; i < TREE_STRING_LENGTH(node); i++) {
+            hash ^= std::uint64_t(static_cast<unsigned char>(TREE_STRING_POINTER(node)[i]));
+            hash *= 0x100000001b3;
         }
+        return fmt::format(".str.{:016x}.{}", hash, type_size(TREE_TYPE(node)) / BITS_PER_UNIT);
     }
 
+    // the symbol of a function, global variable, or string literal, globals are recorded so the function carries them
+    // to the module's global_table
     std::string get_referenced_value(tree node) {
+        std::string name;
         switch(TREE_CODE(node)) {
             case FUNCTION_DECL:
                 // TODO Probably wrong
                 return gcc_str(DECL_ASSEMBLER_NAME(node)->identifier.id.str);
+            case VAR_DECL:
+                if(!is_global_var(node)) {
+                    unsupported("Unhandled variable", "tree", get_tree_code_name(TREE_CODE(node)));
+                }
+                name = gcc_str(DECL_ASSEMBLER_NAME(node)->identifier.id.str);
+                break;
+            case STRING_CST:
+                name = literal_name(node);
+                break;
             default:
-                VERIFY(
-                    false,
-                    "Unhandled node",
-                    get_tree_code_name(TREE_CODE(node))
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled node", "tree", get_tree_code_name(TREE_CODE(node)));
+        }
+        if(referenced_global_names.insert(name).second) {
+            referenced_globals.push_back(node);
+        }
+        return name;
+    }
+
+    // Constant value of a global from its DECL_INITIAL, the type is the one of the global or the element being
+    // initialized. Aggregates only list the elements and fields the constructor has.
+    bimple::initializer generate_initializer(tree value, tree type) {
+        bimple::initializer result;
+        STRIP_NOPS(value);
+        switch(TREE_CODE(value)) {
+            case INTEGER_CST:
+                result.kind = bimple::initializer_kind::integer;
+                if(TYPE_PRECISION(type) > HOST_BITS_PER_WIDE_INT) {
+                    if(!tree_fits_shwi_p(value)) {
+                        unsupported("Integer initializer wider than 64 bits", "tree", get_tree_code_name(TREE_CODE(value)));
+                    }
+                    result.integer = tree_to_shwi(value);
+                } else {
+                    result.integer = sext_hwi(TREE_INT_CST_LOW(value), TYPE_PRECISION(type));
+                }
+                return result;
+            case REAL_CST:
+                result.kind = bimple::initializer_kind::real;
+                result.text = stringify_real_cst(value);
+                return result;
+            case STRING_CST:
+                if(TREE_CODE(type) != ARRAY_TYPE || type_size(TREE_TYPE(type)) != BITS_PER_UNIT) {
+                    unsupported("Wide string initializer", "tree", get_tree_code_name(TREE_CODE(value)));
+                }
+                result.kind = bimple::initializer_kind::string;
+                result.text.assign(TREE_STRING_POINTER(value), TREE_STRING_LENGTH(value));
+                return result;
+            case ADDR_EXPR:
+                {
+                    // &x, &x.a[2] and "literal" are a symbol plus a constant offset
+                    poly_int64 offset;
+                    HOST_WIDE_INT constant_offset;
+                    tree base = get_addr_base_and_unit_offset(TREE_OPERAND(value, 0), &offset);
+                    if(base == NULL_TREE || !offset.is_constant(&constant_offset)) {
+                        unsupported("Address initializer with a variable offset", "tree", get_tree_code_name(TREE_CODE(value)));
+                    }
+                    switch(TREE_CODE(base)) {
+                        case VAR_DECL:
+                        case FUNCTION_DECL:
+                        case STRING_CST:
+                            break;
+                        default:
+                            unsupported("Unhandled address initializer", "tree", get_tree_code_name(TREE_CODE(base)));
+                    }
+                    result.kind = bimple::initializer_kind::address;
+                    result.text = get_referenced_value(base);
+                    result.integer = constant_offset;
+                    return result;
+                }
+            case CONSTRUCTOR:
+                {
+                    result.kind = bimple::initializer_kind::aggregate;
+                    unsigned HOST_WIDE_INT i;
+                    tree index;
+                    tree element;
+                    if(TREE_CODE(type) == ARRAY_TYPE) {
+                        // elements without an index follow the previous one, [first ... last] = x repeats x
+                        std::size_t next = 0;
+                        FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(value), i, index, element) {
+                            std::size_t first = next;
+                            std::size_t last = next;
+                            if(index != NULL_TREE && TREE_CODE(index) == RANGE_EXPR) {
+                                first = tree_to_uhwi(TREE_OPERAND(index, 0));
+                                last = tree_to_uhwi(TREE_OPERAND(index, 1));
+                            } else if(index != NULL_TREE) {
+                                if(!tree_fits_uhwi_p(index)) {
+                                    unsupported("Unhandled array initializer index", "tree", get_tree_code_name(TREE_CODE(index)));
+                                }
+                                first = last = tree_to_uhwi(index);
+                            }
+                            auto converted = generate_initializer(element, TREE_TYPE(type));
+                            for(std::size_t j = first; j <= last; j++) {
+                                result.indices.push_back(j);
+                                result.elements.push_back(converted);
+                            }
+                            next = last + 1;
+                        }
+                    } else if(RECORD_OR_UNION_TYPE_P(type)) {
+                        FOR_EACH_CONSTRUCTOR_ELT(CONSTRUCTOR_ELTS(value), i, index, element) {
+                            if(index == NULL_TREE || TREE_CODE(index) != FIELD_DECL) {
+                                unsupported("Record initializer without a field", "tree", get_tree_code_name(TREE_CODE(value)));
+                            }
+                            // bit-fields are padding to bimple, that's only right while they're zero
+                            if(!is_bimple_field(index)) {
+                                if(!integer_zerop(element)) {
+                                    unsupported("Bit-field initializer", "tree", get_tree_code_name(TREE_CODE(value)));
+                                }
+                                continue;
+                            }
+                            result.indices.push_back(field_index(type, index));
+                            result.elements.push_back(generate_initializer(element, TREE_TYPE(index)));
+                        }
+                    } else {
+                        unsupported("Unhandled constructor initializer", "tree", get_tree_code_name(TREE_CODE(type)));
+                    }
+                    return result;
+                }
+            default:
+                unsupported("Unhandled initializer", "tree", get_tree_code_name(TREE_CODE(value)));
         }
     }
 
+    // the model gcc settled on, ipa visibility has already relaxed it for symbols that bind locally
+    bimple::tls_models tls_model(tree node) {
+        if(!DECL_THREAD_LOCAL_P(node)) {
+            return bimple::tls_models::none;
+        }
+        switch(decl_tls_model(node)) {
+            case TLS_MODEL_GLOBAL_DYNAMIC:
+                return bimple::tls_models::global_dynamic;
+            case TLS_MODEL_LOCAL_DYNAMIC:
+                return bimple::tls_models::local_dynamic;
+            case TLS_MODEL_INITIAL_EXEC:
+                return bimple::tls_models::initial_exec;
+            case TLS_MODEL_LOCAL_EXEC:
+                return bimple::tls_models::local_exec;
+            default:
+                // -femulated-tls goes through __emutls_get_address and control variables
+                unsupported("Unhandled tls model", "tree", get_tree_code_name(TREE_CODE(node)));
+        }
+    }
+
+    // Definition of a referenced global, or a declaration of one defined elsewhere. Constant pool entries gcc makes
+    // for aggregate initializers and string literals have no meaningful address, llvm may merge them.
+    bimple::global generate_global(tree node) {
+        bimple::global global;
+        global.name = get_referenced_value(node);
+        global.type = generate_type(TREE_TYPE(node));
+        if(TREE_CODE(node) == STRING_CST) {
+            global.value = generate_initializer(node, TREE_TYPE(node));
+            global.linkage = bimple::linkages::internal;
+            global.align = TYPE_ALIGN_UNIT(TREE_TYPE(node));
+            global.is_constant = true;
+            global.unnamed_addr = true;
+            return global;
+        }
+        global.align = DECL_ALIGN_UNIT(node);
+        global.tls_model = tls_model(node);
+        global.is_constant = TREE_READONLY(node) && !TREE_THIS_VOLATILE(node);
+        if(DECL_SECTION_NAME(node) != nullptr) {
+            global.section = DECL_SECTION_NAME(node);
+        }
+        if(DECL_EXTERNAL(node)) {
+            return global;
+        }
+        if(!TREE_PUBLIC(node)) {
+            global.linkage = bimple::linkages::internal;
+        } else if(DECL_WEAK(node)) {
+            global.linkage = bimple::linkages::weak;
+        } else if(DECL_COMMON(node) && !global.is_constant) {
+            global.linkage = bimple::linkages::common;
+        }
+        global.unnamed_addr = DECL_ARTIFICIAL(node) && TREE_READONLY(node);
+        // no initializer, or one run at startup, is zero until then
+        tree initial = DECL_INITIAL(node);
+        if(initial == NULL_TREE || initial == error_mark_node) {
+            global.value = bimple::initializer{};
+        } else {
+            global.value = generate_initializer(initial, TREE_TYPE(node));
+        }
+        return global;
+    }
+
     std::unique_ptr<bimple::atom> generate_atom(tree node) {
         switch(TREE_CODE(node)) {
             case IDENTIFIER_NODE:
@@ -169,19 +438,83 @@ public:
                     generate_atom(TREE_OPERAND(node, 1)),
                     generate_type(TREE_TYPE(node))
                 );
-            case ADDR_EXPR:
-                // seems to be used for referencing storage or global items, e.g. function names
-                return std::make_unique<bimple::addr_expr>(
-                    get_referenced_value(TREE_OPERAND(node, 0)),
+            case COMPONENT_REF:
+                {
+                    tree field = TREE_OPERAND(node, 1);
+                    if(DECL_BIT_FIELD(field)) {
+                        unsupported("Bit-field reference", "tree", get_tree_code_name(TREE_CODE(node)));
+                    }
+                    if(TREE_OPERAND(node, 2) != NULL_TREE || !is_bimple_field(field)) {
+                        unsupported("Variable field offset", "tree", get_tree_code_name(TREE_CODE(node)));
+                    }
+                    tree base = TREE_OPERAND(node, 0);
+                    return std::make_unique<bimple::component_ref>(
+                        generate_atom(base),
+                        field_index(TREE_TYPE(base), field),
+                        generate_type(TREE_TYPE(node))
+                    );
+                }
+            case ARRAY_REF:
+                if(!integer_zerop(array_ref_low_bound(node)) || TREE_OPERAND(node, 3) != NULL_TREE) {
+                    unsupported("Array reference with a bound or element size", "tree", get_tree_code_name(TREE_CODE(node)));
+                }
+                return std::make_unique<bimple::array_ref>(
+                    generate_atom(TREE_OPERAND(node, 0)),
+                    generate_atom(TREE_OPERAND(node, 1)),
                     generate_type(TREE_TYPE(node))
                 );
-            default:
-                VERIFY(
-                    false,
-                    "Unhandled node",
-                    get_tree_code_name(TREE_CODE(node))
+            case VAR_DECL:
+                if(is_global_var(node)) {
+                    return std::make_unique<bimple::global_ref>(
+                        get_referenced_value(node),
+                        generate_type(TREE_TYPE(node))
+                    );
+                }
+                if(!local_names.contains(node)) {
+                    unsupported("Unhandled variable", "tree", get_tree_code_name(TREE_CODE(node)));
+                }
+                return std::make_unique<bimple::local_ref>(
+                    std::string(local_names.at(node)),
+                    generate_type(TREE_TYPE(node))
                 );
-                __builtin_unreachable();
+            case STRING_CST:
+                return std::make_unique<bimple::global_ref>(
+                    get_referenced_value(node),
+                    generate_type(TREE_TYPE(node))
+                );
+            case ADDR_EXPR:
+                {
+                    tree object = TREE_OPERAND(node, 0);
+                    switch(TREE_CODE(object)) {
+                        case MEM_REF:
+                        case COMPONENT_REF:
+                        case ARRAY_REF:
+                            return std::make_unique<bimple::address_of>(
+                                generate_atom(object),
+                                generate_type(TREE_TYPE(node))
+                            );
+                        default:
+                            if(local_names.contains(object)) {
+                                return std::make_unique<bimple::address_of>(
+                                    generate_atom(object),
+                                    generate_type(TREE_TYPE(node))
+                                );
+                            }
+                            // functions, globals and string literals
+                            return std::make_unique<bimple::addr_expr>(
+                                get_referenced_value(object),
+                                generate_type(TREE_TYPE(node))
+                            );
+                    }
+                }
+            case CONSTRUCTOR:
+                // aggregate initializers are empty in gimple, anything else is a vector
+                if(CONSTRUCTOR_NELTS(node) != 0) {
+                    unsupported("Non-empty constructor", "tree", get_tree_code_name(TREE_CODE(node)));
+                }
+                return std::make_unique<bimple::zero_initializer>(generate_type(TREE_TYPE(node)));
+            default:
+                unsupported("Unhandled node", "tree", get_tree_code_name(TREE_CODE(node)));
         }
     }
 
@@ -247,19 +580,18 @@ public:
                 op = bimple::operators::neq;
                 break;
             default:
-                VERIFY(
-                    false,
-                    "Unhandled binary assignment operator",
-                    get_tree_code_name(code)
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled binary assignment operator", "tree", get_tree_code_name(code));
         }
-        return std::make_unique<bimple::binary_assignment>(
+        auto assignment = std::make_unique<bimple::binary_assignment>(
             generate_atom(lhs),
             generate_atom(rhs1),
             generate_atom(rhs2),
             op
         );
+        if(FLOAT_TYPE_P(TREE_TYPE(rhs1))) {
+            assignment->flags = fp_flags;
+        }
+        return assignment;
     }
 
     std::unique_ptr<bimple::unary_assignment> generate_unary_assignment(gassign* statement) {
@@ -274,9 +606,15 @@ public:
             case SSA_NAME:
             case FLOAT_EXPR: // used for int -> real
             case FIX_TRUNC_EXPR: // used for real -> int
+            case ADDR_EXPR:
+            case CONSTRUCTOR:
                 op = bimple::operators::assign;
                 break;
             case MEM_REF:
+            case COMPONENT_REF:
+            case ARRAY_REF:
+            case VAR_DECL:
+            case STRING_CST:
                 op = bimple::operators::mem_ref;
                 break;
             case BIT_NOT_EXPR:
@@ -286,18 +624,39 @@ public:
                 op = bimple::operators::neg;
                 break;
             default:
-                VERIFY(
-                    false,
-                    "Unhandled unary assignment operator",
-                    get_tree_code_name(code)
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled unary assignment operator", "tree", get_tree_code_name(code));
         }
-        return std::make_unique<bimple::unary_assignment>(
+        auto assignment = std::make_unique<bimple::unary_assignment>(
             generate_atom(lhs),
             generate_atom(rhs),
             op
         );
+        if(op == bimple::operators::neg && FLOAT_TYPE_P(TREE_TYPE(rhs))) {
+            assignment->flags = fp_flags;
+        }
+        return assignment;
+    }
+
+    // gcc folds fabs calls to ABS_EXPR before the pass runs
+    std::unique_ptr<bimple::intrinsic_call> generate_abs(gassign* statement) {
+        tree lhs = gimple_assign_lhs(statement);
+        tree rhs = gimple_assign_rhs1(statement);
+        tree type = TREE_TYPE(rhs);
+        bimple::intrinsics id;
+        if(SCALAR_FLOAT_TYPE_P(type)) {
+            id = bimple::intrinsics::fabs;
+        } else if(INTEGRAL_TYPE_P(type) && !TYPE_OVERFLOW_WRAPS(type)) {
+            id = bimple::intrinsics::abs;
+        } else {
+            unsupported("Unhandled absolute value", "tree", get_tree_code_name(ABS_EXPR));
+        }
+        std::vector<std::unique_ptr<bimple::atom>> args;
+        args.push_back(generate_atom(rhs));
+        auto intrinsic = std::make_unique<bimple::intrinsic_call>(id, generate_atom(lhs), std::move(args));
+        if(id == bimple::intrinsics::fabs) {
+            intrinsic->flags = fp_flags;
+        }
+        return intrinsic;
     }
 
     std::unique_ptr<bimple::assignment> generate_assignment(gassign* statement) {
@@ -309,17 +668,117 @@ public:
             case GIMPLE_SINGLE_RHS:
                 return generate_unary_assignment(statement);
             default:
-                VERIFY(
-                    false,
-                    "Unhandled gimple assignment operator",
-                    static_cast<gimple_rhs_class_class>(get_gimple_rhs_class(code)),
-                    get_tree_code_name(code)
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled gimple assignment operator", "tree", get_tree_code_name(code));
+        }
+    }
+
+    // gcc builtins and internal functions that have an llvm intrinsic
+    std::optional<bimple::intrinsics> intrinsic_for(gcall* statement) {
+        using enum bimple::intrinsics;
+        if(!gimple_call_internal_p(statement) && !gimple_call_builtin_p(statement, BUILT_IN_NORMAL)) {
+            return std::nullopt;
+        }
+        switch(gimple_call_combined_fn(statement)) {
+            case CFN_BUILT_IN_MEMCPY:
+                return memcpy;
+            case CFN_BUILT_IN_MEMMOVE:
+                return memmove;
+            case CFN_BUILT_IN_MEMSET:
+                return memset;
+            case CFN_BUILT_IN_POPCOUNT:
+            case CFN_BUILT_IN_POPCOUNTL:
+            case CFN_BUILT_IN_POPCOUNTLL:
+            case CFN_BUILT_IN_POPCOUNTIMAX:
+            case CFN_POPCOUNT:
+                return popcount;
+            case CFN_BUILT_IN_CTZ:
+            case CFN_BUILT_IN_CTZL:
+            case CFN_BUILT_IN_CTZLL:
+            case CFN_BUILT_IN_CTZIMAX:
+            case CFN_CTZ:
+                return ctz;
+            case CFN_BUILT_IN_CLZ:
+            case CFN_BUILT_IN_CLZL:
+            case CFN_BUILT_IN_CLZLL:
+            case CFN_BUILT_IN_CLZIMAX:
+            case CFN_CLZ:
+                return clz;
+            case CFN_BUILT_IN_BSWAP16:
+            case CFN_BUILT_IN_BSWAP32:
+            case CFN_BUILT_IN_BSWAP64:
+            case CFN_BUILT_IN_BSWAP128:
+                return bswap;
+            case CFN_BUILT_IN_PREFETCH:
+                return prefetch;
+            case CFN_BUILT_IN_EXPECT:
+            case CFN_BUILT_IN_EXPECT_WITH_PROBABILITY:
+            case CFN_BUILTIN_EXPECT:
+                return expect;
+            case CFN_BUILT_IN_ASSUME_ALIGNED:
+                return assume_aligned;
+            default:
+                return math_intrinsic_for(statement);
         }
     }
 
-    std::unique_ptr<bimple::call> generate_call(gcall* statement) {
+    // Math builtins are matched through their internal function, so every floating point width is covered. Builtins
+    // that may set errno are only replaced with -fno-math-errno, gcc leaves the rest const.
+    std::optional<bimple::intrinsics> math_intrinsic_for(gcall* statement) {
+        using enum bimple::intrinsics;
+        internal_fn fn;
+        if(gimple_call_internal_p(statement)) {
+            fn = gimple_call_internal_fn(statement);
+        } else {
+            if(flag_errno_math && !(gimple_call_flags(statement) & ECF_CONST)) {
+                return std::nullopt;
+            }
+            fn = associated_internal_fn(gimple_call_fndecl(statement));
+        }
+        switch(fn) {
+            case IFN_SQRT:
+                return sqrt;
+            case IFN_FLOOR:
+                return floor;
+            case IFN_CEIL:
+                return ceil;
+            case IFN_TRUNC:
+                return trunc;
+            case IFN_ROUND:
+                return round;
+            case IFN_RINT:
+                return rint;
+            case IFN_NEARBYINT:
+                return nearbyint;
+            case IFN_SIN:
+                return sin;
+            case IFN_COS:
+                return cos;
+            case IFN_EXP:
+                return exp;
+            case IFN_EXP2:
+                return exp2;
+            case IFN_LOG:
+                return log;
+            case IFN_LOG2:
+                return log2;
+            case IFN_LOG10:
+                return log10;
+            case IFN_POW:
+                return pow;
+            case IFN_COPYSIGN:
+                return copysign;
+            case IFN_FMIN:
+                return fmin;
+            case IFN_FMAX:
+                return fmax;
+            case IFN_FMA:
+                return fma;
+            default:
+                return std::nullopt;
+        }
+    }
+
+    void generate_call(gcall* statement, std::vector<std::unique_ptr<bimple::statement>>& statements) {
         tree lhs = gimple_call_lhs(statement);
         tree fun = gimple_call_fn(statement);
         // VERIFY(
@@ -332,10 +791,48 @@ public:
             tree arg = gimple_call_arg(statement, i);
             args.push_back(generate_atom(arg));
         }
-        return std::make_unique<bimple::call>(
-            generate_atom(fun),
-            generate_atom(lhs),
-            std::move(args)
+        std::unique_ptr<bimple::atom> result;
+        if(lhs != NULL_TREE) {
+            result = generate_atom(lhs);
+        }
+        if(auto id = intrinsic_for(statement)) {
+            using enum bimple::intrinsics;
+            // the internal .BUILTIN_EXPECT's third operand names the predictor, only
+            // __builtin_expect_with_probability's is a probability
+            if(gimple_call_combined_fn(statement) == CFN_BUILTIN_EXPECT) {
+                args.resize(2);
+            }
+            // the mem* builtins and assume_aligned return their first argument, the intrinsics return nothing
+            if(*id == memcpy || *id == memmove || *id == memset || *id == assume_aligned) {
+                auto pointer = args[0]->clone();
+                statements.push_back(std::make_unique<bimple::intrinsic_call>(*id, nullptr, std::move(args)));
+                if(result) {
+                    statements.push_back(
+                        std::make_unique<bimple::unary_assignment>(
+                            std::move(result),
+                            std::move(pointer),
+                            bimple::operators::assign
+                        )
+                    );
+                }
+            } else {
+                auto intrinsic = std::make_unique<bimple::intrinsic_call>(*id, std::move(result), std::move(args));
+                if(bimple::is_math(*id)) {
+                    intrinsic->flags = fp_flags;
+                }
+                statements.push_back(std::move(intrinsic));
+            }
+            return;
+        }
+        if(gimple_call_internal_p(statement)) {
+            unsupported("Unhandled internal function", "ifn", internal_fn_name(gimple_call_internal_fn(statement)));
+        }
+        statements.push_back(
+            std::make_unique<bimple::call>(
+                generate_atom(fun),
+                std::move(result),
+                std::move(args)
+            )
         );
     }
 
@@ -344,9 +841,7 @@ public:
         if(value == NULL_TREE) {
             return std::make_unique<bimple::function_return>();
         } else {
-            return std::make_unique<bimple::function_return>(
-                bimple::variable {get_identifier_value(value), generate_type(TREE_TYPE(value))}
-            );
+            return std::make_unique<bimple::function_return>(generate_atom(value));
         }
     }
 
@@ -375,13 +870,7 @@ public:
                 op = bimple::operators::neq;
                 break;
             default:
-                VERIFY(
-                    false,
-                    "Unhandled gimple condition operator",
-                    static_cast<gimple_rhs_class_class>(get_gimple_rhs_class(code)),
-                    get_tree_code_name(code)
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled gimple condition operator", "tree", get_tree_code_name(code));
         }
         return std::make_unique<bimple::cond>(
             generate_atom(lhs),
@@ -390,32 +879,132 @@ public:
         );
     }
 
-    std::unique_ptr<bimple::statement> generate_statement(gimple* statement) {
+    // the blocks a switch goes to, the default's first and then every other target once, in the order of the labels
+    std::vector<basic_block> switch_targets(gswitch* statement) {
+        std::vector<basic_block> targets;
+        for(unsigned i = 0; i < gimple_switch_num_labels(statement); i++) {
+            basic_block target = label_to_block(cfun, CASE_LABEL(gimple_switch_label(statement, i)));
+            if(std::ranges::find(targets, target) == targets.end()) {
+                targets.push_back(target);
+            }
+        }
+        return targets;
+    }
+
+    std::unique_ptr<bimple::switch_branch> generate_switch(gswitch* statement) {
+        // llvm's switch lists every value, so ranges (case 1 ... 5:) are expanded
+        constexpr unsigned HOST_WIDE_INT max_range = 1024;
+        tree index = gimple_switch_index(statement);
+        tree type = TREE_TYPE(index);
+        if(!INTEGRAL_TYPE_P(type) || TYPE_PRECISION(type) > HOST_BITS_PER_WIDE_INT) {
+            unsupported("Unhandled switch index", "tree", get_tree_code_name(TREE_CODE(type)));
+        }
+        unsigned precision = TYPE_PRECISION(type);
+        auto targets = switch_targets(statement);
+        std::vector<bimple::switch_case> cases;
+        // label 0 is the default
+        for(unsigned i = 1; i < gimple_switch_num_labels(statement); i++) {
+            tree label = gimple_switch_label(statement, i);
+            tree low = CASE_LOW(label);
+            tree high = CASE_HIGH(label) != NULL_TREE ? CASE_HIGH(label) : low;
+            if(zext_hwi(TREE_INT_CST_LOW(high) - TREE_INT_CST_LOW(low), precision) >= max_range) {
+                unsupported("Switch case range", "gimple", gimple_code_name[GIMPLE_SWITCH]);
+            }
+            basic_block target = label_to_block(cfun, CASE_LABEL(label));
+            cases.push_back({
+                sext_hwi(TREE_INT_CST_LOW(low), precision),
+                sext_hwi(TREE_INT_CST_LOW(high), precision),
+                std::size_t(std::ranges::find(targets, target) - targets.begin())
+            });
+        }
+        return std::make_unique<bimple::switch_branch>(generate_atom(index), std::move(cases));
+    }
+
+    // calls can lower to more than one statement
+    void generate_statement(gimple* statement, std::vector<std::unique_ptr<bimple::statement>>& statements) {
         switch(gimple_code(statement)) {
             case GIMPLE_ASSIGN:
-                return generate_assignment(reinterpret_cast<gassign*>(statement));
+                // end of a local's scope, other clobbers don't matter to llvm
+                if(gimple_clobber_p(statement)) {
+                    tree lhs = gimple_assign_lhs(statement);
+                    if(local_names.contains(lhs)) {
+                        std::vector<std::unique_ptr<bimple::atom>> args;
+                        args.push_back(generate_atom(lhs));
+                        statements.push_back(
+                            std::make_unique<bimple::intrinsic_call>(
+                                bimple::intrinsics::lifetime_end,
+                                nullptr,
+                                std::move(args)
+                            )
+                        );
+                    }
+                    return;
+                }
+                if(gimple_assign_rhs_code(statement) == ABS_EXPR) {
+                    statements.push_back(generate_abs(reinterpret_cast<gassign*>(statement)));
+                    return;
+                }
+                statements.push_back(generate_assignment(reinterpret_cast<gassign*>(statement)));
+                return;
             case GIMPLE_CALL:
-                return generate_call(reinterpret_cast<gcall*>(statement));
+                generate_call(reinterpret_cast<gcall*>(statement), statements);
+                return;
             case GIMPLE_RETURN:
-                return generate_return(reinterpret_cast<greturn*>(statement));
+                statements.push_back(generate_return(reinterpret_cast<greturn*>(statement)));
+                return;
             case GIMPLE_COND:
-                return generate_cond(reinterpret_cast<gcond*>(statement));
+                statements.push_back(generate_cond(reinterpret_cast<gcond*>(statement)));
+                return;
+            case GIMPLE_SWITCH:
+                statements.push_back(generate_switch(reinterpret_cast<gswitch*>(statement)));
+                return;
             case GIMPLE_PREDICT: // nothing for now
             case GIMPLE_LABEL:
             case GIMPLE_NOP:
-                return {};
+            // ends a cleanup pad generate_bb let through, nothing branches there once the eh edges are dropped
+            case GIMPLE_RESX:
+                return;
             default:
-                VERIFY(
-                    false,
-                    "Unhandled gimple statement",
-                    static_cast<gimple_code_class>(gimple_code(statement))
-                );
-                __builtin_unreachable();
+                unsupported("Unhandled gimple statement", "gimple", gimple_code_name[gimple_code(statement)]);
+        }
+    }
+
+    // Cleanup pads that only end locals' lifetimes before unwinding further. Calls in llvm unwind out of the function
+    // without a landing pad and the locals' storage goes with the frame, so the eh edges to these pads can be dropped.
+    bool is_clobber_only_cleanup(basic_block bb) {
+        for(gphi_iterator it = gsi_start_phis(bb); !gsi_end_p(it); gsi_next(&it)) {
+            if(TREE_CODE(TREE_TYPE(gimple_phi_result(it.phi()))) != VOID_TYPE) {
+                return false;
+            }
+        }
+        for(gimple_stmt_iterator it = gsi_start_bb(bb); !gsi_end_p(it); gsi_next(&it)) {
+            gimple* statement = gsi_stmt(it);
+            switch(gimple_code(statement)) {
+                case GIMPLE_ASSIGN:
+                    if(!gimple_clobber_p(statement)) {
+                        return false;
+                    }
+                    break;
+                case GIMPLE_PREDICT:
+                case GIMPLE_LABEL:
+                case GIMPLE_NOP:
+                case GIMPLE_RESX:
+                    break;
+                default:
+                    return false;
+            }
+        }
+        edge e;
+        edge_iterator ei;
+        FOR_EACH_EDGE(e, ei, bb->succs) {
+            if(e->dest->index != EXIT_BLOCK && !is_clobber_only_cleanup(e->dest)) {
+                return false;
+            }
         }
+        return true;
     }
 
     bimple::basic_block generate_bb(basic_block bb) {
-        std::cout<<bb->index<<std::endl;
         bimple::basic_block bbb;
         bbb.index = bb->index;
         // Handle phi nodes
@@ -431,16 +1020,13 @@ public:
             for (unsigned i = 0; i < gimple_phi_num_args(phi); i++) {
                 basic_block src = gimple_phi_arg_edge(phi, i)->src;
                 tree def = gimple_phi_arg_def(phi, i);
-                bimple_phi.values.push_back({src->index, bimple::variable{get_identifier_value(def), generate_type(TREE_TYPE(def))}});
+                bimple_phi.values.push_back({src->index, generate_atom(def)});
             }
             bbb.phis.push_back(std::move(bimple_phi));
         }
         // Handle statements
         for(gimple_stmt_iterator it = gsi_start_bb(bb); !gsi_end_p(it); gsi_next(&it)) {
-            auto statement = generate_statement(gsi_stmt(it));
-            if(statement) {
-                bbb.statements.push_back(std::move(statement));
-            }
+            generate_statement(gsi_stmt(it), bbb.statements);
         }
         // Handle edges
         if(!bbb.statements.empty() && bbb.statements.back()->tag == bimple::statement_tag::cond) {
@@ -455,22 +1041,281 @@ public:
             } else {
                 VERIFY(false, "", e->flags);
             }
+        } else if(!bbb.statements.empty() && bbb.statements.back()->tag == bimple::statement_tag::switch_branch) {
+            // the cases refer to these by position
+            for(basic_block target : switch_targets(reinterpret_cast<gswitch*>(gsi_stmt(gsi_last_bb(bb))))) {
+                bbb.successors.push_back(target->index);
+            }
         } /*else if(auto cond = dynamic_cast<bimple::cond*>(bbb.statements.back().get())) {
 
         }*/ else {
             edge e;
             edge_iterator ei;
             FOR_EACH_EDGE(e, ei, bb->succs) {
-                bbb.successors.push_back(e->dest->index);
+                if(e->flags & EDGE_EH) {
+                    if(!is_clobber_only_cleanup(e->dest)) {
+                        unsupported("Exception cleanup that runs code", "gimple", "resx");
+                    }
+                    continue;
+                }
+                // returns end their block, nothing branches to the exit block
+                if(e->dest->index != EXIT_BLOCK) {
+                    bbb.successors.push_back(e->dest->index);
+                }
             }
         }
         return bbb;
     }
 
+    // gcc's -f*-math options as llvm fast-math flags. -ffast-math implies all of them except contract, which comes from
+    // -ffp-contract=fast, gcc's default outside of iso modes.
+    static bimple::fp_flags fp_flags_for(const gcc_options& opts) {
+        using enum bimple::fp_flags;
+        bimple::fp_flags flags = none;
+        if(opts.x_flag_associative_math) {
+            flags |= reassoc;
+        }
+        if(!opts.x_flag_signed_zeros) {
+            flags |= nsz;
+        }
+        if(opts.x_flag_finite_math_only) {
+            flags |= nnan | ninf;
+        }
+        if(opts.x_flag_reciprocal_math) {
+            flags |= arcp;
+        }
+        if(opts.x_flag_fp_contract_mode == FP_CONTRACT_FAST) {
+            flags |= contract;
+        }
+        if(opts.x_flag_unsafe_math_optimizations) {
+            flags |= afn;
+        }
+        return flags;
+    }
+
+    // Locals that aren't gimple registers (their address is taken, or they're aggregates) get storage. Variable sized
+    // ones are already accessed through a pointer from __builtin_alloca_with_align and have a DECL_VALUE_EXPR.
+    void generate_locals(function* fun, bimple::function& function) {
+        local_names.clear();
+        for(unsigned i = 0; i < vec_safe_length(fun->local_decls); i++) {
+            tree var = (*fun->local_decls)[i];
+            if(TREE_CODE(var) != VAR_DECL || is_global_var(var) || DECL_HAS_VALUE_EXPR_P(var) || is_gimple_reg(var)) {
+                continue;
+            }
+            if(DECL_SIZE(var) == NULL_TREE || !tree_fits_uhwi_p(DECL_SIZE(var))) {
+                continue;
+            }
+            // names can repeat across scopes, the uid keeps them apart
+            auto name = fmt::format(
+                "{}.{}",
+                DECL_NAME(var) != NULL_TREE ? IDENTIFIER_POINTER(DECL_NAME(var)) : "D",
+                DECL_UID(var)
+            );
+            local_names.insert({var, name});
+            function.locals.push_back({std::move(name), generate_type(TREE_TYPE(var)), DECL_ALIGN_UNIT(var)});
+        }
+    }
+
+    // locals an atom refers to, through memory references and addresses
+    void referenced_locals(const std::unique_ptr<bimple::atom>& atom, std::vector<std::string>& names) {
+        if(!atom) {
+            return;
+        }
+        if(auto* local = bimple::downcast<bimple::local_ref>(atom)) {
+            names.push_back(local->name);
+        } else if(auto* ref = bimple::downcast<bimple::mem_ref>(atom)) {
+            referenced_locals(ref->base, names);
+        } else if(auto* ref = bimple::downcast<bimple::component_ref>(atom)) {
+            referenced_locals(ref->base, names);
+        } else if(auto* ref = bimple::downcast<bimple::array_ref>(atom)) {
+            referenced_locals(ref->base, names);
+        } else if(auto* address = bimple::downcast<bimple::address_of>(atom)) {
+            referenced_locals(address->reference, names);
+        }
+    }
+
+    std::vector<std::string> referenced_locals(const bimple::statement& statement) {
+        std::vector<std::string> names;
+        bimple::visit(statement, [&] (const auto& s) {
+            using T = std::remove_cvref_t<decltype(s)>;
+            if constexpr(std::is_same_v<T, bimple::binary_assignment>) {
+                referenced_locals(s.lhs, names);
+                referenced_locals(s.rhs1, names);
+                referenced_locals(s.rhs2, names);
+            } else if constexpr(std::is_same_v<T, bimple::unary_assignment> || std::is_same_v<T, bimple::cond>) {
+                referenced_locals(s.lhs, names);
+                referenced_locals(s.rhs, names);
+            } else if constexpr(std::is_same_v<T, bimple::function_return>) {
+                referenced_locals(s.value, names);
+            } else if constexpr(std::is_same_v<T, bimple::call> || std::is_same_v<T, bimple::intrinsic_call>) {
+                referenced_locals(s.lhs, names);
+                for(const auto& arg : s.args) {
+                    referenced_locals(arg, names);
+                }
+            }
+        });
+        return names;
+    }
+
+    static const std::string* lifetime_end_of(const bimple::statement& statement) {
+        auto* intrinsic = bimple::downcast<bimple::intrinsic_call>(&statement);
+        if(!intrinsic || intrinsic->id != bimple::intrinsics::lifetime_end) {
+            return nullptr;
+        }
+        return &VERIFY(bimple::downcast<bimple::local_ref>(intrinsic->args[0]))->name;
+    }
+
+    // Clobbers only say where a local's storage dies, like gcc's own stack slot sharing the storage is live again
+    // from the local's next mention. A lifetime_start goes before each mention reached only by paths where the local
+    // is dead. A local that's dead on some paths to a mention and live on others keeps no markers and stays live for
+    // the whole function, starting it there could throw away a value that's still needed.
+    void place_lifetime_starts(bimple::function& function) {
+        enum class liveness : std::uint8_t { unreached, dead, live, mixed };
+        std::unordered_map<std::string, std::size_t> ids;
+        for(const auto& bb : function.basic_blocks) {
+            for(const auto& statement : bb.statements) {
+                if(auto* name = lifetime_end_of(*statement)) {
+                    ids.insert({*name, ids.size()});
+                }
+            }
+        }
+        if(ids.empty()) {
+            return;
+        }
+        auto meet = [] (liveness a, liveness b) {
+            return a == liveness::unreached || a == b ? b : b == liveness::unreached ? a : liveness::mixed;
+        };
+        // calls mention(id, statement index or -1 for the block's phis) and end(id) in order
+        auto walk = [&] (const bimple::basic_block& bb, auto&& mention, auto&& end) {
+            for(const auto& phi : bb.phis) {
+                std::vector<std::string> names;
+                for(const auto& [_, value] : phi.values) {
+                    referenced_locals(value, names);
+                }
+                for(const auto& name : names) {
+                    if(auto it = ids.find(name); it != ids.end()) {
+                        mention(it->second, -1);
+                    }
+                }
+            }
+            for(std::size_t i = 0; i < bb.statements.size(); i++) {
+                if(auto* name = lifetime_end_of(*bb.statements[i])) {
+                    end(ids.at(*name));
+                    continue;
+                }
+                for(const auto& name : referenced_locals(*bb.statements[i])) {
+                    if(auto it = ids.find(name); it != ids.end()) {
+                        mention(it->second, int(i));
+                    }
+                }
+            }
+        };
+        std::vector<std::vector<int>> predecessors(function.basic_blocks.size());
+        for(const auto& bb : function.basic_blocks) {
+            for(int successor : bb.successors) {
+                predecessors[successor].push_back(bb.index);
+            }
+        }
+        std::vector<std::vector<liveness>> in(
+            function.basic_blocks.size(),
+            std::vector<liveness>(ids.size(), liveness::unreached)
+        );
+        auto out = in;
+        in[0].assign(ids.size(), liveness::dead);
+        bool changed = true;
+        while(changed) {
+            changed = false;
+            for(int index : function.topological) {
+                if(index != 0) {
+                    std::vector<liveness> state(ids.size(), liveness::unreached);
+                    for(int predecessor : predecessors[index]) {
+                        for(std::size_t id = 0; id < ids.size(); id++) {
+                            state[id] = meet(state[id], out[predecessor][id]);
+                        }
+                    }
+                    in[index] = std::move(state);
+                }
+                auto state = in[index];
+                walk(
+                    function.basic_blocks[index],
+                    [&] (std::size_t id, int) { state[id] = liveness::live; },
+                    [&] (std::size_t id) { state[id] = liveness::dead; }
+                );
+                if(state != out[index]) {
+                    out[index] = std::move(state);
+                    changed = true;
+                }
+            }
+        }
+        // statement index -> locals to start before it, -1 for the top of the block
+        std::vector<std::vector<std::pair<int, std::size_t>>> starts(function.basic_blocks.size());
+        std::vector<bool> unmarked(ids.size(), false);
+        for(int index : function.topological) {
+            auto state = in[index];
+            walk(
+                function.basic_blocks[index],
+                [&] (std::size_t id, int position) {
+                    if(state[id] == liveness::dead) {
+                        starts[index].push_back({position, id});
+                    } else if(state[id] != liveness::live) {
+                        unmarked[id] = true;
+                    }
+                    state[id] = liveness::live;
+                },
+                [&] (std::size_t id) { state[id] = liveness::dead; }
+            );
+        }
+        std::vector<const std::string*> names(ids.size());
+        std::vector<std::unique_ptr<bimple::type>> types(ids.size());
+        for(const auto& [name, id] : ids) {
+            names[id] = &name;
+        }
+        for(const auto& local : function.locals) {
+            if(auto it = ids.find(local.name); it != ids.end()) {
+                types[it->second] = local.type->clone();
+            }
+        }
+        for(auto& bb : function.basic_blocks) {
+            std::vector<std::unique_ptr<bimple::statement>> statements;
+            std::size_t next = 0;
+            auto start_before = [&] (int position) {
+                for(; next < starts[bb.index].size() && starts[bb.index][next].first == position; next++) {
+                    auto id = starts[bb.index][next].second;
+                    if(unmarked[id]) {
+                        continue;
+                    }
+                    std::vector<std::unique_ptr<bimple::atom>> args;
+                    args.push_back(std::make_unique<bimple::local_ref>(std::string(*names[id]), types[id]->clone()));
+                    statements.push_back(
+                        std::make_unique<bimple::intrinsic_call>(
+                            bimple::intrinsics::lifetime_start,
+                            nullptr,
+                            std::move(args)
+                        )
+                    );
+                }
+            };
+            start_before(-1);
+            for(std::size_t i = 0; i < bb.statements.size(); i++) {
+                start_before(int(i));
+                auto* name = lifetime_end_of(*bb.statements[i]);
+                if(name && unmarked[ids.at(*name)]) {
+                    continue;
+                }
+                statements.push_back(std::move(bb.statements[i]));
+            }
+            bb.statements = std::move(statements);
+        }
+    }
+
     bimple::function generate_function(function* fun) {
+        fp_flags = fp_flags_for(*opts_for_fn(fun->decl));
         bimple::function function;
+        referenced_globals.clear();
+        referenced_global_names.clear();
         function.identifier = gcc_str(DECL_ASSEMBLER_NAME(fun->decl)->identifier.id.str);
         function.return_type = generate_type(TREE_TYPE(TREE_TYPE(fun->decl)));
+        generate_locals(fun, function);
         tree arg = DECL_ARGUMENTS(fun->decl);
         while(arg) {
             function.args.push_back(
@@ -518,8 +1363,14 @@ public:
         //     //gccbb2bb[gcc_bb] = func->build_bb();
         //     // debug_bb(gcc_bb);
         // }
+        postorder.resize(nof_blocks);
         std::reverse(postorder.begin(), postorder.end());
         function.topological = std::move(postorder);
+        place_lifetime_starts(function);
+        // initializers can refer to more globals
+        for(std::size_t i = 0; i < referenced_globals.size(); i++) {
+            function.globals.push_back(generate_global(referenced_globals[i]));
+        }
         return function;
     };
 
@@ -529,7 +1380,8 @@ public:
     }
 };
 
-simple_gimple_to_bimple_converter::simple_gimple_to_bimple_converter() : pimpl(std::make_unique<impl>()) {}
+simple_gimple_to_bimple_converter::simple_gimple_to_bimple_converter(bool keep_going) :
+    pimpl(std::make_unique<impl>(keep_going)) {}
 
 simple_gimple_to_bimple_converter::~simple_gimple_to_bimple_converter() = default;
 
@@ -7,11 +7,19 @@
 
 #include "bimple.h"
 
+// Thrown instead of failing an assertion when the converter was told to keep going past unsupported input
+struct unsupported_node {
+    // "tree" or "gimple"
+    const char* kind;
+    // the tree or gimple code name
+    const char* code;
+};
+
 class simple_gimple_to_bimple_converter {
     class impl;
     std::unique_ptr<impl> pimpl;
 public:
-    simple_gimple_to_bimple_converter();
+    explicit simple_gimple_to_bimple_converter(bool keep_going = false);
     ~simple_gimple_to_bimple_converter();
     bimple::function generate_function(function* fun);
 };
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef ASSERT_USE_MAGIC_ENUM
+#define ASSERT_USE_MAGIC_ENUM
+#endif
+#include <assert.hpp>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include "bimple.h"
+#include "codegen_cache.h"
+#include "instrumentation.h"
+#include "statistics.h"
+
+namespace {
+    template<typename M, typename F>
+    std::string json_object(const M& values, F format_value) {
+        std::vector<std::string> members;
+        for(const auto& [key, value] : values) {
+            members.push_back(fmt::format(R"("{}": {})", key, format_value(value)));
+        }
+        return fmt::format("{{{}}}", fmt::join(members, ", "));
+    }
+
+    std::string histogram(const std::map<std::string, std::size_t>& values) {
+        std::vector<std::pair<std::string, std::size_t>> sorted(values.begin(), values.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        std::vector<std::string> entries;
+        for(const auto& [key, count] : sorted) {
+            entries.push_back(fmt::format("{} {}", key, count));
+        }
+        return fmt::format("{}", fmt::join(entries, ", "));
+    }
+
+    double milliseconds(std::chrono::nanoseconds time) {
+        return std::chrono::duration<double, std::milli>(time).count();
+    }
+}
+
+std::vector<statistics::function_size> statistics::largest(std::size_t count) const {
+    std::vector<function_size> result = sizes;
+    count = std::min(count, result.size());
+    std::partial_sort(
+        result.begin(),
+        result.begin() + count,
+        result.end(),
+        [](const function_size& a, const function_size& b) { return a.statements > b.statements; }
+    );
+    result.resize(count);
+    return result;
+}
+
+void statistics::add_function(const bimple::function& function, std::size_t ir_bytes) {
+    functions++;
+    blocks += function.basic_blocks.size();
+    this->ir_bytes += ir_bytes;
+    std::size_t function_statements = 0;
+    for(const auto& bb : function.basic_blocks) {
+        phis += bb.phis.size();
+        function_statements += bb.phis.size() + bb.statements.size();
+        for(const auto& statement : bb.statements) {
+            statements[std::string(magic_enum::enum_name(statement->tag))]++;
+            std::optional<bimple::operators> op;
+            switch(statement->tag) {
+                case bimple::statement_tag::binary_assignment:
+                    op = downcast<bimple::binary_assignment>(statement)->op;
+                    break;
+                case bimple::statement_tag::unary_assignment:
+                    op = downcast<bimple::unary_assignment>(statement)->op;
+                    break;
+                case bimple::statement_tag::cond:
+                    op = downcast<bimple::cond>(statement)->op;
+                    break;
+                default:
+                    break;
+            }
+            if(op) {
+                operators[std::string(magic_enum::enum_name(*op))]++;
+            }
+        }
+    }
+    sizes.push_back({function.identifier, function.basic_blocks.size(), function_statements, ir_bytes});
+}
+
+void statistics::add_unsupported(std::string_view kind, std::string_view code) {
+    // the converter gives up on a function at the first unsupported node
+    skipped_functions++;
+    unsupported[std::string(kind)][std::string(code)]++;
+}
+
+void statistics::add_stage(std::string_view stage, const instrumentation::stage_measurement& measurement) {
+    auto it = stages.find(stage);
+    if(it == stages.end()) {
+        stages.emplace(std::string(stage), measurement);
+    } else {
+        it->second += measurement;
+    }
+}
+
+void statistics::set_cache_counters(const codegen_cache::counters& counters) {
+    cache = counters;
+}
+
+std::string statistics::to_json(std::string_view unit) const {
+    auto count = [](std::size_t value) { return std::to_string(value); };
+    std::vector<std::string> largest_functions;
+    for(const auto& function : largest(largest_count)) {
+        largest_functions.push_back(
+            fmt::format(
+                R"({{"function": "{}", "blocks": {}, "statements": {}, "ir_bytes": {}}})",
+                function.name,
+                function.blocks,
+                function.statements,
+                function.ir_bytes
+            )
+        );
+    }
+    std::string cache_json = "null";
+    if(cache) {
+        cache_json = fmt::format(
+            R"({{"hits": {}, "misses": {}, "collisions": {}, "stores": {}, "evictions": {}}})",
+            cache->hits,
+            cache->misses,
+            cache->collisions,
+            cache->stores,
+            cache->evictions
+        );
+    }
+    return fmt::format(
+        R"({{"unit": "{}", "functions": {}, "skipped_functions": {}, "blocks": {}, "phis": {}, "ir_bytes": {}, )"
+        R"("statements": {}, "operators": {}, "unsupported": {}, "stages": {}, "cache": {}, "peak_rss": {}, )"
+        R"("largest": [{}]}})",
+        unit,
+        functions,
+        skipped_functions,
+        blocks,
+        phis,
+        ir_bytes,
+        json_object(statements, count),
+        json_object(operators, count),
+        json_object(unsupported, [&](const auto& codes) { return json_object(codes, count); }),
+        json_object(stages, [](const instrumentation::stage_measurement& stage) {
+            return fmt::format(
+                R"({{"ns": {}, "allocations": {}, "bytes": {}, "peak_bytes": {}}})",
+                stage.time.count(),
+                stage.allocations,
+                stage.bytes,
+                stage.peak_bytes
+            );
+        }),
+        cache_json,
+        instrumentation::peak_rss(),
+        fmt::join(largest_functions, ", ")
+    );
+}
+
+std::string statistics::to_string(std::string_view unit) const {
+    std::string result = fmt::format("wyrm statistics for {}\n", unit);
+    result += fmt::format(
+        "  {} functions converted, {} skipped, {} blocks, {} phis, {} bytes of llvm ir\n",
+        functions,
+        skipped_functions,
+        blocks,
+        phis,
+        ir_bytes
+    );
+    result += fmt::format("  statements: {}\n", histogram(statements));
+    result += fmt::format("  operators: {}\n", histogram(operators));
+    for(const auto& [kind, codes] : unsupported) {
+        result += fmt::format("  unsupported {} codes: {}\n", kind, histogram(codes));
+    }
+    for(const auto& [stage, measurement] : stages) {
+        result += fmt::format(
+            "  {}: {:.3f} ms, {} allocations, {} bytes allocated, {} peak bytes\n",
+            stage,
+            milliseconds(measurement.time),
+            measurement.allocations,
+            measurement.bytes,
+            measurement.peak_bytes
+        );
+    }
+    if(cache) {
+        result += fmt::format(
+            "  cache: {} hits, {} misses ({} collisions), {} stores, {} evictions\n",
+            cache->hits,
+            cache->misses,
+            cache->collisions,
+            cache->stores,
+            cache->evictions
+        );
+    }
+    result += fmt::format("  peak rss: {} bytes\n", instrumentation::peak_rss());
+    result += "  largest functions:\n";
+    for(const auto& function : largest(largest_count)) {
+        result += fmt::format(
+            "    {}: {} statements, {} blocks, {} bytes of llvm ir\n",
+            function.name,
+            function.statements,
+            function.blocks,
+            function.ir_bytes
+        );
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bimple.h"
+#include "codegen_cache.h"
+#include "instrumentation.h"
+
+// Counters collected over a translation unit for -fplugin-arg-libplugin-stats, meant for finding which converter gaps
+// and hot paths matter on a real codebase
+class statistics {
+    struct function_size {
+        std::string name;
+        std::size_t blocks;
+        std::size_t statements;
+        std::size_t ir_bytes;
+    };
+    std::size_t functions = 0;
+    std::size_t skipped_functions = 0;
+    std::size_t blocks = 0;
+    std::size_t phis = 0;
+    std::size_t ir_bytes = 0;
+    std::map<std::string, std::size_t> statements;
+    std::map<std::string, std::size_t> operators;
+    // kind ("tree" or "gimple") -> code -> count
+    std::map<std::string, std::map<std::string, std::size_t>> unsupported;
+    std::map<std::string, instrumentation::stage_measurement, std::less<>> stages;
+    std::vector<function_size> sizes;
+    std::optional<codegen_cache::counters> cache;
+    std::vector<function_size> largest(std::size_t count) const;
+public:
+    // number of largest functions reported
+    static constexpr std::size_t largest_count = 10;
+    void add_function(const bimple::function& function, std::size_t ir_bytes);
+    void add_unsupported(std::string_view kind, std::string_view code);
+    void add_stage(std::string_view stage, const instrumentation::stage_measurement& measurement);
+    void set_cache_counters(const codegen_cache::counters& counters);
+    std::string to_json(std::string_view unit) const;
+    std::string to_string(std::string_view unit) const;
+};
+
+#endif
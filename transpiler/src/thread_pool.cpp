@@ -0,0 +1,53 @@
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.h"
+
+thread_pool::thread_pool(unsigned threads) {
+    for(unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([this] { work(); });
+    }
+}
+
+thread_pool::~thread_pool() {
+    {
+        std::unique_lock lock(mutex);
+        stopping = true;
+    }
+    available.notify_all();
+    for(auto& worker : workers) {
+        worker.join();
+    }
+}
+
+std::future<void> thread_pool::submit(std::function<void()> task) {
+    std::packaged_task<void()> packaged(std::move(task));
+    auto future = packaged.get_future();
+    {
+        std::unique_lock lock(mutex);
+        tasks.push_back(std::move(packaged));
+    }
+    available.notify_one();
+    return future;
+}
+
+void thread_pool::work() {
+    while(true) {
+        std::packaged_task<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if(tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
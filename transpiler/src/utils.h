@@ -60,7 +60,8 @@ inline std::string indent(const std::string_view str, size_t depth, char c = ' '
 // std::string join(First&& first, Args&&... args, char c) {
 //     return first + (... + (c + args));
 // }
-inline std::string join(std::initializer_list<std::string> list, char c) {
+template<typename C>
+std::string join(const C& list, char c) {
     std::string result;
     bool first = true;
     for(const auto& item : list) {
@@ -73,4 +74,8 @@ inline std::string join(std::initializer_list<std::string> list, char c) {
     return result;
 }
 
+inline std::string join(std::initializer_list<std::string> list, char c) {
+    return join<std::initializer_list<std::string>>(list, c);
+}
+
 #endif
@@ -9,19 +9,41 @@ class Status(Enum):
     UNSUPPORTED = 3
 
 ALIVE_PATH = "/home/rifkin/thirdparty/alive2/build/alive-tv"
+# Built with -DWYRM_JIT=On, used for output tests with // JIT: lines when --jit is passed
+WYRM_JIT = "./wyrm-jit"
+USE_JIT = "--jit" in sys.argv
 # CLANG = "/usr/bin/clang++-15"
 CLANG = "/usr/bin/clang++-17"
 
+# gcc contracts floating point expressions by default outside of iso modes while clang only fuses within an expression
+# without marking instructions, so tests start from no contraction and opt in with their own flags
+GCC_DEFAULT_FLAGS = ["-ffp-contract=off"]
+
+def test_flags(test_file):
+    # // FLAGS: lines hold options passed to both gcc and clang, e.g. // FLAGS: -ffinite-math-only
+    with open(test_file, "r") as f:
+        return [flag for line in f if line.startswith("// FLAGS: ") for flag in line[len("// FLAGS: "):].split()]
+
+def plugin_flags(test_file):
+    # // PLUGIN: lines hold plugin arguments, e.g. // PLUGIN: only-hot, gcc wants them after -fplugin
+    with open(test_file, "r") as f:
+        args = [arg for line in f if line.startswith("// PLUGIN: ") for arg in line[len("// PLUGIN: "):].split()]
+    return [f"-fplugin-arg-libplugin-{arg}" for arg in args]
+
 def test_alive(test_file):
     # test_file.c ---transpiler--> x.ll -\
     # test_file.c -----clang-----> y.ll   ----> alive
     print(f"{os.path.basename(test_file)}")
+    flags = test_flags(test_file)
     p = subprocess.Popen(
         [
             "g++",
             "-O3",
+            *GCC_DEFAULT_FLAGS,
+            *flags,
             test_file,
-            "-fplugin=./libplugin.so"
+            "-fplugin=./libplugin.so",
+            *plugin_flags(test_file)
         ],
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE
@@ -33,6 +55,7 @@ def test_alive(test_file):
         p = subprocess.Popen(
             [
                 CLANG,
+                *flags,
                 test_file,
                 "-Og",
                 "-S",
@@ -98,8 +121,11 @@ def test_output(test_file):
         [
             "g++",
             "-O3",
+            *GCC_DEFAULT_FLAGS,
+            *test_flags(test_file),
             test_file,
-            "-fplugin=./libplugin.so"
+            "-fplugin=./libplugin.so",
+            *plugin_flags(test_file)
         ],
         stdout=subprocess.PIPE,
         stderr=subprocess.PIPE
@@ -110,8 +136,36 @@ def test_output(test_file):
         lines = [line for line in f]
         decls = [line[len("// DECL: "):].strip() for line in lines if line.startswith("// DECL: ")]
         test_lines = [line[len("// TEST: "):].strip() for line in lines if line.startswith("// TEST: ")]
+        jit_lines = [line[len("// JIT: "):].strip() for line in lines if line.startswith("// JIT: ")]
+        # // ABSENT: symbol lines name functions the plugin must not have transpiled
+        absent = [line[len("// ABSENT: "):].strip() for line in lines if line.startswith("// ABSENT: ")]
     # print(stdout, stderr)
-    if "TRANSPILED SUCCESSFULLY" in stdout:
+    if "TRANSPILED SUCCESSFULLY" in stdout and absent:
+        with open("x.ll", "r") as f:
+            definitions = [line for line in f if line.startswith("define ")]
+        defined = [symbol for symbol in absent if any(f"@{symbol}(" in line for line in definitions)]
+        if defined:
+            print(f"Unexpectedly transpiled: {', '.join(defined)}")
+            return Status.FAIL
+    if "TRANSPILED SUCCESSFULLY" in stdout and USE_JIT and jit_lines:
+        # symbol args... = expected
+        args = [WYRM_JIT, "x.ll"]
+        for line in jit_lines:
+            call, expected = line.split("=")
+            args += ["--call", *call.split(), "--expect", expected.strip()]
+        p = subprocess.Popen(
+            args,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE
+        )
+        stdout, stderr = p.communicate()
+        stdout, stderr = stdout.decode("utf-8"), stderr.decode("utf-8")
+        if p.returncode == 0:
+            return Status.PASS
+        else:
+            print(stdout, stderr)
+            return Status.FAIL
+    elif "TRANSPILED SUCCESSFULLY" in stdout:
         with open("main.cpp", "w") as f:
             f.write(
                 "\n".join(